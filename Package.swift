@@ -85,6 +85,7 @@ let package = Package(
       ],
       path: "Sources/x10",
       sources: [
+        "swift_bindings/optimizers/LossScaler.swift",
         "swift_bindings/optimizers/Optimizer.swift",
         "swift_bindings/optimizers/Optimizers.swift",
       ]),
@@ -46,9 +46,12 @@ xla::Shape ShapeOfXlaOpList(absl::Span<const Value> ops) {
 }
 
 struct ExtraInputDiscovery {
-  // TODO: color when building the graph as this can be n^2
-  // in the number of for loops.
+  // Nodes which do not depend on any placeholder (as colored when building the
+  // graph) are loop invariant, so the walk stops there and they are picked up
+  // as extra inputs. This keeps the discovery linear in the size of the loop
+  // body, rather than in the size of the whole graph, for every loop.
   void BackRefVisit(const Output& v, const Node* node = nullptr) {
+    if (!v.node->depends_on_placeholder()) return;
     auto& state = state_map[v.node];
     if (!state.visited) {
       state.visited = true;
@@ -264,12 +267,206 @@ class XLAFunctionalWhileNode : public swift_xla::ir::Node {
   std::vector<Value> results_;
 };
 
+// Runs a loop of a static number of iterations, where each iteration maps the
+// carry placeholders to the carry results, and additionally produces outputs
+// which are stacked along a new major dimension. The stacked outputs are
+// preallocated, and every iteration writes its slice with a dynamic update
+// slice. A reverse scan visits the indices from length - 1 down to 0, which is
+// the order the backward pass of a forward scan needs.
+class XLAScanNode : public swift_xla::ir::Node {
+ public:
+  static std::vector<Value> BuildArgs(absl::Span<const Value> initial,
+                                      absl::Span<const Value> extras) {
+    std::vector<Value> out(initial.begin(), initial.end());
+    out.insert(out.end(), extras.begin(), extras.end());
+    return out;
+  }
+  static std::vector<Value> Concat(absl::Span<const Value> results,
+                                   absl::Span<const Value> outputs) {
+    std::vector<Value> out(results.begin(), results.end());
+    out.insert(out.end(), outputs.begin(), outputs.end());
+    return out;
+  }
+  static xla::Shape ShapeOfScan(absl::Span<const Value> results,
+                                absl::Span<const Value> outputs,
+                                int64_t length) {
+    xla::Shape result = ShapeOfXlaOpList(results);
+    for (const auto& output : outputs) {
+      xla::ShapeUtil::AppendShapeToTuple(
+          xla::ShapeUtil::PrependMajorDimension(length, output.shape()),
+          &result);
+    }
+    return result;
+  }
+  static xla::hash_t HashOfScan(absl::Span<const Value> results,
+                                absl::Span<const Value> outputs,
+                                int64_t length, bool reverse) {
+    xla::hash_t hash = xla::util::MHash(length, reverse, outputs.size());
+    for (auto& result : results)
+      hash = xla::util::HashCombine(hash, result.hash());
+    for (auto& output : outputs)
+      hash = xla::util::HashCombine(hash, output.hash());
+    return hash;
+  }
+  XLAScanNode(int64_t length, bool reverse, absl::Span<const Value> initial,
+              const Value& index_placeholder,
+              absl::Span<const Value> placeholders,
+              absl::Span<const Value> results, absl::Span<const Value> outputs)
+      : Node(swift_xla::ir::OpKind(at::aten::functional_scan),
+             BuildArgs(initial, DiscoverExtraInputs(Concat(results, outputs),
+                                                    index_placeholder,
+                                                    placeholders)),
+             ShapeOfScan(results, outputs, length),
+             results.size() + outputs.size(),
+             HashOfScan(results, outputs, length, reverse)),
+        length_(length),
+        reverse_(reverse),
+        index_placeholder_(index_placeholder),
+        placeholders_(placeholders.begin(), placeholders.end()),
+        results_(results.begin(), results.end()),
+        outputs_(outputs.begin(), outputs.end()) {
+    XLA_CHECK_EQ(initial.size(), results.size());
+    XLA_CHECK_EQ(placeholders.size(), results.size());
+  }
+
+  XlaOpVector Lower(LoweringContext* loctx) const override {
+    size_t num_carry = placeholders_.size();
+    // Tuple layout: carry values, step, stacked outputs, extra inputs.
+    size_t step_index = num_carry;
+    size_t outputs_index = num_carry + 1;
+    size_t extras_index = outputs_index + outputs_.size();
+    xla::PrimitiveType index_type =
+        index_placeholder_.shape().element_type();
+
+    xla::XlaOp initial;
+    {
+      auto* b = loctx->builder();
+      std::vector<xla::XlaOp> args;
+      args.reserve(extras_index + operands().size() - num_carry);
+      for (size_t i = 0; i < num_carry; ++i) {
+        args.push_back(loctx->GetOutputOp(operand(i)));
+      }
+      args.push_back(
+          swift_xla::XlaHelpers::ScalarValue<int64_t>(0, index_type, b));
+      for (const auto& output : outputs_) {
+        args.push_back(swift_xla::XlaHelpers::ScalarBroadcast<int64_t>(
+            0, xla::ShapeUtil::PrependMajorDimension(length_, output.shape()),
+            b));
+      }
+      for (size_t i = num_carry; i < operands().size(); ++i) {
+        args.push_back(loctx->GetOutputOp(operand(i)));
+      }
+      initial = xla::Tuple(b, args);
+    }
+    const xla::Shape& tuple_shape =
+        swift_xla::XlaHelpers::ShapeOfXlaOp(initial);
+
+    auto body_builder = loctx->builder()->CreateSubBuilder("scan_body");
+    xla::XlaOp body_result;
+    {
+      auto* b = body_builder.get();
+      swift_xla::ir::Util::EmissionMap emap;
+      for (const auto& placeholder : placeholders_) {
+        emap[placeholder.node.get()] = swift_xla::ir::Util::kEmitted;
+      }
+      for (size_t i = num_carry; i < operands().size(); ++i) {
+        emap[operand(i).node] = swift_xla::ir::Util::kEmitted;
+      }
+      emap[index_placeholder_.node.get()] = swift_xla::ir::Util::kEmitted;
+      swift_xla::ir::LoweringContext body_loctx(b, loctx->device(),
+                                                std::move(emap));
+      auto t = xla::Parameter(b, 0, tuple_shape, "tuple");
+      auto step = xla::GetTupleElement(t, step_index);
+      auto index = step;
+      if (reverse_) {
+        index = swift_xla::XlaHelpers::ScalarValue<int64_t>(length_ - 1,
+                                                            index_type, b) -
+                step;
+      }
+      for (size_t i = 0; i < num_carry; ++i) {
+        body_loctx.AssignOutputOp(placeholders_[i], xla::GetTupleElement(t, i));
+      }
+      for (size_t i = num_carry; i < operands().size(); ++i) {
+        body_loctx.AssignOutputOp(
+            operand(i), xla::GetTupleElement(t, extras_index + i - num_carry));
+      }
+      body_loctx.AssignOutputOp(index_placeholder_, index);
+
+      std::vector<xla::XlaOp> tmps;
+      for (auto& result : results_) {
+        tmps.push_back(body_loctx.GetOutputOp(result));
+      }
+      tmps.push_back(
+          step + swift_xla::XlaHelpers::ScalarValue<int64_t>(1, index_type,
+                                                                 b));
+      auto zero =
+          swift_xla::XlaHelpers::ScalarValue<int64_t>(0, index_type, b);
+      for (size_t i = 0; i < outputs_.size(); ++i) {
+        xla::XlaOp output = body_loctx.GetOutputOp(outputs_[i]);
+        const xla::Shape& output_shape = outputs_[i].shape();
+        std::vector<int64_t> slice_sizes(output_shape.dimensions().begin(),
+                                            output_shape.dimensions().end());
+        slice_sizes.insert(slice_sizes.begin(), 1);
+        std::vector<xla::XlaOp> start_indices(slice_sizes.size(), zero);
+        start_indices[0] = index;
+        tmps.push_back(xla::DynamicUpdateSlice(
+            xla::GetTupleElement(t, outputs_index + i),
+            xla::Reshape(output, slice_sizes), start_indices));
+      }
+      for (size_t i = num_carry; i < operands().size(); ++i) {
+        tmps.push_back(body_loctx.GetOutputOp(operand(i)));
+      }
+      body_result = xla::Tuple(b, tmps);
+    }
+
+    auto cond_builder = loctx->builder()->CreateSubBuilder("scan_cond");
+    xla::XlaOp cond_result;
+    {
+      auto* b = cond_builder.get();
+      auto t = xla::Parameter(b, 0, tuple_shape, "tuple");
+      cond_result = xla::Lt(
+          xla::GetTupleElement(t, step_index),
+          swift_xla::XlaHelpers::ScalarValue<int64_t>(length_, index_type,
+                                                         b));
+    }
+
+    auto result = xla::While(
+        cond_builder->Build(cond_result).ConsumeValueOrDie(),
+        body_builder->Build(body_result).ConsumeValueOrDie(), initial);
+
+    std::vector<xla::XlaOp> results;
+    for (size_t i = 0; i < num_carry; ++i) {
+      results.push_back(xla::GetTupleElement(result, i));
+    }
+    for (size_t i = 0; i < outputs_.size(); ++i) {
+      results.push_back(xla::GetTupleElement(result, outputs_index + i));
+    }
+    return ReturnOps(results, loctx);
+  }
+
+  std::string ToString() const override {
+    std::stringstream ss;
+    ss << Node::ToString() << ", length=" << length_
+       << ", reverse=" << reverse_;
+    return ss.str();
+  }
+
+  int64_t length_;
+  bool reverse_;
+  Value index_placeholder_;
+  std::vector<Value> placeholders_;
+  std::vector<Value> results_;
+  std::vector<Value> outputs_;
+};
+
 class XLAPlaceholderNode : public swift_xla::ir::Node {
  public:
   XLAPlaceholderNode(xla::Shape shape, int id)
       : Node(swift_xla::ir::OpKind(at::aten::placeholder), {}, shape, 1,
              xla::util::MHash(id)),
-        id_(id) {}
+        id_(id) {
+    MarkPlaceholder();
+  }
   NodePtr Clone(OpList operands) const override {
     return swift_xla::ir::MakeNode<XLAPlaceholderNode>(shape(), id_);
   }
@@ -313,6 +510,34 @@ OpaqueXLATensorArrayRef XLATensor_functional_while(
   return {opaque_tensors, count};
 }
 
+OpaqueXLATensorArrayRef XLATensor_scan(int64_t length, bool reverse,
+                                       OpaqueXLATensorArrayRef initial,
+                                       OpaqueXLATensorArrayRef placeholders,
+                                       OpaqueXLATensor* indexPlaceholder,
+                                       OpaqueXLATensorArrayRef results,
+                                       OpaqueXLATensorArrayRef outputs) {
+  auto initial_ir = UnpackIrValues(initial);
+  auto placeholders_ir = UnpackIrValues(placeholders);
+  auto results_ir = UnpackIrValues(results);
+  auto outputs_ir = UnpackIrValues(outputs);
+
+  auto result_node = swift_xla::ir::MakeNode<XLAScanNode>(
+      length, reverse, initial_ir, indexPlaceholder->GetIrValue(),
+      placeholders_ir, results_ir, outputs_ir);
+  size_t count = results.size + outputs.size;
+  auto opaque_tensors = new OpaqueXLATensor*[count];
+  for (size_t i = 0; i < results.size; ++i) {
+    opaque_tensors[i] = new XLATensor(
+        results.data[i]->CreateFrom(swift_xla::ir::Value(result_node, i)));
+  }
+  for (size_t i = 0; i < outputs.size; ++i) {
+    size_t index = results.size + i;
+    opaque_tensors[index] = new XLATensor(outputs.data[i]->CreateFrom(
+        swift_xla::ir::Value(result_node, index)));
+  }
+  return {opaque_tensors, count};
+}
+
 OpaqueXLATensor* XLATensor_makePlaceholder(OpaqueXLATensor* t, int id) {
   return new XLATensor(t->CreateFrom(
       swift_xla::ir::MakeNode<XLAPlaceholderNode>(t->shape(), id)));
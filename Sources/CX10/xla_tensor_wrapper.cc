@@ -20,9 +20,11 @@
 
 #include "xla_tensor_wrapper.h"
 
+#include <functional>
 #include <random>
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/auto_mixed_precision.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_dump_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
@@ -30,6 +32,8 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/strided_slice_helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
 #include "tensorflow/core/util/mirror_pad_mode.h"
 
 using swift_xla::XlaHelpers;
@@ -54,6 +58,44 @@ tensorflow::Padding ToTFPadding(TFPadding padding) {
   }
 }
 
+swift_xla::OptimizerUpdateType ToOptimizerUpdateType(
+    XLAOptimizerUpdateType type) {
+  switch (type) {
+    case XLAOptimizerUpdateType_SGD: {
+      return swift_xla::OptimizerUpdateType::kSgd;
+    }
+    case XLAOptimizerUpdateType_ADAM: {
+      return swift_xla::OptimizerUpdateType::kAdam;
+    }
+    case XLAOptimizerUpdateType_LARS: {
+      return swift_xla::OptimizerUpdateType::kLars;
+    }
+    default: {
+      LOG(FATAL) << "Invalid optimizer update type: " << type;
+    }
+  }
+}
+
+swift_xla::ConvActivation ToConvActivation(XLAConvActivation activation) {
+  switch (activation) {
+    case XLAConvActivation_RELU: {
+      return swift_xla::ConvActivation::kRelu;
+    }
+    case XLAConvActivation_RELU6: {
+      return swift_xla::ConvActivation::kRelu6;
+    }
+    case XLAConvActivation_GELU: {
+      return swift_xla::ConvActivation::kGelu;
+    }
+    case XLAConvActivation_SWISH: {
+      return swift_xla::ConvActivation::kSwish;
+    }
+    default: {
+      LOG(FATAL) << "Invalid convolution activation: " << activation;
+    }
+  }
+}
+
 tensorflow::MirrorPadMode ToTFMirrorPadMode(TFMirrorPadMode mode) {
   switch (mode) {
     case TFMirrorPadMode_REFLECT: {
@@ -90,6 +132,38 @@ Int64ArrayRef Int64ArrayRefFromCollection(const T& collection) {
   return {array, collection.size()};
 }
 
+// Wraps the caller owned buffer at value into a host tensor, without copying
+// it. The release function is called once the tensor is destroyed.
+at::Tensor MakeBorrowedTensor(XLATensorScalarType type, const void* value,
+                              size_t num_entries, const size_t* shape,
+                              size_t rank, std::function<void()> release) {
+  std::vector<int64_t> dims(shape, shape + rank);
+  switch (type) {
+#define DEFINE_BORROW_CASE(name, aten_name, DType)                      \
+  case XLATensorScalarType_##name: {                                    \
+    auto buffer = std::make_unique<at::BorrowedAnyScalarBuffer<DType>>( \
+        reinterpret_cast<const DType*>(value), num_entries,             \
+        std::move(release));                                            \
+    return at::Tensor(std::move(buffer), std::move(dims));              \
+  }
+    LIST_SCALAR_TYPES(DEFINE_BORROW_CASE)
+#undef DEFINE_BORROW_CASE
+    default:
+      LOG(FATAL) << "Invalid type: " << type;
+  }
+}
+
+// Uploads the data at value to the device before returning, reading it straight
+// out of the caller buffer.
+XLATensor* UploadHostBuffer(XLATensorScalarType type, const void* value,
+                            size_t num_entries, const size_t* shape,
+                            size_t rank, const struct CDevice cdevice) {
+  at::Tensor t = MakeBorrowedTensor(type, value, num_entries, shape, rank,
+                                    /*release=*/nullptr);
+  auto xla_data = swift_xla::TensorToXlaData(t, ConvertDevice(cdevice));
+  return new XLATensor(XLATensor::Create(xla_data, t.scalar_type()));
+}
+
 }  // namespace
 
 at::Scalar atScalar(XLAScalar s) {
@@ -138,41 +212,60 @@ OpaqueXLATensor* copyTensorAndMakeResident(enum XLATensorScalarType type,
                                            const size_t* shape, size_t rank,
                                            const struct CDevice cdevice,
                                            bool to_reduced_precision) {
-  auto device = ConvertDevice(cdevice);
   if (to_reduced_precision && XLATensorScalarType_Float == type) {
-    const float* float_buffer = reinterpret_cast<const float*>(value);
-    auto non_owned_buffer =
-        std::make_unique<at::NonOwnedAnyScalarBuffer<float>>(
-            float_buffer, num_entries * sizeof(float));
-    std::vector<int64_t> dims(shape, shape + rank);
-    auto dest_shape = swift_xla::MakeArrayShapeFromDimensions(
-        XlaHelpers::I64List(dims), /*dynamic_dimensions=*/{},
-        xla::PrimitiveType::BF16, device.hw_type);
-    at::Tensor t(std::move(non_owned_buffer), std::move(dims));
-    auto xla_data = swift_xla::TensorToXlaData(t, dest_shape, device);
-    return new swift_xla::XLATensor(
-        swift_xla::XLATensor::Create(xla_data, at::ScalarType::Float));
+    return copyTensorWithPhysicalType(type, value, num_entries, shape, rank,
+                                      cdevice, XLATensorScalarType_BFloat16);
   }
-  auto* device_ptr = xla::GetX10Device(device);
-  if (XLATensorScalarType_Float == type && device_ptr->IsLocal()) {
-    std::vector<int64_t> dims(shape, shape + rank);
-    auto dest_shape = swift_xla::MakeArrayShapeFromDimensions(
-        dims, /*dynamic_dimensions=*/{}, xla::PrimitiveType::F32,
-        device.hw_type);
-    auto host_shape = swift_xla::MakeSwiftTensorLayout(
-        dims, /*dynamic_dimensions=*/{}, xla::PrimitiveType::F32);
-    xla::BorrowingLiteral literal(reinterpret_cast<const char*>(value),
-                                  host_shape);
-
-    return new swift_xla::XLATensor(swift_xla::XLATensor::Create(
-        xla::GetX10Device(device)->TransferToServer(std::move(literal),
-                                                    dest_shape)));
+  return UploadHostBuffer(type, value, num_entries, shape, rank, cdevice);
+}
+
+OpaqueXLATensor* copyTensorWithPhysicalType(
+    enum XLATensorScalarType type, const void* value, size_t num_entries,
+    const size_t* shape, size_t rank, const struct CDevice cdevice,
+    enum XLATensorScalarType physical_type) {
+  if (physical_type == type) {
+    return UploadHostBuffer(type, value, num_entries, shape, rank, cdevice);
+  }
+  XLA_CHECK(type == XLATensorScalarType_Float &&
+            (physical_type == XLATensorScalarType_BFloat16 ||
+             physical_type == XLATensorScalarType_Half))
+      << "Unsupported physical type " << physical_type << " for type " << type;
+  auto device = ConvertDevice(cdevice);
+  std::vector<int64_t> dims(shape, shape + rank);
+  // The device shape has the reduced precision type, so the conversion happens
+  // within the host copy kernels, while populating the transfer buffer.
+  auto dest_shape = swift_xla::MakeArrayShapeFromDimensions(
+      XlaHelpers::I64List(dims), /*dynamic_dimensions=*/{},
+      physical_type == XLATensorScalarType_BFloat16 ? xla::PrimitiveType::BF16
+                                                    : xla::PrimitiveType::F16,
+      device.hw_type);
+  at::Tensor t(std::make_unique<at::NonOwnedAnyScalarBuffer<float>>(
+                   reinterpret_cast<const float*>(value), num_entries),
+               std::move(dims));
+  auto xla_data = swift_xla::TensorToXlaData(t, dest_shape, device);
+  return new swift_xla::XLATensor(
+      swift_xla::XLATensor::Create(xla_data, at::ScalarType::Float));
+}
+
+OpaqueXLATensor* createTensorFromBorrowedBuffer(
+    enum XLATensorScalarType type, const void* value, size_t num_entries,
+    const size_t* shape, size_t rank, const struct CDevice cdevice,
+    void (*release)(void* release_ctx), void* release_ctx) {
+  std::function<void()> release_fn;
+  if (release != nullptr) {
+    release_fn = [release, release_ctx]() { release(release_ctx); };
   }
-  return copyTensor(type, value, num_entries, shape, rank, cdevice);
+  // The upload is deferred until the tensor is used, and reads straight out
+  // of the borrowed buffer. The tensor then drops it, which releases it.
+  at::Tensor t = MakeBorrowedTensor(type, value, num_entries, shape, rank,
+                                    std::move(release_fn));
+  return new swift_xla::XLATensor(
+      swift_xla::XLATensor::Create(t, ConvertDevice(cdevice)));
 }
 
 const void* MaterializedTensor_getData(OpaqueMaterializedTensor* t) {
-  return t->buffer().raw_data();
+  // Materialized tensors are never views, so their elements are contiguous.
+  return t->raw_data();
 }
 
 OpaqueMaterializedTensor* XLATensor_materialize(OpaqueXLATensor* t) {
@@ -183,6 +276,130 @@ OpaqueMaterializedTensor* XLATensor_materialize(OpaqueXLATensor* t) {
   return new at::Tensor(t->ToTensor(/*detached=*/false));
 }
 
+void XLATensor_materializeMany(OpaqueXLATensorArrayRef tensors,
+                               void* const* buffers,
+                               const size_t* buffer_sizes) {
+  auto tensors_array = tensors.array();
+  XLATensor::MaterializeTensorsInto(
+      &tensors_array, absl::MakeConstSpan(buffers, tensors.size),
+      absl::MakeConstSpan(buffer_sizes, tensors.size));
+}
+
+OpaqueMaterializeHandle* XLATensor_materializeAsync(
+    OpaqueXLATensorArrayRef tensors, void* const* buffers,
+    const size_t* buffer_sizes) {
+  auto tensors_array = tensors.array();
+  return new OpaqueMaterializeHandle(XLATensor::MaterializeTensorsAsync(
+      &tensors_array, absl::MakeConstSpan(buffers, tensors.size),
+      absl::MakeConstSpan(buffer_sizes, tensors.size)));
+}
+
+bool MaterializeHandle_isReady(OpaqueMaterializeHandle* handle) {
+  return (*handle)->mwait.IsDone();
+}
+
+void MaterializeHandle_wait(OpaqueMaterializeHandle* handle) {
+  (*handle)->mwait.Wait();
+}
+
+void destroyMaterializeHandle(OpaqueMaterializeHandle* handle) {
+  // The transfers write into the caller buffers, which are released after
+  // this returns.
+  (*handle)->mwait.Wait();
+  delete handle;
+}
+
+void XLACheckpoint_save(const char* path, const char* const* names,
+                        OpaqueXLATensorArrayRef tensors) {
+  std::vector<swift_xla::NamedTensor> named_tensors;
+  named_tensors.reserve(tensors.size);
+  for (size_t i = 0; i < tensors.size; ++i) {
+    named_tensors.emplace_back(names[i], *tensors.data[i]);
+  }
+  swift_xla::SaveCheckpoint(path, named_tensors);
+}
+
+OpaqueXLACheckpoint* XLACheckpoint_load(const char* path,
+                                        const struct CDevice device) {
+  return new OpaqueXLACheckpoint(
+      swift_xla::LoadCheckpoint(path, ConvertDevice(device)));
+}
+
+size_t XLACheckpoint_size(OpaqueXLACheckpoint* checkpoint) {
+  return checkpoint->size();
+}
+
+const char* XLACheckpoint_name(OpaqueXLACheckpoint* checkpoint, size_t index) {
+  return checkpoint->at(index).name.c_str();
+}
+
+OpaqueXLATensor* XLACheckpoint_tensor(OpaqueXLACheckpoint* checkpoint,
+                                      size_t index) {
+  return new swift_xla::XLATensor(checkpoint->at(index).tensor);
+}
+
+void destroyXLACheckpoint(OpaqueXLACheckpoint* checkpoint) {
+  delete checkpoint;
+}
+
+OpaqueFrozenComputation* FrozenComputation_create(
+    OpaqueXLATensorArrayRef inputs, OpaqueXLATensorArrayRef outputs) {
+  return new OpaqueFrozenComputation(
+      swift_xla::FrozenComputation::Create(inputs.array(), outputs.array()));
+}
+
+OpaqueFrozenComputation* FrozenComputation_load(const char* path,
+                                                const struct CDevice device) {
+  return new OpaqueFrozenComputation(
+      swift_xla::FrozenComputation::Load(path, ConvertDevice(device)));
+}
+
+void FrozenComputation_save(OpaqueFrozenComputation* computation,
+                            const char* path) {
+  (*computation)->Save(path);
+}
+
+OpaqueXLATensorArrayRef FrozenComputation_execute(
+    OpaqueFrozenComputation* computation, OpaqueXLATensorArrayRef inputs) {
+  return ConvertTensorList((*computation)->Execute(inputs.array()));
+}
+
+void destroyFrozenComputation(OpaqueFrozenComputation* computation) {
+  delete computation;
+}
+
+OpaqueInferenceEngine* InferenceEngine_create(const struct CDevice device,
+                                              int64_t max_latency_us) {
+  return new swift_xla::InferenceEngine(
+      ConvertDevice(device), std::chrono::microseconds(max_latency_us));
+}
+
+void InferenceEngine_addBucket(OpaqueInferenceEngine* engine,
+                               int64_t batch_size,
+                               OpaqueXLATensorArrayRef inputs,
+                               OpaqueXLATensorArrayRef outputs) {
+  engine->AddBucket(batch_size, inputs.array(), outputs.array());
+}
+
+void InferenceEngine_run(OpaqueInferenceEngine* engine,
+                         const void* const* inputs, void* const* outputs) {
+  engine->Run(
+      absl::MakeConstSpan(inputs, engine->input_signatures().size()),
+      absl::MakeConstSpan(outputs, engine->output_signatures().size()));
+}
+
+XLAInferenceLoadStats InferenceEngine_runLoad(OpaqueInferenceEngine* engine,
+                                              int64_t num_clients,
+                                              int64_t requests_per_client) {
+  swift_xla::InferenceLoadStats stats =
+      swift_xla::RunInferenceLoad(engine, num_clients, requests_per_client);
+  return {stats.requests,       stats.seconds,
+          stats.throughput,     stats.p50_latency_ms,
+          stats.p99_latency_ms, stats.mean_batch_size};
+}
+
+void destroyInferenceEngine(OpaqueInferenceEngine* engine) { delete engine; }
+
 enum XLATensorScalarType MaterializedTensor_getType(
     OpaqueMaterializedTensor* t) {
   return FromScalarType(t->scalar_type());
@@ -296,6 +513,37 @@ OpaqueXLATensor* XLATensor_arange(XLAScalar start, XLAScalar end,
                         ToScalarType(type));
   return new XLATensor(out);
 }
+OpaqueXLATensor* XLATensor_all_finite(OpaqueXLATensorArrayRef tensors) {
+  return new XLATensor(XLATensor::all_finite(tensors.array()));
+}
+OpaqueXLATensorArrayRef XLATensor_conv_bias_activation(
+    OpaqueXLATensor* input, OpaqueXLATensor* kernel, OpaqueXLATensor* bias,
+    Int64ArrayRef stride, Int64ArrayRef padding, Int64ArrayRef dilation,
+    bool transposed, Int64ArrayRef output_padding, int64_t groups,
+    enum XLAConvActivation activation) {
+  auto output_and_grad = XLATensor::conv_bias_activation(
+      *input, *kernel, *bias, XlaHelpers::I64List(stride.slice()),
+      XlaHelpers::I64List(padding.slice()),
+      XlaHelpers::I64List(dilation.slice()), transposed,
+      XlaHelpers::I64List(output_padding.slice()), groups,
+      ToConvActivation(activation));
+  return ConvertTensorList(std::vector<XLATensor>{
+      std::move(output_and_grad.first), std::move(output_and_grad.second)});
+}
+OpaqueXLATensorArrayRef XLATensor_conv_bias_activation_backward(
+    OpaqueXLATensor* grad_output, OpaqueXLATensor* input,
+    OpaqueXLATensor* kernel, OpaqueXLATensor* activation_grad,
+    Int64ArrayRef stride, Int64ArrayRef padding, Int64ArrayRef dilation,
+    bool transposed, Int64ArrayRef output_padding, int64_t groups) {
+  auto grads = XLATensor::conv_bias_activation_backward(
+      *grad_output, *input, *kernel, *activation_grad,
+      XlaHelpers::I64List(stride.slice()), XlaHelpers::I64List(padding.slice()),
+      XlaHelpers::I64List(dilation.slice()), transposed,
+      XlaHelpers::I64List(output_padding.slice()), groups);
+  return ConvertTensorList(std::vector<XLATensor>{
+      std::move(std::get<0>(grads)), std::move(std::get<1>(grads)),
+      std::move(std::get<2>(grads))});
+}
 OpaqueXLATensorArrayRef XLATensor_cross_replica_sum(
     OpaqueXLATensorArrayRef inputs, double scale) {
   auto token = swift_xla::ir::MakeNode<swift_xla::ir::ops::Token>();
@@ -328,6 +576,18 @@ OpaqueXLATensor* XLATensor_linspace(XLAScalar start, XLAScalar stop,
                           ToScalarType(type));
   return new XLATensor(out);
 }
+OpaqueXLATensorArrayRef XLATensor_optimizer_update(
+    enum XLAOptimizerUpdateType type, bool nesterov, bool weight_decay,
+    OpaqueXLATensorArrayRef hyperparameters, OpaqueXLATensorArrayRef weights,
+    OpaqueXLATensorArrayRef grads, OpaqueXLATensorArrayRef states) {
+  auto steps_and_states = XLATensor::optimizer_update(
+      ToOptimizerUpdateType(type), nesterov, weight_decay,
+      hyperparameters.array(), weights.array(), grads.array(), states.array());
+  std::vector<XLATensor> results = std::move(steps_and_states.first);
+  results.insert(results.end(), steps_and_states.second.begin(),
+                 steps_and_states.second.end());
+  return ConvertTensorList(results);
+}
 OpaqueXLATensor* XLATensor_replica_id(const struct CDevice device) {
   return new XLATensor(XLATensor::xla_replica_id(ConvertDevice(device)));
 }
@@ -352,6 +612,20 @@ OpaqueXLATensor* XLATensor_rand(Int64ArrayRef size, int64_t seed) {
   at::Tensor t(std::move(elements), std::move(size_vec));
   return new XLATensor(XLATensor::Create(t, *swift_xla::GetDefaultDevice()));
 }
+OpaqueXLATensor* XLATensor_rng_seeds(const struct CDevice device) {
+  return new XLATensor(XLATensor::rng_seeds(ConvertDevice(device)));
+}
+OpaqueXLATensor* XLATensor_get_rng_state(const struct CDevice device) {
+  return new XLATensor(XLATensor::GetRngState(ConvertDevice(device)));
+}
+void XLATensor_set_rng_state(const struct CDevice device,
+                             OpaqueXLATensor* state) {
+  XLATensor::SetRngState(ConvertDevice(device), *state);
+}
+void XLATensor_set_rng_seed(const struct CDevice device, uint64_t seed) {
+  swift_xla::Device xla_device = ConvertDevice(device);
+  XLATensor::SetRngSeed(&xla_device, seed);
+}
 void SeededRandomShuffle(size_t* data, size_t size, int64_t seed) {
   std::mt19937 gen(seed);
   std::shuffle(data, data + size, gen);
@@ -361,6 +635,14 @@ void SetMatMulPrecision(bool use_full_precision) {
                                         ? xla::PrecisionConfig::HIGHEST
                                         : xla::PrecisionConfig::DEFAULT);
 }
+void SetAutoMixedPrecision(bool enabled) {
+  swift_xla::ir::AutoMixedPrecision::set_reduced_type(
+      enabled ? xla::PrimitiveType::BF16 : xla::PRIMITIVE_TYPE_INVALID);
+}
+bool GetAutoMixedPrecision() {
+  return swift_xla::ir::AutoMixedPrecision::reduced_type() !=
+         xla::PRIMITIVE_TYPE_INVALID;
+}
 StridedSliceSpec* ComputeIndexingBoundsAndStrides(
     Int64ArrayRef input_sizes, Int64ArrayRef begin, Int64ArrayRef end,
     Int64ArrayRef strides, int32_t begin_mask, int32_t end_mask,
@@ -379,5 +661,9 @@ StridedSliceSpec* ComputeIndexingBoundsAndStrides(
 void PrintMetrics() {
   LOG(INFO) << "Metrics:\n" << xla::metrics::CreateMetricReport();
 }
+int64_t GetMetricsCounterValue(const char* name) {
+  xla::metrics::CounterData* counter = xla::metrics::GetCounter(name);
+  return counter != nullptr ? counter->Value() : 0;
+}
 void DeleteString(OpaqueString* str) { delete str; }
 const char* GetStringCStr(OpaqueString* str) { return str->c_str(); }
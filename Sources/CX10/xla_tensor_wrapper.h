@@ -28,6 +28,9 @@
 #endif
 
 #ifdef __cplusplus
+#include "tensorflow/compiler/tf2xla/xla_tensor/checkpoint.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/frozen_computation.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/inference_engine.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
 #include "tensorflow/core/profiler/lib/traceme.h"
 using OpaqueMaterializedTensor = at::Tensor;
@@ -35,6 +38,11 @@ using OpaqueXLATensor = swift_xla::XLATensor;
 using OpaqueXLAShape = xla::util::MaybeRef<xla::Shape>;
 using XLAAnnotationScope = tensorflow::profiler::TraceMe;
 using OpaqueString = std::string;
+using OpaqueMaterializeHandle =
+    std::shared_ptr<swift_xla::XLATensor::MaterializeAsync>;
+using OpaqueXLACheckpoint = std::vector<swift_xla::NamedTensor>;
+using OpaqueInferenceEngine = swift_xla::InferenceEngine;
+using OpaqueFrozenComputation = std::shared_ptr<swift_xla::FrozenComputation>;
 extern "C" {
 #else
 typedef struct OpaqueXLATensor {
@@ -47,6 +55,14 @@ typedef struct XLAAnnotationScope {
 } XLAAnnotationScope;
 typedef struct OpaqueString {
 } OpaqueString;
+typedef struct OpaqueMaterializeHandle {
+} OpaqueMaterializeHandle;
+typedef struct OpaqueXLACheckpoint {
+} OpaqueXLACheckpoint;
+typedef struct OpaqueInferenceEngine {
+} OpaqueInferenceEngine;
+typedef struct OpaqueFrozenComputation {
+} OpaqueFrozenComputation;
 #endif
 
 XLA_API XLAAnnotationScope* MakeAnnotationScope(const char* scope);
@@ -91,7 +107,8 @@ XLA_API OpaqueXLATensor* XLATensor_makeScalar(XLAScalar value,
                                               enum XLATensorScalarType type,
                                               const struct CDevice cdevice);
 
-// TODO(parkers): Make aliasing constructor.
+// Copies the given data into a host tensor owned by the returned tensor. See
+// createTensorFromBorrowedBuffer() for a version which does not copy.
 XLA_API OpaqueXLATensor* copyTensor(enum XLATensorScalarType type,
                                     const void* value, size_t num_entries,
                                     const size_t* shape, size_t rank,
@@ -107,6 +124,25 @@ XLA_API OpaqueXLATensor* copyTensorAndMakeResident(enum XLATensorScalarType type
                                                    size_t rank,
                                                    const struct CDevice device,
                                                    bool to_reduced_precision);
+// Uploads the data as a device tensor with the given physical scalar type,
+// while keeping type as logical type. The values are converted by the host
+// copy kernels while staging the upload, so no full precision copy ever
+// reaches the device. Only Float data with BFloat16 or Half physical type, or
+// matching types, are supported.
+XLA_API OpaqueXLATensor* copyTensorWithPhysicalType(
+    enum XLATensorScalarType type, const void* value, size_t num_entries,
+    const size_t* shape, size_t rank, const struct CDevice device,
+    enum XLATensorScalarType physical_type);
+// Creates a tensor backed by the caller owned buffer at value, without
+// copying it. The data is uploaded straight out of the buffer the first time
+// the tensor is used on the device. The buffer must stay valid and unchanged
+// until release(release_ctx) is called, which happens once the upload
+// completed, or when the tensor is destroyed before that. The release function
+// can be null.
+XLA_API OpaqueXLATensor* createTensorFromBorrowedBuffer(
+    enum XLATensorScalarType type, const void* value, size_t num_entries,
+    const size_t* shape, size_t rank, const struct CDevice device,
+    void (*release)(void* release_ctx), void* release_ctx);
 XLA_API void destroyTensor(OpaqueXLATensor* t);
 XLA_API OpaqueMaterializedTensor* XLATensor_materialize(OpaqueXLATensor* t);
 XLA_API void destroyMaterializedTensor(OpaqueMaterializedTensor* t);
@@ -151,6 +187,21 @@ enum TFMirrorPadMode {
   TFMirrorPadMode_SYMMETRIC = 2,
 };
 
+// Multi-tensor optimizer updates, see optimizer_updates.h.
+enum XLAOptimizerUpdateType {
+  XLAOptimizerUpdateType_SGD = 0,
+  XLAOptimizerUpdateType_ADAM = 1,
+  XLAOptimizerUpdateType_LARS = 2,
+};
+
+// Activations of the fused convolutions, see convolution.h.
+enum XLAConvActivation {
+  XLAConvActivation_RELU = 0,
+  XLAConvActivation_RELU6 = 1,
+  XLAConvActivation_GELU = 2,
+  XLAConvActivation_SWISH = 3,
+};
+
 // XLA utilities:
 
 typedef struct Int64ArrayRef {
@@ -180,6 +231,94 @@ typedef struct OpaqueXLATensorArrayRef {
 #endif
 } OpaqueXLATensorArrayRef;
 
+// Materializes all the given tensors with a single graph execution and a
+// single batched download per device, which writes the values straight into
+// the caller provided buffers. buffers[i] must be buffer_sizes[i] bytes long, which must
+// match the size of tensors[i] values, of XLATensor_dtype() type.
+XLA_API void XLATensor_materializeMany(OpaqueXLATensorArrayRef tensors,
+                                       void* const* buffers,
+                                       const size_t* buffer_sizes);
+
+// Starts materializing the given tensors without blocking. The computations
+// get scheduled right away, and the device data is fetched in background,
+// straight into the caller provided buffers, with the same requirements of
+// XLATensor_materializeMany(). The buffers must stay valid until the returned
+// handle has been released with destroyMaterializeHandle(), which waits for
+// the pending transfers.
+XLA_API OpaqueMaterializeHandle* XLATensor_materializeAsync(
+    OpaqueXLATensorArrayRef tensors, void* const* buffers,
+    const size_t* buffer_sizes);
+// Returns whether the values of the handle are available, without blocking.
+XLA_API bool MaterializeHandle_isReady(OpaqueMaterializeHandle* handle);
+// Waits for the materialization to complete, after which the buffers hold the
+// values.
+XLA_API void MaterializeHandle_wait(OpaqueMaterializeHandle* handle);
+XLA_API void destroyMaterializeHandle(OpaqueMaterializeHandle* handle);
+
+// Checkpoints:
+
+// Saves the tensors, named after the corresponding names entries, in the
+// native x10 checkpoint format.
+XLA_API void XLACheckpoint_save(const char* path, const char* const* names,
+                                OpaqueXLATensorArrayRef tensors);
+// Loads all the tensors of a checkpoint file onto device.
+XLA_API OpaqueXLACheckpoint* XLACheckpoint_load(const char* path,
+                                                const struct CDevice device);
+XLA_API size_t XLACheckpoint_size(OpaqueXLACheckpoint* checkpoint);
+XLA_API const char* XLACheckpoint_name(OpaqueXLACheckpoint* checkpoint,
+                                       size_t index);
+// Returns a new tensor handle, owned by the caller.
+XLA_API OpaqueXLATensor* XLACheckpoint_tensor(OpaqueXLACheckpoint* checkpoint,
+                                              size_t index);
+XLA_API void destroyXLACheckpoint(OpaqueXLACheckpoint* checkpoint);
+
+// Frozen computations:
+
+// Compiles the outputs into a computation which binds the inputs device data
+// tensors, and freezes the rest of the device data it reads.
+XLA_API OpaqueFrozenComputation* FrozenComputation_create(
+    OpaqueXLATensorArrayRef inputs, OpaqueXLATensorArrayRef outputs);
+XLA_API OpaqueFrozenComputation* FrozenComputation_load(
+    const char* path, const struct CDevice device);
+XLA_API void FrozenComputation_save(OpaqueFrozenComputation* computation,
+                                    const char* path);
+// Runs the computation with the given inputs, and returns its outputs.
+XLA_API OpaqueXLATensorArrayRef FrozenComputation_execute(
+    OpaqueFrozenComputation* computation, OpaqueXLATensorArrayRef inputs);
+XLA_API void destroyFrozenComputation(OpaqueFrozenComputation* computation);
+
+// Inference serving:
+
+typedef struct XLAInferenceLoadStats {
+  int64_t requests;
+  double seconds;
+  double throughput;
+  double p50_latency_ms;
+  double p99_latency_ms;
+  double mean_batch_size;
+} XLAInferenceLoadStats;
+
+// Creates an engine coalescing the requests which arrive within
+// max_latency_us microseconds of each other.
+XLA_API OpaqueInferenceEngine* InferenceEngine_create(
+    const struct CDevice device, int64_t max_latency_us);
+// Compiles the outputs for batches of batch_size examples, fed through the
+// inputs device data tensors.
+XLA_API void InferenceEngine_addBucket(OpaqueInferenceEngine* engine,
+                                       int64_t batch_size,
+                                       OpaqueXLATensorArrayRef inputs,
+                                       OpaqueXLATensorArrayRef outputs);
+// Runs a single example, whose per example input and output buffers are
+// listed in the order of the bucket inputs and outputs.
+XLA_API void InferenceEngine_run(OpaqueInferenceEngine* engine,
+                                 const void* const* inputs,
+                                 void* const* outputs);
+// Runs the local load generator against the engine.
+XLA_API XLAInferenceLoadStats InferenceEngine_runLoad(
+    OpaqueInferenceEngine* engine, int64_t num_clients,
+    int64_t requests_per_client);
+XLA_API void destroyInferenceEngine(OpaqueInferenceEngine* engine);
+
 typedef struct Optional_XLAScalarType {
   bool has_value;
   enum XLATensorScalarType type;
@@ -234,6 +373,9 @@ XLA_API OpaqueXLATensor* XLATensor_add(OpaqueXLATensor* a, OpaqueXLATensor* b);
 XLA_API OpaqueXLATensor* XLATensor_all(OpaqueXLATensor* input,
                                        Int64ArrayRef dimensions,
                                        bool keep_reduced_dimensions);
+// Returns whether all the elements of all the tensors are finite, as a boolean
+// scalar which stays on the device.
+XLA_API OpaqueXLATensor* XLATensor_all_finite(OpaqueXLATensorArrayRef tensors);
 XLA_API OpaqueXLATensor* XLATensor_annotate(OpaqueXLATensor* a, const char*);
 XLA_API OpaqueXLATensor* XLATensor_any(OpaqueXLATensor* input,
                                        Int64ArrayRef dimensions,
@@ -260,6 +402,19 @@ XLATensor_clamp(OpaqueXLATensor* input, OpaqueXLATensor* min,
 XLA_API OpaqueXLATensor*
 XLATensor_constant_pad_nd(OpaqueXLATensor* input, Int64ArrayRef pad,
                           XLAScalar value);
+// Returns the activation of the convolution plus bias, followed by the
+// activation gradient to pass to XLATensor_conv_bias_activation_backward.
+XLA_API OpaqueXLATensorArrayRef XLATensor_conv_bias_activation(
+    OpaqueXLATensor* input, OpaqueXLATensor* kernel, OpaqueXLATensor* bias,
+    Int64ArrayRef stride, Int64ArrayRef padding, Int64ArrayRef dilation,
+    bool transposed, Int64ArrayRef output_padding, int64_t groups,
+    enum XLAConvActivation activation);
+// Returns the gradients of the input, kernel and bias.
+XLA_API OpaqueXLATensorArrayRef XLATensor_conv_bias_activation_backward(
+    OpaqueXLATensor* grad_output, OpaqueXLATensor* input,
+    OpaqueXLATensor* kernel, OpaqueXLATensor* activation_grad,
+    Int64ArrayRef stride, Int64ArrayRef padding, Int64ArrayRef dilation,
+    bool transposed, Int64ArrayRef output_padding, int64_t groups);
 XLA_API OpaqueXLATensor* XLATensor_cos(OpaqueXLATensor* a);
 XLA_API OpaqueXLATensor* XLATensor_cosh(OpaqueXLATensor* a);
 XLA_API OpaqueXLATensorArrayRef XLATensor_cross_replica_sum(
@@ -336,6 +491,11 @@ XLA_API OpaqueXLATensor* XLATensor_neg(OpaqueXLATensor* a);
 XLA_API OpaqueXLATensor* XLATensor_nll_loss(OpaqueXLATensor* input,
                                             OpaqueXLATensor* target,
                                             int64_t ignore_index);
+// Returns the steps for all the weights, followed by the new states.
+XLA_API OpaqueXLATensorArrayRef XLATensor_optimizer_update(
+    enum XLAOptimizerUpdateType type, bool nesterov, bool weight_decay,
+    OpaqueXLATensorArrayRef hyperparameters, OpaqueXLATensorArrayRef weights,
+    OpaqueXLATensorArrayRef grads, OpaqueXLATensorArrayRef states);
 XLA_API OpaqueXLATensor*
 XLATensor_permute_value(OpaqueXLATensor* a, Int64ArrayRef arr);
 XLA_API OpaqueXLATensor* XLATensor_physical_cast(
@@ -432,15 +592,36 @@ XLA_API OpaqueXLATensorArrayRef XLATensor_functional_while(
     OpaqueXLATensor* n, OpaqueXLATensorArrayRef initial,
     OpaqueXLATensorArrayRef placeholders, OpaqueXLATensor* indexPlaceholder,
     OpaqueXLATensorArrayRef results);
+// Runs length iterations of a loop which maps the placeholders to the results,
+// and stacks the per iteration outputs along a new major dimension. Returns the
+// final results followed by the stacked outputs. A reverse scan iterates from
+// the last index to the first one.
+XLA_API OpaqueXLATensorArrayRef XLATensor_scan(
+    int64_t length, bool reverse, OpaqueXLATensorArrayRef initial,
+    OpaqueXLATensorArrayRef placeholders, OpaqueXLATensor* indexPlaceholder,
+    OpaqueXLATensorArrayRef results, OpaqueXLATensorArrayRef outputs);
 XLA_API OpaqueXLATensor* XLATensor_makePlaceholder(OpaqueXLATensor* t, int id);
 // Retrieves the device for a given tensor.
 XLA_API struct CDevice XLATensor_device(OpaqueXLATensor* t);
 // Creates a float tensor on the current device filled with random numbers in
 // the [0, 1) interval.
 XLA_API OpaqueXLATensor* XLATensor_rand(Int64ArrayRef size, int64_t seed);
+// Returns the Int32 pair of seeds of a stateless random operation, drawn from
+// the RNG state of the device without any host transfer.
+XLA_API OpaqueXLATensor* XLATensor_rng_seeds(const struct CDevice device);
+// Returns the Int64 [key, counter] RNG state of the device.
+XLA_API OpaqueXLATensor* XLATensor_get_rng_state(const struct CDevice device);
+XLA_API void XLATensor_set_rng_state(const struct CDevice device,
+                                     OpaqueXLATensor* state);
+// Resets the RNG state of the device to the given seed.
+XLA_API void XLATensor_set_rng_seed(const struct CDevice device, uint64_t seed);
 // Sets whether to use full matrix multiplication precision mode in the TPU
 // backend. Only used for testing, it has a substantial performance cost.
 XLA_API void SetMatMulPrecision(bool use_full_precision);
+// Sets whether matrix multiplications and convolutions are lowered with
+// BFloat16 operands, while reductions, softmax and losses are kept in Float.
+XLA_API void SetAutoMixedPrecision(bool enabled);
+XLA_API bool GetAutoMixedPrecision();
 
 XLA_API StridedSliceSpec* ComputeIndexingBoundsAndStrides(
     Int64ArrayRef input_sizes, Int64ArrayRef begin, Int64ArrayRef end,
@@ -448,6 +629,8 @@ XLA_API StridedSliceSpec* ComputeIndexingBoundsAndStrides(
     int32_t ellipsis_mask, int32_t new_axis_mask, int32_t shrink_axis_mask);
 
 XLA_API void PrintMetrics();
+// Returns the current value of the named counter, or 0 if it never got bumped.
+XLA_API int64_t GetMetricsCounterValue(const char* name);
 
 // Randomly shuffles the array defined by (data, size) by seed and then
 // returns the result.
@@ -535,6 +535,13 @@ extension _Raw {
     }
   }
 
+  /// Returns whether all the elements of all `tensors` are finite, without leaving the device.
+  /// Only supported for XLA tensors, see `_RawXLA.allFinite`.
+  public static func allFinite<T: TensorFlowFloatingPoint>(_ tensors: [Tensor<T>]) -> Tensor<Bool>
+  {
+    _RawXLA.allFinite(tensors)
+  }
+
   /// A simplified version of cross replica sum, with scaling.
   public static func crossReplicaSum<T: TensorFlowNumeric>(
     _ inputs: [Tensor<T>],
@@ -543,6 +550,24 @@ extension _Raw {
     _RawXLA.crossReplicaSum(inputs, scale)
   }
 
+  public typealias OptimizerUpdateType = _RawXLA.OptimizerUpdateType
+
+  /// Computes the optimizer update of all `weights` in a single fused computation. Only
+  /// supported for XLA tensors, see `_RawXLA.optimizerUpdate`.
+  public static func optimizerUpdate(
+    _ type: OptimizerUpdateType,
+    nesterov: Bool = false,
+    weightDecay: Bool,
+    hyperparameters: [Tensor<Float>],
+    weights: [Tensor<Float>],
+    grads: [Tensor<Float>],
+    states: [Tensor<Float>]
+  ) -> (steps: [Tensor<Float>], states: [Tensor<Float>]) {
+    _RawXLA.optimizerUpdate(
+      type, nesterov: nesterov, weightDecay: weightDecay, hyperparameters: hyperparameters,
+      weights: weights, grads: grads, states: states)
+  }
+
   /// Transfer a tensor to a different device.
   public static func toDevice<T: TensorFlowScalar>(_ x: Tensor<T>, _ device: Device) -> Tensor<T>
   {
@@ -558,6 +583,12 @@ extension _Raw {
     _RawXLA.physicalCast(input, destType: destType)
   }
 
+  /// Returns the seeds of a stateless random op, drawn from the RNG state of the device without
+  /// any host transfer. Only supported for XLA devices, see `_RawXLA.randomSeeds`.
+  public static func randomSeeds(on device: Device) -> Tensor<Int32> {
+    _RawXLA.randomSeeds(on: device)
+  }
+
   // Currently only used for deterministic testing.
   public static func rand(_ dims: [Int], _ seed: Int) -> Tensor<Float> {
     _RawXLA.rand(dims, seed)
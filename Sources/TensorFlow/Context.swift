@@ -63,11 +63,18 @@ public struct Context {
       _randomSeed = (seed.0, seed.1 + 1)
       return seed
     }
-    set { _randomSeed = newValue }
+    set {
+      _randomSeed = newValue
+      isRandomSeedSet = true
+    }
   }
 
   private var _randomSeed: TensorFlowSeed = randomSeedForTensorFlow()
 
+  /// Whether `randomSeed` was set, rather than drawn at random, in which case the random ops of
+  /// XLA devices use it instead of the RNG state of the device.
+  internal private(set) var isRandomSeedSet = false
+
   /// The random number generator.
   internal var randomNumberGenerator: AnyRandomNumberGenerator =
     AnyRandomNumberGenerator(PhiloxRandomNumberGenerator(uint64Seed: UInt64(time(nil))))
@@ -218,3 +218,17 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
     (toFullPrecision, { $0.toReducedPrecision })
   }
 }
+
+/// Automatic mixed precision, applied by the XLA backend when lowering traced graphs.
+///
+/// When enabled, matrix multiplications and convolutions run with `BFloat16` operands, while
+/// reductions, softmax and losses are kept in `Float`. Unlike `toReducedPrecision`, the tensors
+/// keep their full precision physical type, so there is no need to convert the model before each
+/// step, or its gradients after it.
+public enum AutomaticMixedPrecision {
+  /// Whether automatic mixed precision is applied to the graphs compiled from now on.
+  public static var isEnabled: Bool {
+    get { GetAutoMixedPrecision() }
+    set { SetAutoMixedPrecision(newValue) }
+  }
+}
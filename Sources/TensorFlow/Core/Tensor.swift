@@ -255,8 +255,13 @@ extension Tensor {
       The shape requires \(shape.contiguousSize) scalars but \(scalars.count) were \
       provided.
       """)
-    self = scalars.withUnsafeBufferPointer { bufferPointer in
-      Tensor(shape: shape, scalars: bufferPointer, on: device)
+    switch device.backend {
+    case .XLA:
+      self.init(_xlaScalars: scalars, shape: shape, on: device)
+    case .TF_EAGER:
+      self = scalars.withUnsafeBufferPointer { bufferPointer in
+        Tensor(shape: shape, scalars: bufferPointer, on: device)
+      }
     }
   }
 
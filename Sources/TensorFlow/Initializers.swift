@@ -396,6 +396,18 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
 // Random
 //===------------------------------------------------------------------------------------------===//
 
+/// Returns the seeds of a stateless random op. Unless a seed is given, or was set in
+/// `Context.local.randomSeed`, XLA devices draw the seeds from their RNG state within the
+/// computation, so that no new seed is uploaded at every step.
+fileprivate func statelessRandomSeeds(_ seed: TensorFlowSeed?, on device: Device) -> Tensor<Int32>
+{
+  if seed == nil && device.backend == .XLA && !Context.local.isRandomSeedSet {
+    return _Raw.randomSeeds(on: device)
+  }
+  let seed = seed ?? Context.local.randomSeed
+  return Tensor<Int32>([seed.graph, seed.op], on: device)
+}
+
 extension Tensor where Scalar: TensorFlowIndex {
   /// Creates a tensor with the specified shape, randomly sampling scalar values from a uniform 
   /// distribution between `lowerBound` and `upperBound`.
@@ -404,19 +416,20 @@ extension Tensor where Scalar: TensorFlowIndex {
   ///   - shape: The dimensions of the tensor.
   ///   - lowerBound: The lower bound of the distribution.
   ///   - upperBound: The upper bound of the distribution.
-  ///   - seed: The seed value.
+  ///   - seed: The seed value. By default, the seeds of XLA devices are drawn from their RNG
+  ///     state, unless `Context.local.randomSeed` was set, which the other devices always use.
   public init(
     randomUniform shape: TensorShape,
     lowerBound: Tensor<Scalar>? = nil,
     upperBound: Tensor<Scalar>? = nil,
-    seed: TensorFlowSeed = Context.local.randomSeed,
+    seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let lowerBound = lowerBound ?? Tensor<Scalar>(0, on: device)
     let upperBound = upperBound ?? Tensor<Scalar>(1, on: device)
     self = _Raw.statelessRandomUniformInt(
       shape: Tensor<Int32>((0..<shape.rank).map { Int32(shape[$0]) }, on: device),
-      seed: Tensor<Int32>([seed.graph, seed.op], on: device),
+      seed: statelessRandomSeeds(seed, on: device),
       minval: lowerBound,
       maxval: upperBound)
   }
@@ -430,19 +443,20 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - lowerBound: The lower bound of the distribution.
   ///   - upperBound: The upper bound of the distribution.
-  ///   - seed: The seed value.
+  ///   - seed: The seed value. By default, the seeds of XLA devices are drawn from their RNG
+  ///     state, unless `Context.local.randomSeed` was set, which the other devices always use.
   public init(
     randomUniform shape: TensorShape,
     lowerBound: Tensor<Scalar>? = nil,
     upperBound: Tensor<Scalar>? = nil,
-    seed: TensorFlowSeed = Context.local.randomSeed,
+    seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let lowerBound = lowerBound ?? Tensor<Scalar>(0, on: device)
     let upperBound = upperBound ?? Tensor<Scalar>(1, on: device)
     let sample: Tensor<Scalar> = _Raw.statelessRandomUniform(
       shape: Tensor<Int32>((0..<shape.rank).map { Int32(shape[$0]) }, on: device),
-      seed: Tensor<Int32>([seed.graph, seed.op], on: device))
+      seed: statelessRandomSeeds(seed, on: device))
     self = (upperBound - lowerBound) * sample + lowerBound
   }
 
@@ -453,17 +467,18 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - mean: The mean of the distribution.
   ///   - standardDeviation: The standard deviation of the distribution.
-  ///   - seed: The seed value.
+  ///   - seed: The seed value. By default, the seeds of XLA devices are drawn from their RNG
+  ///     state, unless `Context.local.randomSeed` was set, which the other devices always use.
   public init(
     randomNormal shape: TensorShape,
     mean: Tensor<Scalar>? = nil,
     standardDeviation: Tensor<Scalar>? = nil,
-    seed: TensorFlowSeed = Context.local.randomSeed,
+    seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let sample: Tensor<Scalar> = _Raw.statelessRandomNormal(
       shape: Tensor<Int32>((0..<shape.rank).map { Int32(shape[$0]) }, on: device),
-      seed: Tensor<Int32>([seed.graph, seed.op], on: device))
+      seed: statelessRandomSeeds(seed, on: device))
     self =
       (standardDeviation ?? Tensor<Scalar>(1, on: device)) * sample
       + (mean ?? Tensor<Scalar>(0, on: device))
@@ -476,17 +491,18 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - mean: The mean of the distribution.
   ///   - standardDeviation: The standard deviation of the distribution.
-  ///   - seed: The seed value.
+  ///   - seed: The seed value. By default, the seeds of XLA devices are drawn from their RNG
+  ///     state, unless `Context.local.randomSeed` was set, which the other devices always use.
   public init(
     randomTruncatedNormal shape: TensorShape,
     mean: Tensor<Scalar>? = nil,
     standardDeviation: Tensor<Scalar>? = nil,
-    seed: TensorFlowSeed = Context.local.randomSeed,
+    seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let sample: Tensor<Scalar> = _Raw.statelessTruncatedNormal(
       shape: Tensor<Int32>((0..<shape.rank).map { Int32(shape[$0]) }, on: device),
-      seed: Tensor<Int32>([seed.graph, seed.op], on: device))
+      seed: statelessRandomSeeds(seed, on: device))
     self =
       (standardDeviation ?? Tensor<Scalar>(1, on: device)) * sample
       + (mean ?? Tensor<Scalar>(0, on: device))
@@ -559,7 +575,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    glorotUniform shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    glorotUniform shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, fanOut) = shape.fans()
@@ -581,7 +597,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    glorotNormal shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    glorotNormal shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, fanOut) = shape.fans()
@@ -612,7 +628,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    heUniform shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    heUniform shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, _) = shape.fans()
@@ -634,7 +650,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    heNormal shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    heNormal shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, _) = shape.fans()
@@ -664,7 +680,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    leCunUniform shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    leCunUniform shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, _) = shape.fans()
@@ -685,7 +701,7 @@ extension Tensor where Scalar: TensorFlowFloatingPoint {
   ///   - shape: The dimensions of the tensor.
   ///   - seed: The seed value.
   public init(
-    leCunNormal shape: TensorShape, seed: TensorFlowSeed = Context.local.randomSeed,
+    leCunNormal shape: TensorShape, seed: TensorFlowSeed? = nil,
     on device: Device = .default
   ) {
     let (fanIn, _) = shape.fans()
@@ -147,6 +147,8 @@ public struct Conv2D<Scalar: TensorFlowFloatingPoint>: Layer {
   @noDerivative public let dilations: (Int, Int)
   /// Note: `useBias` is a workaround for TF-1153: optional differentiation support.
   @noDerivative private let useBias: Bool
+  /// The activation, when it is one of the activations fused with the convolution.
+  @noDerivative private var fusedActivation: FusedActivation? = nil
 
   /// The element-wise activation function type.
   public typealias Activation = @differentiable(reverse) (Tensor<Scalar>) -> Tensor<Scalar>
@@ -203,6 +205,16 @@ public struct Conv2D<Scalar: TensorFlowFloatingPoint>: Layer {
   /// - Note: Padding size equals zero when using `.valid`.
   @differentiable(reverse)
   public func callAsFunction(_ input: Tensor<Scalar>) -> Tensor<Scalar> {
+    if let fusedActivation = fusedActivation, useBias {
+      return conv2D(
+        input,
+        filter: filter,
+        bias: bias,
+        activation: fusedActivation,
+        strides: (1, strides.0, strides.1, 1),
+        padding: padding,
+        dilations: (1, dilations.0, dilations.1, 1))
+    }
     let conv = conv2D(
       input,
       filter: filter,
@@ -249,6 +261,75 @@ extension Conv2D {
       padding: padding,
       dilations: dilations)
   }
+
+  /// Creates a `Conv2D` layer with the specified filter, bias, fused activation, strides,
+  /// dilations and padding. With a bias, the convolution, the bias add and the activation are
+  /// computed by `conv2D(_:filter:bias:activation:strides:padding:dilations:)`, which lowers
+  /// them as a single node on XLA devices.
+  ///
+  /// - Parameters:
+  ///   - filter: The 4-D convolution filter of shape
+  ///     [filter height, filter width, input channel count, output channel count].
+  ///   - bias: The bias vector of shape [output channel count].
+  ///   - activation: The element-wise activation function.
+  ///   - strides: The strides of the sliding window for spatial dimensions, i.e.
+  ///     (stride height, stride width).
+  ///   - padding: The padding algorithm for convolution.
+  ///   - dilations: The dilation factors for spatial dimensions, i.e.
+  ///     (dilation height, dilation width).
+  public init(
+    filter: Tensor<Scalar>,
+    bias: Tensor<Scalar>? = nil,
+    activation: FusedActivation,
+    strides: (Int, Int) = (1, 1),
+    padding: Padding = .valid,
+    dilations: (Int, Int) = (1, 1)
+  ) {
+    self.init(
+      filter: filter,
+      bias: bias,
+      activation: { activation.applied(to: $0) },
+      strides: strides,
+      padding: padding,
+      dilations: dilations)
+    fusedActivation = activation
+  }
+
+  /// Creates a `Conv2D` layer with the specified filter shape, strides, padding, dilations and
+  /// fused activation.
+  ///
+  /// - Parameters:
+  ///   - filterShape: The shape of the 4-D convolution filter, representing
+  ///     (filter height, filter width, input channel count, output channel count).
+  ///   - strides: The strides of the sliding window for spatial dimensions, i.e.
+  ///     (stride height, stride width).
+  ///   - padding: The padding algorithm for convolution.
+  ///   - dilations: The dilation factors for spatial dimensions, i.e.
+  ///     (dilation height, dilation width).
+  ///   - activation: The element-wise activation function.
+  ///   - filterInitializer: Initializer to use for the filter parameters.
+  ///   - biasInitializer: Initializer to use for the bias parameters.
+  public init(
+    filterShape: (Int, Int, Int, Int),
+    strides: (Int, Int) = (1, 1),
+    padding: Padding = .valid,
+    dilations: (Int, Int) = (1, 1),
+    activation: FusedActivation,
+    useBias: Bool = true,
+    filterInitializer: ParameterInitializer<Scalar> = glorotUniform(),
+    biasInitializer: ParameterInitializer<Scalar> = zeros()
+  ) {
+    self.init(
+      filterShape: filterShape,
+      strides: strides,
+      padding: padding,
+      dilations: dilations,
+      activation: { activation.applied(to: $0) },
+      useBias: useBias,
+      filterInitializer: filterInitializer,
+      biasInitializer: biasInitializer)
+    fusedActivation = activation
+  }
 }
 
 /// A 3-D convolution layer for spatial/spatio-temporal convolution over images.
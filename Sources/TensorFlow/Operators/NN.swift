@@ -158,6 +158,185 @@ func _vjpConv2D<Scalar: TensorFlowFloatingPoint>(
   )
 }
 
+/// A pointwise activation which can be fused with a convolution and its bias add.
+public enum FusedActivation {
+  case relu
+  case relu6
+  /// The tanh approximation of GELU, like `gelu(_:)`.
+  case gelu
+  case swish
+
+  /// The activation of the fused XLA node.
+  var xlaActivation: _RawXLA.ConvActivation {
+    switch self {
+    case .relu: return .relu
+    case .relu6: return .relu6
+    case .gelu: return .gelu
+    case .swish: return .swish
+    }
+  }
+
+  /// Applies the activation to `x`, without fusing it.
+  @differentiable(reverse, wrt: x)
+  func applied<Scalar: TensorFlowFloatingPoint>(to x: Tensor<Scalar>) -> Tensor<Scalar> {
+    switch self {
+    case .relu: return relu(x)
+    case .relu6: return relu6(x)
+    case .gelu: return gelu(x)
+    case .swish: return swish(x)
+    }
+  }
+}
+
+/// Returns `activation(conv2D(input, filter: filter, ...) + bias)`.
+///
+/// On XLA devices, the convolution, the bias add and the activation are traced as a single node,
+/// and the backward pass reuses the activation gradient computed by the forward pass. Other
+/// devices, and `.same` padding which isn't the same on both sides, use the unfused ops.
+///
+/// - Parameters:
+///   - input: The input.
+///   - filter: The convolution filter.
+///   - bias: The bias, with one element per output channel.
+///   - activation: The activation applied to the biased convolution.
+///   - strides: The strides of the sliding filter for each dimension of the input.
+///   - padding: The padding for the operation
+///   - dilations: The dilation factor for each dimension of the input.
+/// - Precondition: `input` must have rank `4`.
+/// - Precondition: `filter` must have rank 4.
+@differentiable(reverse, wrt: (input, filter, bias))
+public func conv2D<Scalar: TensorFlowFloatingPoint>(
+  _ input: Tensor<Scalar>,
+  filter: Tensor<Scalar>,
+  bias: Tensor<Scalar>,
+  activation: FusedActivation,
+  strides: (Int, Int, Int, Int) = (1, 1, 1, 1),
+  padding: Padding = .valid,
+  dilations: (Int, Int, Int, Int) = (1, 1, 1, 1)
+) -> Tensor<Scalar> {
+  if let fused = FusedConv2D(
+    input, filter: filter, bias: bias, strides: strides, padding: padding, dilations: dilations)
+  {
+    return fused.apply(input, filter: filter, bias: bias, activation: activation).output
+  }
+  return activation.applied(
+    to: conv2D(input, filter: filter, strides: strides, padding: padding, dilations: dilations)
+      + bias)
+}
+
+@usableFromInline
+@derivative(of: conv2D(_:filter:bias:activation:strides:padding:dilations:))
+func _vjpConv2D<Scalar: TensorFlowFloatingPoint>(
+  _ input: Tensor<Scalar>,
+  filter: Tensor<Scalar>,
+  bias: Tensor<Scalar>,
+  activation: FusedActivation,
+  strides: (Int, Int, Int, Int),
+  padding: Padding,
+  dilations: (Int, Int, Int, Int)
+) -> (
+  value: Tensor<Scalar>,
+  pullback: (Tensor<Scalar>) -> (Tensor<Scalar>, Tensor<Scalar>, Tensor<Scalar>)
+) {
+  guard
+    let fused = FusedConv2D(
+      input, filter: filter, bias: bias, strides: strides, padding: padding,
+      dilations: dilations)
+  else {
+    return valueWithPullback(at: input, filter, bias) { input, filter, bias in
+      activation.applied(
+        to: conv2D(input, filter: filter, strides: strides, padding: padding, dilations: dilations)
+          + bias)
+    }
+  }
+  let (value, activationGrad) = fused.apply(
+    input, filter: filter, bias: bias, activation: activation)
+  return (
+    value,
+    { v in
+      fused.gradients(v, input: input, filter: filter, activationGrad: activationGrad)
+    }
+  )
+}
+
+/// The parameters of a `conv2D(_:filter:bias:activation:strides:padding:dilations:)` lowered as
+/// a single XLA node, which takes a channels-first input and an `[out, in, height, width]`
+/// filter. The transposes to and from the NHWC layout are folded by XLA.
+struct FusedConv2D {
+  let strides: [Int64]
+  let padding: [Int64]
+  let dilations: [Int64]
+  let groups: Int64
+
+  /// Returns nil when the convolution can't be fused: off XLA devices, when the batch or channel
+  /// strides or dilations aren't 1, and when the `.same` padding differs between both sides.
+  init?<Scalar: TensorFlowFloatingPoint>(
+    _ input: Tensor<Scalar>,
+    filter: Tensor<Scalar>,
+    bias: Tensor<Scalar>,
+    strides: (Int, Int, Int, Int),
+    padding: Padding,
+    dilations: (Int, Int, Int, Int)
+  ) {
+    precondition(input.shape.rank == 4, "The input must have rank 4.")
+    precondition(filter.shape.rank == 4, "The filter must have rank 4.")
+    guard input.handle.backend == .XLA, bias.shape.rank == 1,
+      strides.0 == 1, strides.3 == 1, dilations.0 == 1, dilations.3 == 1,
+      input.shape[3] % filter.shape[2] == 0
+    else { return nil }
+    var spatialPadding: [Int64] = []
+    for (i, (stride, dilation)) in [(strides.1, dilations.1), (strides.2, dilations.2)]
+      .enumerated()
+    {
+      guard padding == .same else {
+        spatialPadding.append(0)
+        continue
+      }
+      let inputSize = input.shape[1 + i]
+      let filterSize = (filter.shape[i] - 1) * dilation + 1
+      let outputSize = (inputSize + stride - 1) / stride
+      let totalPadding = max((outputSize - 1) * stride + filterSize - inputSize, 0)
+      guard totalPadding % 2 == 0 else { return nil }
+      spatialPadding.append(Int64(totalPadding / 2))
+    }
+    self.strides = [Int64(strides.1), Int64(strides.2)]
+    self.padding = spatialPadding
+    self.dilations = [Int64(dilations.1), Int64(dilations.2)]
+    self.groups = Int64(input.shape[3] / filter.shape[2])
+  }
+
+  func apply<Scalar: TensorFlowFloatingPoint>(
+    _ input: Tensor<Scalar>,
+    filter: Tensor<Scalar>,
+    bias: Tensor<Scalar>,
+    activation: FusedActivation
+  ) -> (output: Tensor<Scalar>, activationGrad: AnyTensor) {
+    let result = _RawXLA.convBiasActivation(
+      input.transposed(permutation: 0, 3, 1, 2),
+      filter: filter.transposed(permutation: 3, 2, 0, 1), bias: bias, strides: strides,
+      padding: padding, dilations: dilations, groups: groups,
+      activation: activation.xlaActivation)
+    return (result.output.transposed(permutation: 0, 2, 3, 1), result.activationGrad)
+  }
+
+  func gradients<Scalar: TensorFlowFloatingPoint>(
+    _ gradOutput: Tensor<Scalar>,
+    input: Tensor<Scalar>,
+    filter: Tensor<Scalar>,
+    activationGrad: AnyTensor
+  ) -> (Tensor<Scalar>, Tensor<Scalar>, Tensor<Scalar>) {
+    let grads = _RawXLA.convBiasActivationBackward(
+      gradOutput.transposed(permutation: 0, 3, 1, 2),
+      input: input.transposed(permutation: 0, 3, 1, 2),
+      filter: filter.transposed(permutation: 3, 2, 0, 1), activationGrad: activationGrad,
+      strides: strides, padding: padding, dilations: dilations, groups: groups)
+    return (
+      grads.input.transposed(permutation: 0, 2, 3, 1),
+      grads.filter.transposed(permutation: 2, 3, 1, 0), grads.bias
+    )
+  }
+}
+
 /// Returns a 2-D transposed convolution with the specified input, filter, strides, and padding.
 ///
 /// - Parameters:
@@ -67,6 +67,12 @@ struct XLATensor {
 }
 
 extension Tensor {
+  /// Creates an XLA tensor which borrows a host copy of `scalars`.
+  @usableFromInline
+  init(_xlaScalars scalars: [Scalar], shape: TensorShape, on device: Device) {
+    self.init(_xla: XLATensor.make(scalars, shape.dimensions, on: device))
+  }
+
   init(_xla: XLATensor) {
     precondition(
       _xla.dtype == Scalar.xlaTensorScalarType,
@@ -89,12 +95,41 @@ extension Tensor {
   }
 }
 
+/// Owns the host storage x10 borrows, which stays at a fixed address until x10 releases it.
+private final class BorrowedScalars<Scalar> {
+  let scalars: UnsafeMutableBufferPointer<Scalar>
+
+  init(_ data: [Scalar]) {
+    scalars = UnsafeMutableBufferPointer<Scalar>.allocate(capacity: data.count)
+    _ = scalars.initialize(from: data)
+  }
+
+  deinit {
+    scalars.baseAddress!.deinitialize(count: scalars.count)
+    scalars.deallocate()
+  }
+}
+
 extension XLATensor {
-  /// TODO(parkers): Add support for other types and aliasing.
+  /// Creates a tensor which borrows a host copy of `data` rather than having x10 copy it again.
+  /// The copy is released once x10 no longer needs it, at the latest after the device upload.
   static func make<Scalar: XLAScalarType>(
     _ data: [Scalar], _ dims: [Int], on device: Device = Device.default
   ) -> XLATensor {
-    data.withUnsafeBufferPointer { data in return make(data, dims, on: device) }
+    if data.isEmpty {
+      return data.withUnsafeBufferPointer { data in return make(data, dims, on: device) }
+    }
+    let box = BorrowedScalars(data)
+    let releaseContext = Unmanaged.passRetained(box as AnyObject).toOpaque()
+    return dims.withUnsafeBufferPointer { dims in
+      XLATensor(
+        _handle:
+          createTensorFromBorrowedBuffer(
+            Scalar.xlaTensorScalarType, box.scalars.baseAddress, box.scalars.count,
+            dims.baseAddress, dims.count, device.cdevice,
+            { context in Unmanaged<AnyObject>.fromOpaque(context!).release() },
+            releaseContext))
+    }
   }
 
   static func make<Scalar: XLAScalarType>(_ data: Scalar, on device: Device = Device.default)
@@ -134,12 +169,33 @@ extension XLATensor {
   )
     -> XLATensor
   {
-    dims.withUnsafeBufferPointer { dims in
+    if toReducedPrecision {
+      precondition(
+        Scalar.self == Float.self, "Reduced precision is only supported for Float tensors")
+      return make(data, dims, physicalType: XLATensorScalarType_BFloat16, directlyOn: device)
+    }
+    return dims.withUnsafeBufferPointer { dims in
       return XLATensor(
         _handle:
           copyTensorAndMakeResident(
             Scalar.xlaTensorScalarType, data.baseAddress, data.count, dims.baseAddress, dims.count,
-            device.cdevice, toReducedPrecision
+            device.cdevice, false
+          ))
+    }
+  }
+
+  /// Uploads `data` right away as a device tensor of `physicalType` elements, converting the
+  /// values while staging the transfer, so that no cast is needed on the device.
+  static func make<Scalar: XLAScalarType>(
+    _ data: UnsafeBufferPointer<Scalar>, _ dims: [Int], physicalType: XLATensorScalarType,
+    directlyOn device: Device = Device.default
+  ) -> XLATensor {
+    dims.withUnsafeBufferPointer { dims in
+      return XLATensor(
+        _handle:
+          copyTensorWithPhysicalType(
+            Scalar.xlaTensorScalarType, data.baseAddress, data.count, dims.baseAddress, dims.count,
+            device.cdevice, physicalType
           ))
     }
   }
@@ -171,6 +227,31 @@ extension XLATensor {
     return (data: data, dims: dims)
   }
 
+  /// Fetches the values of all `tensors` with a single graph execution and a single batched
+  /// transfer per device.
+  static func fetchTensorValues<Scalar: XLAScalarType>(
+    _ tensors: [XLATensor], _ t: Scalar.Type
+  ) -> [[Scalar]] {
+    defer { _fixLifetime(tensors) }
+    return withValueBuffers(tensors, Scalar.self) { buffers, sizes in
+      tensors.withArrayRef { tensorsRef in
+        XLATensor_materializeMany(tensorsRef, buffers, sizes)
+      }
+    }
+  }
+
+  /// Allocates host buffers for the values of `tensors`, calls `fill` to populate them, and
+  /// returns their contents.
+  static func withValueBuffers<Scalar: XLAScalarType>(
+    _ tensors: [XLATensor], _ t: Scalar.Type,
+    _ fill: (_ buffers: [UnsafeMutableRawPointer?], _ sizes: [Int]) -> Void
+  ) -> [[Scalar]] {
+    let valueBuffers = ValueBuffers(tensors, Scalar.self)
+    defer { valueBuffers.deallocate() }
+    fill(valueBuffers.buffers, valueBuffers.sizes)
+    return valueBuffers.values
+  }
+
   var dtype: XLATensorScalarType {
     defer { _fixLifetime(self) }
     return XLATensor_dtype(handle)
@@ -181,6 +262,44 @@ extension XLATensor {
   }
 }
 
+/// Host buffers, one per tensor, to fetch the values of a group of tensors into.
+struct ValueBuffers<Scalar: XLAScalarType> {
+  private let storage: UnsafeMutableBufferPointer<Scalar>
+  private let counts: [Int]
+  let buffers: [UnsafeMutableRawPointer?]
+
+  init(_ tensors: [XLATensor], _ t: Scalar.Type) {
+    for tensor in tensors {
+      precondition(
+        tensor.dtype == Scalar.xlaTensorScalarType,
+        "Types mismatch when fetching tensor values.")
+    }
+    counts = tensors.map { $0.shape.reduce(1, *) }
+    storage = UnsafeMutableBufferPointer<Scalar>.allocate(capacity: max(counts.reduce(0, +), 1))
+    var buffers = [UnsafeMutableRawPointer?]()
+    var offset = 0
+    for count in counts {
+      buffers.append(UnsafeMutableRawPointer(storage.baseAddress! + offset))
+      offset += count
+    }
+    self.buffers = buffers
+  }
+
+  /// The sizes of the buffers, in bytes.
+  var sizes: [Int] { counts.map { $0 * MemoryLayout<Scalar>.stride } }
+
+  /// The current contents of the buffers.
+  var values: [[Scalar]] {
+    var offset = 0
+    return counts.map { count in
+      defer { offset += count }
+      return Array(UnsafeBufferPointer(rebasing: storage[offset..<offset + count]))
+    }
+  }
+
+  func deallocate() { storage.deallocate() }
+}
+
 extension Array where Element == Int64 {
   func withArrayRef<Result>(_ body: (Int64ArrayRef) throws -> Result) rethrows -> Result {
     return try withUnsafeBufferPointer { buf in
@@ -241,6 +360,78 @@ extension Tensor {
   }
 }
 
+extension Tensor {
+  /// Returns the scalars of all `tensors`. XLA tensors are materialized together, with a single
+  /// graph execution and a single transfer per device.
+  public static func scalars(of tensors: [Tensor]) -> [[Scalar]] {
+    guard tensors.allSatisfy({ $0.handle.backend == .XLA }) else {
+      return tensors.map { $0.scalars }
+    }
+    return XLATensor.fetchTensorValues(tensors.map { $0.xlaTensor }, Scalar.self)
+  }
+}
+
+/// The scalars of a group of tensors, which are being fetched in background.
+///
+/// Returned by `Tensor.scalarsAsync(of:)`. The device computations producing the values are
+/// already scheduled, so the host can keep tracing the next step while they complete.
+public final class PendingScalars<Scalar: TensorFlowScalar> {
+  private var handle: UnsafeMutablePointer<OpaqueMaterializeHandle>?
+  /// The buffers the values are transferred into, which must outlive `handle`.
+  private var valueBuffers: ValueBuffers<Scalar>?
+  private var values: [[Scalar]]?
+
+  init(xlaTensors tensors: [XLATensor]) {
+    let valueBuffers = ValueBuffers(tensors, Scalar.self)
+    self.valueBuffers = valueBuffers
+    self.handle = tensors.withArrayRef { tensorsRef in
+      XLATensor_materializeAsync(tensorsRef, valueBuffers.buffers, valueBuffers.sizes)
+    }
+  }
+
+  init(values: [[Scalar]]) {
+    self.values = values
+  }
+
+  deinit {
+    if let handle = handle {
+      destroyMaterializeHandle(handle)
+    }
+    valueBuffers?.deallocate()
+  }
+
+  /// Whether the values are available, in which case `wait()` does not block.
+  public var isReady: Bool {
+    guard let handle = handle else { return true }
+    return MaterializeHandle_isReady(handle)
+  }
+
+  /// Blocks until the values are available, and returns them.
+  public func wait() -> [[Scalar]] {
+    if let values = values { return values }
+    MaterializeHandle_wait(handle!)
+    destroyMaterializeHandle(handle!)
+    handle = nil
+    let result = valueBuffers!.values
+    valueBuffers!.deallocate()
+    valueBuffers = nil
+    values = result
+    return result
+  }
+}
+
+extension Tensor {
+  /// Starts fetching the scalars of all `tensors` without blocking, and returns a handle which
+  /// can be polled or waited on for the values. XLA tensors are materialized together, like in
+  /// `scalars(of:)`, while tensors on other backends are fetched right away.
+  public static func scalarsAsync(of tensors: [Tensor]) -> PendingScalars<Scalar> {
+    guard tensors.allSatisfy({ $0.handle.backend == .XLA }) else {
+      return PendingScalars(values: tensors.map { $0.scalars })
+    }
+    return PendingScalars(xlaTensors: tensors.map { $0.xlaTensor })
+  }
+}
+
 extension Array where Element == AnyTensor {
   func withArrayRef<Result>(_ body: (OpaqueXLATensorArrayRef) throws -> Result) rethrows -> Result {
     try self.map { $0.scalarType.unwrapTensor($0) }.withArrayRef { try body($0) }
@@ -258,6 +449,27 @@ extension TensorFlowScalar {
     return Tensor<Self>(
       _xlaHandle: XLATensor_makePlaceholder((t as! Tensor<Self>).xlaHandle, Int32(i)))
   }
+  /// Returns `t[index]`, where `index` is a scalar tensor which can depend on a loop index.
+  static func dynamicIndex(_ t: AnyTensor, _ index: Tensor<Int32>) -> AnyTensor {
+    let base = t as! Tensor<Self>
+    let zero = Tensor<Int32>(0, on: base.device)
+    let startIndices = [index] + Array(repeating: zero, count: base.rank - 1)
+    let sliceShapes: [Int64] = [1] + base.shape.dimensions.dropFirst().map { Int64($0) }
+    let slice = startIndices.withArrayRef { startIndices in
+      sliceShapes.withArrayRef { sliceShapes in
+        Tensor<Self>(
+          _xlaHandle: XLATensor_dynamic_slice(base.xlaHandle, startIndices, sliceShapes))
+      }
+    }
+    return Tensor<Self>(_xlaHandle: XLATensor_squeeze(slice.xlaHandle, 0))
+  }
+  static func device(of t: AnyTensor) -> Device {
+    return (t as! Tensor<Self>).device
+  }
+  static func add(_ a: AnyTensor, _ b: AnyTensor) -> AnyTensor {
+    return Tensor<Self>(
+      _xlaHandle: XLATensor_add((a as! Tensor<Self>).xlaHandle, (b as! Tensor<Self>).xlaHandle))
+  }
 }
 
 extension _RawXLA {
@@ -297,10 +509,96 @@ extension _RawXLA {
       n: n, initial: initial, placeholders: placeholders,
       indexPlaceholder: i, results: results)
   }
+
+  /// Runs `length` iterations of `body` as a single device loop, without unrolling it.
+  ///
+  /// `body` is traced once. It takes the carried values and the slices `xs[j][i]` of the stacked
+  /// inputs for iteration `i`, and returns the new carried values and the outputs of the
+  /// iteration. The outputs of all iterations are returned stacked along a new leading
+  /// dimension, at the index of the iteration that produced them. When `reverse` is true the
+  /// iterations run from `length - 1` down to `0`, as needed to backpropagate through a scan.
+  public static func scan(
+    length: Int, initial: [AnyTensor], xs: [AnyTensor] = [], reverse: Bool = false,
+    body: (_ carry: [AnyTensor], _ x: [AnyTensor]) -> (carry: [AnyTensor], outputs: [AnyTensor])
+  ) -> (carry: [AnyTensor], outputs: [AnyTensor]) {
+    precondition(!(initial + xs).isEmpty, "Scan without any carry or input")
+    let first = (initial + xs)[0]
+    let device = first.scalarType.device(of: first)
+    var idx = 0
+    let placeholders = initial.map { (v: AnyTensor) -> AnyTensor in
+      idx += 1
+      return v.scalarType.makePlaceholder(v, i: idx)
+    }
+    let index = Tensor<Int32>(0, on: device).placeholder
+    let x = xs.map { $0.scalarType.dynamicIndex($0, index) }
+    let (results, outputs) = body(placeholders, x)
+    precondition(
+      results.count == initial.count,
+      "Scan body returned \(results.count) carried values, expected \(initial.count)")
+    return initial.withArrayRef { initialHandles in
+      placeholders.withArrayRef { placeholderHandles in
+        results.withArrayRef { resultHandles in
+          outputs.withArrayRef { outputHandles in
+            let tensorListHandle = XLATensor_scan(
+              Int64(length), reverse, initialHandles, placeholderHandles, index.xlaHandle,
+              resultHandles, outputHandles)
+            defer { destroyOpaqueXLATensorArrayRef(tensorListHandle) }
+            let all = (0..<tensorListHandle.size).map { i -> AnyTensor in
+              let template = i < results.count ? results[i] : outputs[i - results.count]
+              return template.scalarType.wrapTensor(XLATensor(_handle: tensorListHandle.data[i]!))
+            }
+            return (Array(all[0..<results.count]), Array(all[results.count...]))
+          }
+        }
+      }
+    }
+  }
+
+  /// Runs `steps` iterations of a traced training step as a single device loop.
+  ///
+  /// `body` is traced once, taking the current `state` (weights and optimizer state) and the
+  /// batch of the iteration, and returning the new state and the metrics of the step. The
+  /// batch of iteration `i` is `inputQueue[j][i]` for every tensor `j` of the input queue, so
+  /// every tensor of `inputQueue` must already be on device and have a leading dimension of at
+  /// least `steps`. Step metrics are summed into the `metrics` accumulators inside the loop.
+  ///
+  /// The whole loop is a single `xla::While`, so the host only takes part once every `steps`
+  /// iterations, when the returned tensors are materialized.
+  public static func multiStepLoop(
+    steps: Int, state: [AnyTensor], metrics: [AnyTensor] = [], inputQueue: [AnyTensor],
+    body: (_ state: [AnyTensor], _ batch: [AnyTensor]) -> (state: [AnyTensor], metrics: [AnyTensor])
+  ) -> (state: [AnyTensor], metrics: [AnyTensor]) {
+    precondition(!state.isEmpty || !metrics.isEmpty, "Training loop without any state")
+    let first = (state + metrics)[0]
+    let device = first.scalarType.device(of: first)
+    let results = functionalWhile(
+      n: Tensor<Int32>(Int32(steps), on: device), initial: state + metrics
+    ) { args, i in
+      let batch = inputQueue.map { $0.scalarType.dynamicIndex($0, i) }
+      let stepResult = body(Array(args[0..<state.count]), batch)
+      precondition(
+        stepResult.state.count == state.count,
+        "Training step returned \(stepResult.state.count) state tensors, expected \(state.count)")
+      precondition(
+        stepResult.metrics.count == metrics.count,
+        "Training step returned \(stepResult.metrics.count) metrics, expected \(metrics.count)")
+      let accumulated = zip(args[state.count...], stepResult.metrics).map {
+        $0.scalarType.add($0, $1)
+      }
+      return stepResult.state + accumulated
+    }
+    return (Array(results[0..<state.count]), Array(results[state.count...]))
+  }
 }
 
 /// Add more op wrappers here:
 extension XLATensor {
+  static func allFinite(_ tensors: [XLATensor]) -> XLATensor {
+    tensors.withArrayRef { tensors in
+      XLATensor(_handle: XLATensor_all_finite(tensors))
+    }
+  }
+
   static func annotate(_ a: XLATensor, _ annotation: String) -> XLATensor {
     return XLATensor(_handle: XLATensor_annotate(a.handle, annotation))
   }
@@ -355,6 +653,64 @@ extension XLATensor {
     return (XLATensor(_handle: output.x), XLATensor(_handle: output.y))
   }
 
+  static func convBiasActivation(
+    _ input: XLATensor, _ kernel: XLATensor, _ bias: XLATensor, _ stride: [Int64],
+    _ padding: [Int64], _ dilation: [Int64], _ transposed: Bool, _ outputPadding: [Int64],
+    _ groups: Int64, _ activation: XLAConvActivation
+  ) -> (output: XLATensor, activationGrad: XLATensor) {
+    defer { _fixLifetime(input) }
+    defer { _fixLifetime(kernel) }
+    defer { _fixLifetime(bias) }
+    return stride.withArrayRef { stride in
+      padding.withArrayRef { padding in
+        dilation.withArrayRef { dilation in
+          outputPadding.withArrayRef { outputPadding in
+            let tensorListHandle = XLATensor_conv_bias_activation(
+              input.handle, kernel.handle, bias.handle, stride, padding, dilation, transposed,
+              outputPadding, groups, activation)
+            defer {
+              destroyOpaqueXLATensorArrayRef(tensorListHandle)
+            }
+            return (
+              XLATensor(_handle: tensorListHandle.data[0]!),
+              XLATensor(_handle: tensorListHandle.data[1]!)
+            )
+          }
+        }
+      }
+    }
+  }
+
+  static func convBiasActivationBackward(
+    _ gradOutput: XLATensor, _ input: XLATensor, _ kernel: XLATensor,
+    _ activationGrad: XLATensor, _ stride: [Int64], _ padding: [Int64], _ dilation: [Int64],
+    _ transposed: Bool, _ outputPadding: [Int64], _ groups: Int64
+  ) -> (input: XLATensor, kernel: XLATensor, bias: XLATensor) {
+    defer { _fixLifetime(gradOutput) }
+    defer { _fixLifetime(input) }
+    defer { _fixLifetime(kernel) }
+    defer { _fixLifetime(activationGrad) }
+    return stride.withArrayRef { stride in
+      padding.withArrayRef { padding in
+        dilation.withArrayRef { dilation in
+          outputPadding.withArrayRef { outputPadding in
+            let tensorListHandle = XLATensor_conv_bias_activation_backward(
+              gradOutput.handle, input.handle, kernel.handle, activationGrad.handle, stride,
+              padding, dilation, transposed, outputPadding, groups)
+            defer {
+              destroyOpaqueXLATensorArrayRef(tensorListHandle)
+            }
+            return (
+              XLATensor(_handle: tensorListHandle.data[0]!),
+              XLATensor(_handle: tensorListHandle.data[1]!),
+              XLATensor(_handle: tensorListHandle.data[2]!)
+            )
+          }
+        }
+      }
+    }
+  }
+
   static func crossReplicaSum(_ inputs: [XLATensor], _ scale: Double) -> [XLATensor] {
     inputs.withArrayRef { inputs in
       let tensorListHandle = XLATensor_cross_replica_sum(inputs, scale)
@@ -432,6 +788,30 @@ extension XLATensor {
     }
   }
 
+  static func optimizerUpdate(
+    _ type: XLAOptimizerUpdateType, nesterov: Bool, weightDecay: Bool,
+    hyperparameters: [XLATensor], weights: [XLATensor], grads: [XLATensor],
+    states: [XLATensor]
+  ) -> (steps: [XLATensor], states: [XLATensor]) {
+    hyperparameters.withArrayRef { hyperparameters in
+      weights.withArrayRef { weightsRef in
+        grads.withArrayRef { grads in
+          states.withArrayRef { states in
+            let tensorListHandle = XLATensor_optimizer_update(
+              type, nesterov, weightDecay, hyperparameters, weightsRef, grads, states)
+            defer {
+              destroyOpaqueXLATensorArrayRef(tensorListHandle)
+            }
+            let results = (0..<tensorListHandle.size).map { i in
+              XLATensor(_handle: tensorListHandle.data[i]!)
+            }
+            return (Array(results[..<weights.count]), Array(results[weights.count...]))
+          }
+        }
+      }
+    }
+  }
+
   static func replica_id(_ device: Device) -> XLATensor {
     return XLATensor(_handle: XLATensor_replica_id(device.cdevice))
   }
@@ -490,8 +870,30 @@ extension XLATensor {
       XLATensor(_handle: XLATensor_rand(dims, seed))
     }
   }
+
+  static func rngSeeds(_ device: Device) -> XLATensor {
+    return XLATensor(_handle: XLATensor_rng_seeds(device.cdevice))
+  }
+
+  static func rngState(_ device: Device) -> XLATensor {
+    return XLATensor(_handle: XLATensor_get_rng_state(device.cdevice))
+  }
+
+  static func setRngState(_ device: Device, _ state: XLATensor) {
+    defer { _fixLifetime(state) }
+    XLATensor_set_rng_state(device.cdevice, state.handle)
+  }
+
+  static func setRngSeed(_ device: Device, _ seed: UInt64) {
+    XLATensor_set_rng_seed(device.cdevice, seed)
+  }
 }
 
 public func PrintX10Metrics() {
   PrintMetrics()
 }
+
+/// Returns the current value of the named x10 counter, or 0 if it was never incremented.
+public func X10CounterValue(_ name: String) -> Int {
+  return Int(GetMetricsCounterValue(name))
+}
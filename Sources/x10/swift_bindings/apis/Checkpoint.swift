@@ -0,0 +1,88 @@
+// Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+@_implementationOnly import x10_xla_tensor_wrapper
+
+/// A set of named tensors stored in the native x10 checkpoint format.
+///
+/// The file holds an index of the tensors followed by their page aligned data. Loading memory maps
+/// the file and uploads the tensors in batches straight out of the mapping, while saving downloads
+/// the tensors in batches and writes them in parallel.
+public struct XLACheckpoint {
+  private var tensors: [String: XLATensor] = [:]
+
+  /// Creates an empty checkpoint.
+  public init() {}
+
+  /// Loads the checkpoint stored at `path`, placing its tensors on `device`.
+  public init(contentsOf path: String, on device: Device = .default) {
+    let checkpoint = XLACheckpoint_load(path, device.cdevice)!
+    defer { destroyXLACheckpoint(checkpoint) }
+    for i in 0..<XLACheckpoint_size(checkpoint) {
+      let name = String(cString: XLACheckpoint_name(checkpoint, i))
+      tensors[name] = XLATensor(_handle: XLACheckpoint_tensor(checkpoint, i))
+    }
+  }
+
+  /// The names of the tensors in the checkpoint, in sorted order.
+  public var names: [String] { tensors.keys.sorted() }
+
+  /// The tensor named `name`, or nil if there is no such tensor. Accessing a tensor with a
+  /// different scalar type than the stored one is an error.
+  public subscript<Scalar: TensorFlowScalar>(
+    name: String, as type: Scalar.Type = Scalar.self
+  ) -> Tensor<Scalar>? {
+    get {
+      guard let tensor = tensors[name] else { return nil }
+      precondition(
+        tensor.dtype == Scalar.xlaTensorScalarType,
+        "Checkpoint tensor \(name) has type \(tensor.dtype), not \(Scalar.xlaTensorScalarType)")
+      return Tensor<Scalar>(_xla: tensor)
+    }
+    set { tensors[name] = newValue?.xlaTensor }
+  }
+
+  /// Writes the tensors to `path`.
+  public func save(to path: String) {
+    let names = self.names
+    names.map { tensors[$0]! }.withArrayRef { XLACheckpoint.save($0, names: names, to: path) }
+  }
+
+  /// Writes the XLA `tensors` to `path`, keyed by their names.
+  public static func save(_ tensors: [String: AnyTensor], to path: String) {
+    let names = tensors.keys.sorted()
+    names.map { tensors[$0]! }.withArrayRef { save($0, names: names, to: path) }
+  }
+
+  private static func save(_ tensors: OpaqueXLATensorArrayRef, names: [String], to path: String) {
+    withCStrings(names) { XLACheckpoint_save(path, $0, tensors) }
+  }
+
+  /// Calls `body` with an array of pointers to the nul terminated `strings`.
+  private static func withCStrings<Result>(
+    _ strings: [String], _ body: (UnsafePointer<UnsafePointer<CChar>?>?) -> Result
+  ) -> Result {
+    var chars: [CChar] = []
+    var offsets: [Int] = []
+    for string in strings {
+      offsets.append(chars.count)
+      chars += string.utf8CString
+    }
+    return chars.withUnsafeBufferPointer { chars in
+      offsets.map { Optional(chars.baseAddress! + $0) }.withUnsafeBufferPointer { pointers in
+        body(pointers.baseAddress)
+      }
+    }
+  }
+}
@@ -0,0 +1,78 @@
+// Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+@_implementationOnly import x10_xla_tensor_wrapper
+
+/// A traced computation frozen into a compiled executable.
+///
+/// The tensors the computation reads are split into the inputs, which are bound on every call, and
+/// the frozen tensors, like the model weights, which are captured with their current values.
+/// Calling it skips tracing, graph construction and hashing, and only launches the executable. It
+/// can be saved to a file and loaded back, possibly by another process.
+public final class XLAFrozenComputation {
+  private let computation: OpaquePointer
+
+  /// Compiles the computation of `outputs`. The `inputs` must be tensors created from host
+  /// scalars, like `Tensor(shape:scalars:on:)`, and the `outputs` must be traced from them.
+  public init(inputs: [AnyTensor], outputs: [AnyTensor]) {
+    computation = inputs.withArrayRef { inputs in
+      outputs.withArrayRef { outputs in
+        OpaquePointer(FrozenComputation_create(inputs, outputs)!)
+      }
+    }
+  }
+
+  /// Loads the frozen computation stored at `path`, compiling it for `device`.
+  public init(contentsOf path: String, on device: Device = .default) {
+    computation = OpaquePointer(FrozenComputation_load(path, device.cdevice)!)
+  }
+
+  deinit {
+    destroyFrozenComputation(UnsafeMutablePointer(computation))
+  }
+
+  /// Writes the computation and the values of the frozen tensors to `path`.
+  public func save(to path: String) {
+    FrozenComputation_save(UnsafeMutablePointer(computation), path)
+  }
+
+  /// Runs the computation with `inputs`, which must have the shapes and scalar types of the
+  /// inputs it was created with, and returns its outputs.
+  public func callAsFunction(_ inputs: [AnyTensor]) -> [AnyTensor] {
+    inputs.withArrayRef { inputs in
+      let tensorListHandle = FrozenComputation_execute(
+        UnsafeMutablePointer(computation), inputs)
+      defer { destroyOpaqueXLATensorArrayRef(tensorListHandle) }
+      return (0..<tensorListHandle.size).map { i in
+        let tensor = XLATensor(_handle: tensorListHandle.data[i]!)
+        return Self.scalarType(of: tensor).wrapTensor(tensor)
+      }
+    }
+  }
+
+  private static let scalarTypes: [TensorFlowScalar.Type] = [
+    Float.self, Double.self, Int64.self, Int32.self, Int16.self, Int8.self, UInt8.self, Bool.self,
+  ]
+
+  private static func scalarType(of tensor: XLATensor) -> TensorFlowScalar.Type {
+    guard
+      let type = scalarTypes.first(where: {
+        ($0 as! XLAScalarType.Type).xlaTensorScalarType == tensor.dtype
+      })
+    else {
+      fatalError("Unsupported frozen computation output type: \(tensor.dtype)")
+    }
+    return type
+  }
+}
@@ -0,0 +1,120 @@
+// Copyright 2020 The TensorFlow Authors. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+@_implementationOnly import x10_xla_tensor_wrapper
+
+/// Serves a traced model with dynamic request batching.
+///
+/// The model is traced once for every batch size bucket, and compiled right away. Requests hold a
+/// single example and can be sent from any thread. They are coalesced until the largest bucket is
+/// full or the oldest request has waited `maxLatency` microseconds, padded to the smallest bucket
+/// which fits them, and run through the compiled executable without tracing the model again.
+public final class XLAInferenceEngine {
+  private let engine: OpaquePointer
+  private var scalarTypes: [ObjectIdentifier] = []
+  private var inputScalarCounts: [Int] = []
+  private var outputScalarCounts: [Int] = []
+
+  /// Statistics of a run of the local load generator.
+  public struct LoadStats {
+    public var requests: Int
+    public var seconds: Double
+    /// Requests per second.
+    public var throughput: Double
+    public var p50LatencyMilliseconds: Double
+    public var p99LatencyMilliseconds: Double
+    public var meanBatchSize: Double
+  }
+
+  public init(maxLatency: Int = 2000, on device: Device = .default) {
+    engine = OpaquePointer(InferenceEngine_create(device.cdevice, Int64(maxLatency)))
+  }
+
+  deinit {
+    destroyInferenceEngine(UnsafeMutablePointer(engine))
+  }
+
+  /// Compiles `outputs` for batches of `batchSize` examples. The `inputs` must be tensors created
+  /// from host scalars, like `Tensor(shape:scalars:on:)`, whose leading dimension is `batchSize`,
+  /// and the `outputs` must be traced from them. The other tensors the outputs depend on, like the model
+  /// weights, are captured with their current values.
+  public func addBucket(batchSize: Int, inputs: [AnyTensor], outputs: [AnyTensor]) {
+    let inputCounts = inputs.map { Self.exampleScalarCount(of: $0) }
+    let outputCounts = outputs.map { Self.exampleScalarCount(of: $0) }
+    inputs.withArrayRef { inputs in
+      outputs.withArrayRef { outputs in
+        InferenceEngine_addBucket(
+          UnsafeMutablePointer(engine), Int64(batchSize), inputs, outputs)
+      }
+    }
+    scalarTypes = (inputs + outputs).map { ObjectIdentifier($0.scalarType) }
+    inputScalarCounts = inputCounts
+    outputScalarCounts = outputCounts
+  }
+
+  /// Runs a single example, given the scalars of every input, and returns the scalars of every
+  /// output. All the inputs and outputs must have the `Scalar` type.
+  public func run<Scalar: TensorFlowScalar>(_ inputs: [[Scalar]]) -> [[Scalar]] {
+    precondition(
+      scalarTypes.allSatisfy { $0 == ObjectIdentifier(Scalar.self) },
+      "All the inputs and outputs must have the \(Scalar.self) type")
+    precondition(
+      inputs.map { $0.count } == inputScalarCounts,
+      "Expected inputs of \(inputScalarCounts) scalars")
+    let inputScalars = Array(inputs.joined())
+    let outputScalars = [Scalar](
+      unsafeUninitializedCapacity: outputScalarCounts.reduce(0, +)
+    ) { buffer, initializedCount in
+      inputScalars.withUnsafeBufferPointer { inputBuffer in
+        let inputPointers = Self.offsets(of: inputScalarCounts).map {
+          Optional(UnsafeRawPointer(inputBuffer.baseAddress! + $0))
+        }
+        let outputPointers = Self.offsets(of: outputScalarCounts).map {
+          Optional(UnsafeMutableRawPointer(buffer.baseAddress! + $0))
+        }
+        InferenceEngine_run(UnsafeMutablePointer(engine), inputPointers, outputPointers)
+      }
+      initializedCount = buffer.count
+    }
+    return zip(Self.offsets(of: outputScalarCounts), outputScalarCounts).map {
+      Array(outputScalars[$0..<$0 + $1])
+    }
+  }
+
+  /// Sends `requestsPerClient` requests from each of `clients` threads, one at a time, and
+  /// measures the throughput and the latency of the requests.
+  public func benchmark(clients: Int, requestsPerClient: Int) -> LoadStats {
+    let stats = InferenceEngine_runLoad(
+      UnsafeMutablePointer(engine), Int64(clients), Int64(requestsPerClient))
+    return LoadStats(
+      requests: Int(stats.requests), seconds: stats.seconds, throughput: stats.throughput,
+      p50LatencyMilliseconds: stats.p50_latency_ms, p99LatencyMilliseconds: stats.p99_latency_ms,
+      meanBatchSize: stats.mean_batch_size)
+  }
+
+  /// Returns the offsets of consecutive arrays of `counts` elements.
+  private static func offsets(of counts: [Int]) -> [Int] {
+    var offsets: [Int] = []
+    var offset = 0
+    for count in counts {
+      offsets.append(offset)
+      offset += count
+    }
+    return offsets
+  }
+
+  private static func exampleScalarCount(of tensor: AnyTensor) -> Int {
+    tensor.scalarType.unwrapTensor(tensor).shape.dropFirst().reduce(1, *)
+  }
+}
@@ -126,6 +126,15 @@ public enum _RawXLA {
       input, dims: reductionIndices.scalars.map { Int64($0) }, keep_reduced_dimensions: keepDims)
   }
 
+  /// Returns whether all the elements of all `tensors` are finite.
+  ///
+  /// The check runs as a single fused reduction over all the tensors, and the result stays on
+  /// the device, so it can drive `select` without synchronizing with the host.
+  public static func allFinite<T: TensorFlowFloatingPoint>(_ tensors: [Tensor<T>]) -> Tensor<Bool> {
+    precondition(!tensors.isEmpty, "allFinite cannot take an empty list")
+    return Tensor(_xla: XLATensor.allFinite(tensors.map { $0.xlaTensor }))
+  }
+
   /// Computes the "logical or" of elements across dimensions of a tensor.
   ///
   /// Reduces `input` along the dimensions given in `axis`. Unless
@@ -896,6 +905,74 @@ public enum _RawXLA {
       dilations.map { Int64($0) })
   }
 
+  /// The activations supported by `convBiasActivation`.
+  public enum ConvActivation {
+    case relu
+    case relu6
+    /// The tanh approximation of GELU, like `gelu(_:)`.
+    case gelu
+    case swish
+  }
+
+  /// Computes `activation(conv(input, filter) + bias)` with a single node, whose lowering lets
+  /// XLA fuse the bias add and the activation into the convolution.
+  ///
+  /// - Parameters:
+  ///     - input: A `[batch, in_channels, spatial...]` tensor.
+  ///     - filter: A `[out_channels, in_channels / groups, spatial...]` tensor.
+  ///     - bias: A `[out_channels]` tensor.
+  ///     - padding: The padding on both sides of every spatial dimension.
+  ///
+  /// - Returns: the result, in the layout of `input`, and the activation gradient to pass to
+  ///     `convBiasActivationBackward`: a `Tensor<Bool>` mask for `relu` and `relu6`, the
+  ///     derivative of the activation as a `Tensor<T>` otherwise.
+  public static func convBiasActivation<T: TensorFlowFloatingPoint>(
+    _ input: Tensor<T>,
+    filter: Tensor<T>,
+    bias: Tensor<T>,
+    strides: [Int64],
+    padding: [Int64],
+    dilations: [Int64],
+    groups: Int64 = 1,
+    activation: ConvActivation
+  ) -> (output: Tensor<T>, activationGrad: AnyTensor) {
+    let xlaActivation: XLAConvActivation
+    switch activation {
+    case .relu: xlaActivation = XLAConvActivation_RELU
+    case .relu6: xlaActivation = XLAConvActivation_RELU6
+    case .gelu: xlaActivation = XLAConvActivation_GELU
+    case .swish: xlaActivation = XLAConvActivation_SWISH
+    }
+    let result = XLATensor.convBiasActivation(
+      input.xlaTensor, filter.xlaTensor, bias.xlaTensor, strides, padding, dilations, false,
+      Array(repeating: 0, count: strides.count), groups, xlaActivation)
+    switch activation {
+    case .relu, .relu6:
+      return (Tensor(_xla: result.output), Tensor<Bool>(_xla: result.activationGrad))
+    case .gelu, .swish:
+      return (Tensor(_xla: result.output), Tensor<T>(_xla: result.activationGrad))
+    }
+  }
+
+  /// Computes the gradients of `convBiasActivation` with respect to its input, filter and bias,
+  /// given the activation gradient it returned.
+  public static func convBiasActivationBackward<T: TensorFlowFloatingPoint>(
+    _ gradOutput: Tensor<T>,
+    input: Tensor<T>,
+    filter: Tensor<T>,
+    activationGrad: AnyTensor,
+    strides: [Int64],
+    padding: [Int64],
+    dilations: [Int64],
+    groups: Int64 = 1
+  ) -> (input: Tensor<T>, filter: Tensor<T>, bias: Tensor<T>) {
+    let grads = XLATensor.convBiasActivationBackward(
+      gradOutput.xlaTensor, input.xlaTensor, filter.xlaTensor,
+      activationGrad.scalarType.unwrapTensor(activationGrad), strides, padding, dilations, false,
+      Array(repeating: 0, count: strides.count), groups)
+    return (Tensor(_xla: grads.input), Tensor(_xla: grads.kernel), Tensor(_xla: grads.bias))
+  }
+
   /// A simplified version of cross replica sum, with scaling.
   public static func crossReplicaSum<T: TensorFlowNumeric>(
     _ inputs: [Tensor<T>],
@@ -2115,6 +2192,49 @@ public enum _RawXLA {
     return fullLike(1, x)
   }
 
+  /// The multi-tensor optimizer updates supported by `optimizerUpdate`.
+  public enum OptimizerUpdateType {
+    /// SGD with momentum. Hyperparameters: learning rate, momentum, weight decay. States:
+    /// velocity.
+    case sgd
+    /// Adam with weight decay. Hyperparameters: learning rate, beta1, beta2, weight decay,
+    /// epsilon. States: first moment, second moment.
+    case adam
+    /// LARS. Hyperparameters: learning rate, momentum, weight decay, trust coefficient, epsilon.
+    /// States: velocity.
+    case lars
+  }
+
+  /// Computes the optimizer update of all `weights` in a single fused computation.
+  ///
+  /// The weights, gradients and states are packed into flat buffers, so the update is traced as
+  /// one IR node instead of a chain of elementwise ops per weight. `states` holds every state of
+  /// the first weight, then every state of the second, and so on for each kind of state, i.e.
+  /// state `j` of weight `i` is `states[j * weights.count + i]`.
+  ///
+  /// - Returns: the steps to add to the weights, and the new states in the same layout.
+  public static func optimizerUpdate(
+    _ type: OptimizerUpdateType,
+    nesterov: Bool = false,
+    weightDecay: Bool,
+    hyperparameters: [Tensor<Float>],
+    weights: [Tensor<Float>],
+    grads: [Tensor<Float>],
+    states: [Tensor<Float>]
+  ) -> (steps: [Tensor<Float>], states: [Tensor<Float>]) {
+    let xlaType: XLAOptimizerUpdateType
+    switch type {
+    case .sgd: xlaType = XLAOptimizerUpdateType_SGD
+    case .adam: xlaType = XLAOptimizerUpdateType_ADAM
+    case .lars: xlaType = XLAOptimizerUpdateType_LARS
+    }
+    let result = XLATensor.optimizerUpdate(
+      xlaType, nesterov: nesterov, weightDecay: weightDecay,
+      hyperparameters: hyperparameters.map { $0.xlaTensor }, weights: weights.map { $0.xlaTensor },
+      grads: grads.map { $0.xlaTensor }, states: states.map { $0.xlaTensor })
+    return (result.steps.map { Tensor(_xla: $0) }, result.states.map { Tensor(_xla: $0) })
+  }
+
   /// Packs a list of `N` rank-`R` tensors into one rank-`(R+1)` tensor.
   ///
   /// Packs the `N` tensors in `values` into a tensor with rank one higher than each
@@ -3831,4 +3951,26 @@ public enum _RawXLA {
   public static func rand(_ dims: [Int], _ seed: Int) -> Tensor<Float> {
     Tensor(_xla: XLATensor.rand(dims.map { Int64($0) }, Int64(seed)))
   }
+
+  /// Returns the seeds of a stateless random op, drawn from the counter-based RNG state of the
+  /// device. The state is advanced within the computation, so no seed is uploaded at every step.
+  public static func randomSeeds(on device: Device) -> Tensor<Int32> {
+    Tensor(_xla: XLATensor.rngSeeds(device))
+  }
+
+  /// The `[key, counter]` RNG state of the device, to store in a checkpoint such as
+  /// `XLACheckpoint`.
+  public static func randomState(on device: Device) -> Tensor<Int64> {
+    Tensor(_xla: XLATensor.rngState(device))
+  }
+
+  /// Restores the RNG state of the device from `randomState(on:)`.
+  public static func setRandomState(_ state: Tensor<Int64>, on device: Device) {
+    XLATensor.setRngState(device, state.xlaTensor)
+  }
+
+  /// Resets the RNG state of the device to `seed`.
+  public static func setRandomSeed(_ seed: UInt64, on device: Device) {
+    XLATensor.setRngSeed(device, seed)
+  }
 }
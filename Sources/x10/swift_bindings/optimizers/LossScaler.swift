@@ -0,0 +1,105 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+import _Differentiation
+import TensorFlow
+
+/// Dynamic loss scaling for reduced precision training.
+///
+/// The loss is multiplied by `scale` before differentiation, so that small gradients do not
+/// underflow in reduced precision, and the gradients are divided by it before the optimizer
+/// update. When the gradients overflow, the update is skipped and the scale is multiplied by
+/// `backoffFactor`. After `growthInterval` consecutive finite steps, the scale is multiplied by
+/// `growthFactor`.
+///
+/// The scale and the count of finite steps are device tensors, and the overflow check is a
+/// single fused reduction over all the gradients which is never read on the host, so the
+/// scaling does not add a synchronization point to the training step. With cross replica
+/// gradient sums, the check is reduced across the replicas as well.
+public struct DynamicLossScaler {
+  /// The current loss scale.
+  public var scale: Tensor<Float>
+
+  /// The number of consecutive steps with finite gradients since the last scale change.
+  public var growthTracker: Tensor<Int32>
+
+  public var growthFactor: Float
+  public var backoffFactor: Float
+  public var growthInterval: Int
+
+  public init(
+    initialScale: Float = 65536,
+    growthFactor: Float = 2,
+    backoffFactor: Float = 0.5,
+    growthInterval: Int = 2000,
+    on device: Device = .default
+  ) {
+    precondition(initialScale > 0, "Loss scale must be positive")
+    precondition(growthFactor > 1, "Growth factor must be greater than 1")
+    precondition(backoffFactor > 0 && backoffFactor < 1, "Backoff factor must be in (0, 1)")
+    precondition(growthInterval > 0, "Growth interval must be positive")
+    self.scale = Tensor(initialScale, on: device)
+    self.growthTracker = Tensor(0, on: device)
+    self.growthFactor = growthFactor
+    self.backoffFactor = backoffFactor
+    self.growthInterval = growthInterval
+  }
+
+  /// Returns the loss multiplied by the loss scale.
+  @differentiable(reverse)
+  public func scaled(_ loss: Tensor<Float>) -> Tensor<Float> {
+    loss * withoutDerivative(at: scale)
+  }
+
+  /// Unscales the gradients of the scaled loss, then updates the model with `optimizer` if they
+  /// are all finite, and adjusts the loss scale.
+  ///
+  /// - Returns: whether the gradients were finite, as a device scalar.
+  @discardableResult
+  public mutating func update<Model>(
+    _ model: inout Model, along direction: Model.TangentVector,
+    using optimizer: GeneralOptimizer<Model>
+  ) -> Tensor<Bool>
+  where Model.TangentVector: VectorProtocol & ElementaryFunctions & KeyPathIterable {
+    var grads = direction
+    let inverseScale = 1 / scale
+    optimizer.kpPlan.mapTensors(&grads, direction) {
+      (grad: inout Tensor<Float>, _: Tensor<Float>, _: Int) in
+      grad = grad * inverseScale
+    }
+    var finite = _Raw.allFinite(optimizer.kpPlan.allTensors(grads))
+    if optimizer.crossReplicaSumCount != nil {
+      // The optimizer sums the gradients of all the replicas, so they all skip the step if any
+      // of them overflowed.
+      let overflows = _Raw.crossReplicaSum([Tensor<Float>(finite.elementsLogicalNot())], 1)
+      finite = overflows[0] .== 0
+    }
+    optimizer.update(&model, along: grads, if: finite)
+    updateScale(finite: finite)
+    return finite
+  }
+
+  /// Adjusts the loss scale after a step whose gradients were `finite` or not.
+  public mutating func updateScale(finite: Tensor<Bool>) {
+    let count = growthTracker + 1
+    let grow = finite.elementsLogicalAnd(count .>= Int32(growthInterval))
+    scale = _Raw.select(
+      condition: finite,
+      t: _Raw.select(condition: grow, t: scale * growthFactor, e: scale),
+      e: scale * backoffFactor)
+    growthTracker = _Raw.select(
+      condition: grow.elementsLogicalOr(finite.elementsLogicalNot()),
+      t: Tensor<Int32>(zerosLike: count), e: count)
+  }
+}
@@ -99,9 +99,26 @@ public struct HyperparameterDictionary {
   }
 }
 
-// TODO: Experiment with efficiently fusing these...
 public typealias OptimizerCallback = (inout OptimizerWeightStepState, inout OptimizerState) -> Void
 
+/// A parameter group update which can run as a single multi-tensor op, see
+/// `_Raw.optimizerUpdate`.
+public struct FusedParameterGroupUpdate {
+  public var type: _Raw.OptimizerUpdateType
+  public var nesterov: Bool
+  public var weightDecay: Bool
+
+  /// The hyperparameters, in the order expected by `_Raw.optimizerUpdate`.
+  public var hyperparameters: [GlobalAccessor]
+
+  /// The states, in the order expected by `_Raw.optimizerUpdate`.
+  public var states: [StateAccessor]
+
+  /// The number of callbacks computing the same update. Callbacks appended later disable the
+  /// fused update.
+  var callbackCount: Int
+}
+
 /// An optimizer that works on a single parameter group.
 public struct ParameterGroupOptimizer {
   public init() {}
@@ -110,6 +127,17 @@ public struct ParameterGroupOptimizer {
   public var localCount: Int = 0
   public var callbacks: [OptimizerCallback] = []
   public var stateCount: Int = 0
+
+  /// The fused equivalent of `callbacks`, if any.
+  public var fusedUpdate: FusedParameterGroupUpdate? = nil
+
+  /// Returns the fused update if it still matches the callbacks.
+  var matchingFusedUpdate: FusedParameterGroupUpdate? {
+    guard let fusedUpdate = fusedUpdate, fusedUpdate.callbackCount == callbacks.count else {
+      return nil
+    }
+    return fusedUpdate
+  }
 }
 
 /// General optimizer that should be able to express multiple possible optimizations.
@@ -127,6 +155,10 @@ where
   /// Used to determine the scaling factor of the cross replica sum.
   public var crossReplicaSumCount: Int? = nil
 
+  /// Whether to update the weights of XLA models with multi-tensor ops, when all the parameter
+  /// groups have a fused update.
+  public var useFusedUpdates: Bool = true
+
   /// global optimizer state.
   public var optimizerState: OptimizerState
 
@@ -209,10 +241,39 @@ where
   /// The actual optimizer step. Maps over all the tensors of the gradient
   /// and applies per-weight optimizers defined by ParameterGroupOptimizer.
   public func update(_ model: inout Model, along direction: Model.TangentVector) {
+    model.move(by: computeStep(model, along: direction))
+  }
+
+  /// Applies the optimizer step only where `condition` holds, e.g. when the gradients are all
+  /// finite. The condition is a scalar which is never read on the host: the new weights and
+  /// optimizer states are selected on the device, so the update does not block on it.
+  public func update(
+    _ model: inout Model, along direction: Model.TangentVector, if condition: Tensor<Bool>
+  ) {
+    let previousState = optimizerState.state
+    var step = computeStep(model, along: direction)
+    optimizerState.state = zip(optimizerState.state, previousState).map {
+      _Raw.select(condition: condition, t: $0, e: $1)
+    }
+    kpPlan.mapTensors(&step, direction) {
+      (step: inout Tensor<Float>, _: Tensor<Float>, _: Int) in
+      step = _Raw.select(condition: condition, t: step, e: Tensor<Float>(zerosLike: step))
+    }
+    model.move(by: step)
+  }
+
+  /// Computes the step to move the model by, updating the optimizer state.
+  func computeStep(_ model: Model, along direction: Model.TangentVector) -> Model.TangentVector {
     step += 1
     let globals = parameterGroups.map { pg in
       pg.globals.map { globalInit in globalInit(pg.hyperparameters, device) }
     }
+    if useFusedUpdates && device.backend == .XLA {
+      let fusedUpdates = parameterGroups.compactMap { $0.matchingFusedUpdate }
+      if fusedUpdates.count == parameterGroups.count {
+        return fusedStep(model, along: direction, globals: globals, fusedUpdates: fusedUpdates)
+      }
+    }
     var step = direction
     let crsScale : Double? = crossReplicaSumCount.map { 1.0 / Double($0) }
     // step plays dual-duties as an inout parameter for efficiency.
@@ -228,13 +289,50 @@ where
       for cb in paramGroup.callbacks { cb(&state, &optimizerState) }
       step = state.step ?? Tensor<Float>(zerosLike: step)
     }
-    model.move(by: step)
+    return step
+  }
+
+  /// Computes the step of the fused updates, with a single multi-tensor op per parameter group.
+  func fusedStep(
+    _ model: Model, along direction: Model.TangentVector, globals: [[Tensor<Float>]],
+    fusedUpdates: [FusedParameterGroupUpdate]
+  ) -> Model.TangentVector {
+    let weights = kpPlan.allTensors(model.differentiableVectorView)
+    var grads = kpPlan.allTensors(direction)
+    if let crossReplicaSumCount = crossReplicaSumCount {
+      grads = _Raw.crossReplicaSum(grads, 1.0 / Double(crossReplicaSumCount))
+    }
+    var steps = grads
+    for (selector, fusedUpdate) in fusedUpdates.enumerated() {
+      let indices = parameterGroupIndices.indices.filter { parameterGroupIndices[$0] == selector }
+      if indices.isEmpty { continue }
+      let result = _Raw.optimizerUpdate(
+        fusedUpdate.type, nesterov: fusedUpdate.nesterov, weightDecay: fusedUpdate.weightDecay,
+        hyperparameters: fusedUpdate.hyperparameters.map { globals[selector][$0.index] },
+        weights: indices.map { weights[$0] }, grads: indices.map { grads[$0] },
+        states: fusedUpdate.states.flatMap { state in
+          indices.map { optimizerState[state.index, $0] }
+        })
+      for (i, index) in indices.enumerated() {
+        steps[index] = result.steps[i]
+        for (j, state) in fusedUpdate.states.enumerated() {
+          optimizerState[state.index, index] = result.states[j * indices.count + i]
+        }
+      }
+    }
+    var step = direction
+    kpPlan.mapTensors(&step, direction) {
+      (step: inout Tensor<Float>, _: Tensor<Float>, i: Int) in
+      step = steps[i]
+    }
+    return step
   }
 
   /// Copies the optimizer to the specified device.
   public required init(copying other: GeneralOptimizer, to device: Device) {
     step = other.step
     crossReplicaSumCount = other.crossReplicaSumCount
+    useFusedUpdates = other.useFusedUpdates
     kpPlan = other.kpPlan
     optimizerState = .init(copying: other.optimizerState, to: device)
     parameterGroupIndices = other.parameterGroupIndices
@@ -318,6 +416,17 @@ public struct ParameterGroupOptimizerBuilder {
     result.callbacks.append(cb)
   }
 
+  /// Declares that the callbacks appended so far compute the `type` multi-tensor update, which
+  /// `GeneralOptimizer` then runs instead of the callbacks on XLA devices.
+  public mutating func setFusedUpdate(
+    _ type: _Raw.OptimizerUpdateType, nesterov: Bool = false, weightDecay: Bool,
+    hyperparameters: [GlobalAccessor], states: [StateAccessor]
+  ) {
+    result.fusedUpdate = FusedParameterGroupUpdate(
+      type: type, nesterov: nesterov, weightDecay: weightDecay,
+      hyperparameters: hyperparameters, states: states, callbackCount: result.callbacks.count)
+  }
+
   /// Returns the optimizer and clears the builder.
   public mutating func makeOptimizer() -> ParameterGroupOptimizer {
     let tmp = result
@@ -98,6 +98,9 @@ public func makeLARS(
   let velocity = b[state: "velocity"]
   b.updateVelocity(mom: mom, lr: lr, velocity: velocity)
   b.sgdStep(nesterov: nesterov, mom: mom, lr: lr, velocity: velocity)
+  b.setFusedUpdate(
+    .lars, nesterov: nesterov, weightDecay: weightDecay != 0,
+    hyperparameters: [lr, mom, wd, trustCoefficient, epsilon], states: [velocity])
   return b.makeOptimizer()
 }
 
@@ -119,6 +122,9 @@ public func makeSGD(
   let velocity = b[state: "velocity"]
   b.updateVelocity(mom: mom, lr: lr, velocity: velocity)
   b.sgdStep(nesterov: nesterov, mom: mom, lr: lr, velocity: velocity)
+  b.setFusedUpdate(
+    .sgd, nesterov: nesterov, weightDecay: weightDecay != 0, hyperparameters: [lr, mom, wd],
+    states: [velocity])
   return b.makeOptimizer()
 }
 
@@ -138,6 +144,7 @@ public func makeAdam(
   let beta1 = b.makeParameter("beta1", beta1)
   let beta2 = b.makeParameter("beta2", beta2)
   let wd = b.makeParameter("weightDecay", weightDecayRate)
+  let epsilon = b.makeParameter("epsilon", epsilon)
 
   let firstMoment = b[state: "firstMoment"]
   let secondMoment = b[state: "secondMoment"]
@@ -154,10 +161,13 @@ public func makeAdam(
   }
 
   b.appendCallback { (state: inout OptimizerWeightStepState, optState: inout OptimizerState) in
-    let denominator = sqrt(optState[state, secondMoment]).adding(epsilon)
+    let denominator = sqrt(optState[state, secondMoment]) + state[epsilon]
     let update = optState[state, firstMoment] ./ denominator + state.weight * state[wd]
     state.step = -state[lr] * update
   }
 
+  b.setFusedUpdate(
+    .adam, weightDecay: true, hyperparameters: [lr, beta1, beta2, wd, epsilon],
+    states: [firstMoment, secondMoment])
   return b.makeOptimizer()
 }
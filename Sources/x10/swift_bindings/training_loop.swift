@@ -12,10 +12,38 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+import Foundation
 import _Differentiation
 import TensorFlow
 @_implementationOnly import x10_xla_tensor_wrapper
 
+/// Keeps automatic mixed precision enabled while any training thread uses it, and restores the
+/// setting it had before once the last of them is done.
+private enum MixedPrecisionScope {
+  static let lock = NSLock()
+  static var users = 0
+  static var previouslyEnabled = false
+
+  static func enter() {
+    lock.lock()
+    defer { lock.unlock() }
+    if users == 0 {
+      previouslyEnabled = AutomaticMixedPrecision.isEnabled
+      AutomaticMixedPrecision.isEnabled = true
+    }
+    users += 1
+  }
+
+  static func exit() {
+    lock.lock()
+    defer { lock.unlock() }
+    users -= 1
+    if users == 0 {
+      AutomaticMixedPrecision.isEnabled = previouslyEnabled
+    }
+  }
+}
+
 /// Collects correct prediction counters and loss totals.
 public struct HostStatistics {
   public init() {}
@@ -199,6 +227,16 @@ where
     let crsDevices = crossReplicaSumDevices ?? devices
 
     LazyTensorBarrier(on: device, wait: true)
+    // Mixed precision is applied when lowering the step graphs, so the model and its gradients
+    // stay in full precision.
+    if useAutomaticMixedPrecision {
+      MixedPrecisionScope.enter()
+    }
+    defer {
+      if useAutomaticMixedPrecision {
+        MixedPrecisionScope.exit()
+      }
+    }
 
     var trainStats = Statistics(on: device)
     var testStats = Statistics(on: device)
@@ -208,21 +246,16 @@ where
       let scopeTracing = MakeAnnotationScope("training-tracing")
       var detailedScopeTracing = MakeAnnotationScope("fwd-training-tracing")
       // x might have been constructed directly with reduced precision, check for that.
-      let input = (useAutomaticMixedPrecision && !x.isReducedPrecision) ? x.toReducedPrecision : x
+      let input = (useAutomaticMixedPrecision && x.isReducedPrecision) ? x.toFullPrecision : x
       // Compute the gradient with respect to the model.
-      let reducedPrecisionClassifier =
-        useAutomaticMixedPrecision
-        ? classifier.toReducedPrecision : classifier
-      let 𝛁model = gradient(at: reducedPrecisionClassifier) {
-        reducedPrecisionClassifier -> Tensor<Float> in
-        let ŷ = reducedPrecisionClassifier(input)
+      let 𝛁model = gradient(at: classifier) { classifier -> Tensor<Float> in
+        let ŷ = classifier(input)
         let correctPredictions = ŷ.argmax(squeezingAxis: 1) .== y
         trainStats.correctGuessCountTensor +=
           Tensor<Int32>(correctPredictions).sum()
         trainStats.totalSamples += y.shape[0]
         let loss = lossFunction(ŷ, y)
-        trainStats.totalLossTensor +=
-          Float(y.shape[0]) * (self.useAutomaticMixedPrecision ? loss.toFullPrecision : loss)
+        trainStats.totalLossTensor += Float(y.shape[0]) * loss
         DestroyAnnotationScope(detailedScopeTracing)
         detailedScopeTracing = MakeAnnotationScope("back-training-tracing")
         return loss
@@ -231,8 +264,7 @@ where
       detailedScopeTracing = MakeAnnotationScope("optimizer-training-tracing")
       // Update the model's differentiable variables along the gradient vector.
       scheduleLearningRate(optimizer)
-      optimizer.update(
-        &classifier, along: useAutomaticMixedPrecision ? 𝛁model.toFullPrecision : 𝛁model)
+      optimizer.update(&classifier, along: 𝛁model)
       DestroyAnnotationScope(detailedScopeTracing)
       DestroyAnnotationScope(scopeTracing)
       LazyTensorBarrier(on: device, devices: crsDevices)
@@ -240,21 +272,17 @@ where
     }
 
     Context.local.learningPhase = .inference
-    let reducedPrecisionClassifier =
-      useAutomaticMixedPrecision
-      ? classifier.toReducedPrecision : classifier
     for (x, y) in test {
       let scope = MakeAnnotationScope("test")
       // x might have been constructed directly with reduced precision, check for that.
-      let input = (useAutomaticMixedPrecision && !x.isReducedPrecision) ? x.toReducedPrecision : x
+      let input = (useAutomaticMixedPrecision && x.isReducedPrecision) ? x.toFullPrecision : x
       // Compute loss on test set
-      let ŷ = reducedPrecisionClassifier(input)
+      let ŷ = classifier(input)
       let correctPredictions = ŷ.argmax(squeezingAxis: 1) .== y
       testStats.correctGuessCountTensor += Tensor<Int32>(correctPredictions).sum()
       testStats.totalSamples += y.shape[0]
       let loss = lossFunction(ŷ, y)
-      testStats.totalLossTensor +=
-        Float(y.shape[0]) * (useAutomaticMixedPrecision ? loss.toFullPrecision : loss)
+      testStats.totalLossTensor += Float(y.shape[0]) * loss
       LazyTensorBarrier(on: device)
       DestroyAnnotationScope(scope)
     }
@@ -204,8 +204,28 @@ void ComputationClient::AddDevice(std::unique_ptr<Device> device) {
   devices_owned_.push_back(std::move(device));
 }
 
+void ComputationClient::SetLazyDeviceInitializer(
+    std::function<void()> initializer) {
+  lazy_device_initializer_ = std::move(initializer);
+}
+
+void ComputationClient::InitializeLazyDevices() const {
+  std::call_once(lazy_device_once_, [this]() {
+    if (lazy_device_initializer_) {
+      lazy_device_initializer_();
+    }
+  });
+}
+
+const std::vector<ComputationClient::Device*>&
+ComputationClient::GetAllDevicePointers() const {
+  InitializeLazyDevices();
+  return devices_;
+}
+
 ComputationClient::Device* ComputationClient::GetDevice(
     const std::string& device_name) const {
+  InitializeLazyDevices();
   auto it = devices_by_name_.find(device_name);
   XLA_CHECK(it != devices_by_name_.end())
       << "Unable to find device: " << device_name;
@@ -230,6 +250,28 @@ std::vector<Literal> ComputationClient::TransferFromServer(
   return transfer->TransferFromServerImpl(handles);
 }
 
+void ComputationClient::TransferFromServerInto(
+    absl::Span<const DataPtr> handles,
+    absl::Span<const MutableBorrowingLiteral> literals) {
+  XLA_CHECK_EQ(handles.size(), literals.size());
+  if (handles.empty()) return;
+  TransferManager* transfer = handles[0]->device()->GetTransferManager();
+  for (auto& handle : handles) {
+    XLA_CHECK_EQ(transfer, handle->device()->GetTransferManager());
+  }
+  transfer->TransferFromServerIntoImpl(handles, literals);
+}
+
+void ComputationClient::TransferManager::TransferFromServerIntoImpl(
+    absl::Span<const DataPtr> handles,
+    absl::Span<const MutableBorrowingLiteral> literals) {
+  std::vector<Literal> results = TransferFromServerImpl(handles);
+  for (size_t i = 0; i < results.size(); ++i) {
+    MutableBorrowingLiteral literal = literals[i];
+    XLA_CHECK_OK(literal.CopyFrom(results[i]));
+  }
+}
+
 ComputationClient::DataPtr ComputationClient::Device::TransferToServer(
     xla::BorrowingLiteral literal, const xla::Shape& dest_shape) {
   TF_LOG(FATAL) << "Only supported for LocalClient";
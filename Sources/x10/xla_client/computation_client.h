@@ -19,8 +19,10 @@
 
 #include <algorithm>
 #include <cmath>
+#include <functional>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <vector>
 
@@ -53,6 +55,13 @@ class ComputationClient {
 
     virtual std::vector<Literal> TransferFromServerImpl(
         absl::Span<const DataPtr> handles) = 0;
+
+    // Writes the values behind the handles straight into the host memory
+    // borrowed by the literals. The default implementation goes through
+    // TransferFromServerImpl() and copies the results over.
+    virtual void TransferFromServerIntoImpl(
+        absl::Span<const DataPtr> handles,
+        absl::Span<const MutableBorrowingLiteral> literals);
   };
 
   class Device {
@@ -166,13 +175,26 @@ class ComputationClient {
     // (dim0-major) and deposits the source tensor data directly over the
     // provided buffer.
     using PopulateFn = std::function<void(const TensorSource&, void*, size_t)>;
+    // The PopulateRangeFn deposits the [offset, offset + size) byte range of
+    // the dense buffer the PopulateFn would produce. Offset and size are
+    // multiples of the element size.
+    using PopulateRangeFn =
+        std::function<void(const TensorSource&, size_t, void*, size_t)>;
 
     TensorSource() = default;
     TensorSource(Shape shape, PopulateFn populate_fn)
         : shape(std::move(shape)), populate_fn(std::move(populate_fn)) {}
+    TensorSource(Shape shape, PopulateFn populate_fn,
+                 PopulateRangeFn populate_range_fn)
+        : shape(std::move(shape)),
+          populate_fn(std::move(populate_fn)),
+          populate_range_fn(std::move(populate_range_fn)) {}
 
     Shape shape;
     PopulateFn populate_fn;
+    // Optional. Sources which provide it can be uploaded in chunks, without
+    // staging the whole dense buffer in host memory.
+    PopulateRangeFn populate_range_fn;
   };
 
   struct CompileInstance {
@@ -230,6 +252,13 @@ class ComputationClient {
   static std::vector<Literal> TransferFromServer(
       absl::Span<const DataPtr> handles);
 
+  // Same as above, but the values are written into the host buffers borrowed
+  // by the literals, which need to have the same dimensions and element types
+  // as the handles shapes. The layouts can differ.
+  static void TransferFromServerInto(
+      absl::Span<const DataPtr> handles,
+      absl::Span<const MutableBorrowingLiteral> literals);
+
   virtual std::string GetDefaultDevice() const = 0;
   static Device* DefaultDevice();
 
@@ -241,7 +270,7 @@ class ComputationClient {
   std::vector<std::string> GetAllDevices() const;
   static std::vector<std::string> AllDevices();
 
-  const std::vector<Device*>& GetAllDevicePointers() const { return devices_; }
+  const std::vector<Device*>& GetAllDevicePointers() const;
 
   Device* GetDevice(const std::string& device_name) const;
 
@@ -296,13 +325,23 @@ class ComputationClient {
  protected:
   void AddDevice(std::unique_ptr<Device> device);
 
+  // Sets a function adding the devices whose discovery is deferred until a
+  // device is first looked up, so that processes pay no startup cost for the
+  // devices they never touch.
+  void SetLazyDeviceInitializer(std::function<void()> initializer);
+
   // Returns the ComputationClient singleton.
   static ComputationClient* Get();
 
  private:
+  // Runs the lazy device initializer, the first time it is called.
+  void InitializeLazyDevices() const;
+
   std::vector<Device*> devices_;
   std::vector<std::unique_ptr<Device>> devices_owned_;
   absl::node_hash_map<std::string, Device*> devices_by_name_;
+  std::function<void()> lazy_device_initializer_;
+  mutable std::once_flag lazy_device_once_;
 
   friend ComputationClient::Device* GetX10Device(const std::string& device);
 };
@@ -1,5 +1,7 @@
 #include "tensorflow/compiler/xla/xla_client/local_device.h"
 
+#include <algorithm>
+#include <cstring>
 #include <tuple>
 
 #include "absl/container/node_hash_map.h"
@@ -8,6 +10,7 @@
 #include "absl/synchronization/mutex.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/xla/service/platform_util.h"
@@ -123,6 +126,10 @@ class LocalTransferManager : public ComputationClient::TransferManager {
  public:
   std::vector<Literal> TransferFromServerImpl(
       absl::Span<const DataPtr> handles) override;
+
+  void TransferFromServerIntoImpl(
+      absl::Span<const DataPtr> handles,
+      absl::Span<const MutableBorrowingLiteral> literals) override;
 };
 
 class LocalDevice : public ComputationClient::Device {
@@ -215,6 +222,16 @@ class LocalDevice : public ComputationClient::Device {
       const ExecuteComputationOptions& options) override;
 
  private:
+  // Whether the tensor is big enough to be uploaded in chunks, and can be.
+  bool ShouldTransferChunked(const TensorSource& tensor) const;
+
+  // Uploads the tensor by converting and copying fixed size chunks of it, so
+  // that only a bounded amount of host staging memory is in use.
+  DataPtr TransferToServerChunked(const TensorSource& tensor);
+
+  std::vector<DataPtr> TransferToServerStaged(
+      absl::Span<const TensorSource> tensors);
+
   absl::Mutex mutex_;
   // This starts out as the number of allowable concurrent executions
   // on this particular device.
@@ -312,8 +329,120 @@ DataPtr LocalDevice::TransferToServer(xla::BorrowingLiteral literal,
   return std::make_shared<LocalData>(this, std::move(buffer), -1);
 }
 
+bool LocalDevice::ShouldTransferChunked(const TensorSource& tensor) const {
+  static const int64_t chunked_threshold =
+      sys_util::GetEnvInt("XLA_CHUNKED_UPLOAD_THRESHOLD", 256 * 1024 * 1024);
+  if (chunked_threshold < 0 || !tensor.populate_range_fn ||
+      !tensor.shape.IsArray() ||
+      ShapeUtil::ByteSizeOf(tensor.shape) < chunked_threshold) {
+    return false;
+  }
+  // The chunks are written at their host offsets within the device buffer, so
+  // the device layout must match the host one.
+  xla::Shape device_shape =
+      client()->backend().transfer_manager()->HostShapeToDeviceShape(
+          tensor.shape);
+  return ShapeUtil::Equal(device_shape, tensor.shape);
+}
+
+DataPtr LocalDevice::TransferToServerChunked(const TensorSource& tensor) {
+  tensorflow::profiler::TraceMe trace("TransferToServerChunked");
+  static const int64_t chunk_size =
+      sys_util::GetEnvInt("XLA_UPLOAD_CHUNK_SIZE", 16 * 1024 * 1024);
+  static const size_t num_staging_chunks = std::max<int64_t>(
+      sys_util::GetEnvInt("XLA_UPLOAD_STAGING_CHUNKS", 2), 1);
+
+  stream_executor::DeviceMemoryAllocator* allocator =
+      client()->backend().memory_allocator();
+  xla::TransferManager* transfer_manager =
+      client()->backend().transfer_manager();
+  ScopedShapedBuffer buffer = [&] {
+    tensorflow::profiler::TraceMe trace("Allocate");
+    return transfer_manager
+        ->AllocateScopedShapedBuffer(tensor.shape, allocator, device_ordinal_)
+        .ValueOrDie();
+  }();
+  se::DeviceMemoryBase device_memory = buffer.root_buffer();
+  size_t size = ShapeUtil::ByteSizeOf(tensor.shape);
+  XLA_CHECK_EQ(device_memory.size(), size) << tensor.shape;
+  ComputationClient::OutboundDataMetric()->AddSample(size);
+  XLA_COUNTER("ChunkedTransferToServer", 1);
+
+  if (is_cpu_) {
+    // CPU device buffers live in host memory, so no staging is needed at all.
+    tensor.populate_fn(tensor, device_memory.opaque(), size);
+    return std::make_shared<LocalData>(this, std::move(buffer), -1);
+  }
+
+  int64_t element_size =
+      ShapeUtil::ByteSizeOfPrimitiveType(tensor.shape.element_type());
+  size_t aligned_chunk_size =
+      std::max<int64_t>(chunk_size / element_size, 1) * element_size;
+  size_t num_chunks = (size + aligned_chunk_size - 1) / aligned_chunk_size;
+  std::vector<std::unique_ptr<char[]>> staging(
+      std::min(num_staging_chunks, num_chunks));
+
+  // The conversion of a chunk overlaps with the device copy of the previous
+  // ones. A staging buffer is reused once the copy out of it completed.
+  absl::Mutex mutex;
+  size_t completed_chunks = 0;
+  se::Stream* stream = stream_->GetOrCreateSubStream();
+  for (size_t i = 0; i < num_chunks; ++i) {
+    size_t offset = i * aligned_chunk_size;
+    size_t length = std::min(aligned_chunk_size, size - offset);
+    std::unique_ptr<char[]>& chunk_buffer = staging[i % staging.size()];
+    if (chunk_buffer == nullptr) {
+      chunk_buffer = std::make_unique<char[]>(aligned_chunk_size);
+    } else {
+      size_t required_chunks = i - staging.size() + 1;
+      auto cond = [&]() ABSL_EXCLUSIVE_LOCKS_REQUIRED(mutex) {
+        return completed_chunks >= required_chunks;
+      };
+      absl::MutexLock lock(&mutex);
+      mutex.Await(absl::Condition(&cond));
+    }
+    tensor.populate_range_fn(tensor, offset, chunk_buffer.get(), length);
+
+    se::DeviceMemoryBase dest = device_memory.GetByteSlice(offset, length);
+    stream->ThenMemcpy(&dest, chunk_buffer.get(), length);
+    stream->ThenDoHostCallback([&]() {
+      absl::MutexLock lock(&mutex);
+      ++completed_chunks;
+    });
+  }
+  TF_CHECK_OK(stream->BlockHostUntilDone());
+  stream_->ReturnSubStream(stream);
+
+  return std::make_shared<LocalData>(this, std::move(buffer), -1);
+}
+
 std::vector<DataPtr> LocalDevice::TransferToServer(
     absl::Span<const TensorSource> tensors) {
+  std::vector<DataPtr> out(tensors.size());
+  std::vector<TensorSource> staged_tensors;
+  std::vector<size_t> staged_indices;
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    if (ShouldTransferChunked(tensors[i])) {
+      out[i] = TransferToServerChunked(tensors[i]);
+    } else {
+      staged_tensors.push_back(tensors[i]);
+      staged_indices.push_back(i);
+    }
+  }
+  if (staged_tensors.size() == tensors.size()) {
+    return TransferToServerStaged(tensors);
+  }
+  if (!staged_tensors.empty()) {
+    std::vector<DataPtr> staged_out = TransferToServerStaged(staged_tensors);
+    for (size_t i = 0; i < staged_indices.size(); ++i) {
+      out[staged_indices[i]] = std::move(staged_out[i]);
+    }
+  }
+  return out;
+}
+
+std::vector<DataPtr> LocalDevice::TransferToServerStaged(
+    absl::Span<const TensorSource> tensors) {
   auto* device = this;
   tensorflow::profiler::TraceMe trace("TransferToServer");
   std::vector<std::unique_ptr<char[]>> buffers;
@@ -418,6 +547,61 @@ std::vector<Literal> LocalTransferManager::TransferFromServerImpl(
   return out;
 }
 
+void LocalTransferManager::TransferFromServerIntoImpl(
+    absl::Span<const DataPtr> handles,
+    absl::Span<const MutableBorrowingLiteral> literals) {
+  tensorflow::profiler::TraceMe trace("TransferFromServerInto");
+  metrics::TimedSection timed(ComputationClient::TransferFromServerMetric());
+  {
+    tensorflow::profiler::TraceMe trace("Wait for transfer");
+    for (size_t i = 0; i < handles.size(); ++i) {
+      const auto& local_data = dynamic_cast<const LocalData&>(*handles[i]);
+      dynamic_cast<LocalDevice*>(local_data.device())
+          ->WaitUntilComputationFinished(local_data.computation_id());
+    }
+  }
+
+  std::vector<DataPtr> relayout_handles;
+  std::vector<MutableBorrowingLiteral> relayout_literals;
+  util::MultiWait mwait(handles.size());
+  for (size_t i = 0; i < handles.size(); ++i) {
+    const auto& local_data = dynamic_cast<const LocalData&>(*handles[i]);
+    LocalDevice* device = dynamic_cast<LocalDevice*>(local_data.device());
+    const ScopedShapedBuffer& buffer = local_data.buffer();
+    if (!ShapeUtil::Equal(buffer.on_host_shape(), literals[i].shape())) {
+      relayout_handles.push_back(handles[i]);
+      relayout_literals.push_back(literals[i]);
+      mwait.Done();
+    } else if (device->is_cpu()) {
+      // On CPU the device buffer already lives in host memory, and all the
+      // computations writing it are done, so copy it straight over.
+      MutableBorrowingLiteral literal = literals[i];
+      int64_t size = ShapeUtil::ByteSizeOf(literal.shape());
+      if (size > 0) {
+        std::memcpy(literal.untyped_data(), buffer.root_buffer().opaque(),
+                    size);
+      }
+      mwait.Done();
+    } else {
+      xla::TransferManager* transfer_manager =
+          device->client()->backend().transfer_manager();
+      transfer_manager->TransferLiteralFromDevice(
+          device->transfer_from_device_stream(), buffer, literals[i],
+          [&mwait](Status status) {
+            TF_CHECK_OK(status);
+            mwait.Done();
+          });
+    }
+  }
+  mwait.Wait();
+  if (!relayout_handles.empty()) {
+    std::vector<Literal> results = TransferFromServerImpl(relayout_handles);
+    for (size_t i = 0; i < results.size(); ++i) {
+      XLA_CHECK_OK(relayout_literals[i].CopyFrom(results[i]));
+    }
+  }
+}
+
 std::vector<ComputationPtr> LocalDevice::Compile(
     const std::vector<std::string>& devices,
     std::vector<CompileInstance> instances) {
@@ -541,6 +725,22 @@ GetAllLocalDevicesForPlatform(const char* platform_name,
                               const char* device_prefix) {
   auto platform = xla::PlatformUtil::GetPlatform(platform_name);
   if (!platform.ok()) return {};
+  // Creating the stream executor of a device (its context, streams and
+  // allocator) is the bulk of the discovery cost. The platform caches them, so
+  // the local client below finds them already initialized.
+  int device_count = platform.ValueOrDie()->VisibleDeviceCount();
+  util::MultiWait mwait(device_count);
+  for (int i = 0; i < device_count; ++i) {
+    auto init_fn = [&, i]() {
+      auto executor = platform.ValueOrDie()->ExecutorForDevice(i);
+      if (!executor.ok()) {
+        TF_VLOG(1) << "Unable to initialize " << device_prefix << ":" << i
+                   << ": " << executor.status();
+      }
+    };
+    env::ScheduleClosure(mwait.Completer(std::move(init_fn)));
+  }
+  mwait.Wait();
   xla::LocalClientOptions options;
   options.set_platform(platform.ValueOrDie());
   auto local_client_statusor =
@@ -557,4 +757,10 @@ GetAllLocalDevicesForPlatform(const char* platform_name,
   return devices;
 }
 
+int GetLocalDeviceCountForPlatform(const char* platform_name) {
+  auto platform = xla::PlatformUtil::GetPlatform(platform_name);
+  if (!platform.ok()) return 0;
+  return platform.ValueOrDie()->VisibleDeviceCount();
+}
+
 }  // namespace xla
@@ -28,10 +28,16 @@ std::unique_ptr<ComputationClient::Device> MakeLocalDeviceFromClient(
     std::string name, xla::LocalClient* client, int device_ordinal,
     int32_t mesh_id, bool is_cpu);
 
+// Creates the devices of a platform. Their stream executors are initialized in
+// parallel.
 std::vector<std::unique_ptr<ComputationClient::Device>>
 GetAllLocalDevicesForPlatform(const char* platform_name,
                               const char* device_prefix);
 
+// Returns the number of devices of a platform without initializing them, or 0
+// if the platform is not available.
+int GetLocalDeviceCountForPlatform(const char* platform_name);
+
 }  // namespace xla
 
 #endif  // X10_XLA_CLIENT_LOCAL_DEVICE_IMPL_H_
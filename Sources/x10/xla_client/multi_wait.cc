@@ -53,6 +53,11 @@ void MultiWait::Wait(double wait_seconds) {
   }
 }
 
+bool MultiWait::IsDone() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return completed_count_ >= count_;
+}
+
 void MultiWait::Reset(size_t count) {
   std::lock_guard<std::mutex> lock(mutex_);
   count_ = count;
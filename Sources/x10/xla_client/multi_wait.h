@@ -41,6 +41,9 @@ class MultiWait {
   // Same as above, but waits up to wait_seconds.
   void Wait(double wait_seconds);
 
+  // Returns whether count completions already happened, without blocking.
+  bool IsDone();
+
   // Resets the threshold counter for the MultiWait object. The completed count
   // is also reset to zero.
   void Reset(size_t count);
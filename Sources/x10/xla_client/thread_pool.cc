@@ -26,6 +26,8 @@ namespace xla {
 namespace env {
 namespace {
 
+thread_local bool in_thread_pool = false;
+
 class ThreadPool {
  public:
   explicit ThreadPool(size_t num_threads) {
@@ -68,6 +70,7 @@ class ThreadPool {
 
  private:
   void Worker() {
+    in_thread_pool = true;
     while (true) {
       std::function<void()> closure = GetWork();
       if (closure == nullptr) {
@@ -78,7 +81,10 @@ class ThreadPool {
   }
 
   void ScheduleOnThread(std::function<void()> closure) {
-    std::thread thread(std::move(closure));
+    std::thread thread([closure = std::move(closure)]() {
+      in_thread_pool = true;
+      closure();
+    });
     thread.detach();
   }
 
@@ -185,5 +191,7 @@ Completion ScheduleIoClosureWithCompletion(std::function<void()> closure) {
   return Completion(std::move(data));
 }
 
+bool IsThreadPoolThread() { return in_thread_pool; }
+
 }  // namespace env
 }  // namespace xla
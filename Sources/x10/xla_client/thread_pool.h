@@ -47,6 +47,11 @@ Completion ScheduleClosureWithCompletion(std::function<void()> closure);
 void ScheduleIoClosure(std::function<void()> closure);
 Completion ScheduleIoClosureWithCompletion(std::function<void()> closure);
 
+// Returns whether the calling thread is running a scheduled closure. Closures
+// which would split their work over the pool should run it inline instead, as
+// the pool threads are already busy.
+bool IsThreadPoolThread();
+
 }  // namespace env
 }  // namespace xla
 
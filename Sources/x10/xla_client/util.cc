@@ -25,6 +25,14 @@ hash_t LoadHash(const uint8** data, const uint8* top) {
   return uval.h;
 }
 
+constexpr size_t kStripeLanes = 8;
+constexpr size_t kStripeSize = kStripeLanes * sizeof(uint64);
+constexpr size_t kStripesPerScramble = 16;
+constexpr uint64 kStripeKeys[kStripeLanes] = {
+    0xbe4ba423396cfeb8, 0x1cad21f72c81017c, 0xdb979083e96dd4de,
+    0x1f67b3b7a4a44072, 0x78e5c0cc4ee679cb, 0x2172ffcc7dd05a82,
+    0x8e2443f7744608b8, 0x4c263a81e69035e0};
+
 }  // namespace
 
 hash_t HashBlock(const void* data, size_t n, const hash_t& seed) {
@@ -53,6 +61,34 @@ hash_t DataHash(const void* data, size_t size) {
   return HashBlock(data, size, 0xc2b2ae3d27d4eb4f);
 }
 
+hash_t StripeHash(const void* data, size_t size, const hash_t& seed) {
+  uint64 acc[kStripeLanes] = {
+      0x00000000c2b2ae3d, 0x9e3779b185ebca87, 0xc2b2ae3d27d4eb4f,
+      0x165667b19e3779f9, 0x85ebca77c2b2ae63, 0x0000000085ebca77,
+      0x27d4eb2f165667c5, 0x000000009e3779b1};
+  const uint8* u8_data = reinterpret_cast<const uint8*>(data);
+  size_t num_stripes = size / kStripeSize;
+  for (size_t s = 0; s < num_stripes; ++s) {
+    const uint8* stripe = u8_data + s * kStripeSize;
+    for (size_t i = 0; i < kStripeLanes; ++i) {
+      uint64 value;
+      std::memcpy(&value, stripe + i * sizeof(uint64), sizeof(value));
+      uint64 key = value ^ kStripeKeys[i];
+      acc[i ^ 1] += value;
+      acc[i] += (key & 0xffffffff) * (key >> 32);
+    }
+    if ((s + 1) % kStripesPerScramble == 0) {
+      for (size_t i = 0; i < kStripeLanes; ++i) {
+        acc[i] ^= acc[i] >> 47;
+        acc[i] ^= kStripeKeys[i];
+        acc[i] *= 0x9e3779b1;
+      }
+    }
+  }
+  hash_t h = HashBlock(acc, sizeof(acc), seed ^ size);
+  return HashBlock(u8_data + num_stripes * kStripeSize, size % kStripeSize, h);
+}
+
 size_t StdDataHash(const void* data, size_t size) {
   return HashReduce(DataHash(data, size));
 }
@@ -43,6 +43,10 @@ hash_t HashBlock(const void* data, size_t n, const hash_t& seed);
 
 hash_t DataHash(const void* data, size_t size);
 
+// Hashes the data with a set of independent 64 bit lanes, which the compiler
+// can map to vector instructions. Much faster than HashBlock() on big buffers.
+hash_t StripeHash(const void* data, size_t size, const hash_t& seed);
+
 size_t StdDataHash(const void* data, size_t size);
 
 size_t StdHashCombine(uintmax_t a, uintmax_t b);
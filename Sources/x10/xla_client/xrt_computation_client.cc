@@ -14,6 +14,8 @@
 
 #include "tensorflow/compiler/xla/xla_client/xrt_computation_client.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cstdlib>
 #include <fstream>
 #include <functional>
@@ -22,7 +24,6 @@
 #include <sstream>
 #include <unordered_map>
 
-#include "absl/container/node_hash_map.h"
 #include "absl/memory/memory.h"
 #include "absl/strings/str_cat.h"
 #include "absl/strings/str_join.h"
@@ -42,6 +43,8 @@
 #include "tensorflow/compiler/xla/util.h"
 #include "tensorflow/core/common_runtime/device_factory.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/lib/core/bits.h"
+#include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/platform/net.h"
 #include "tensorflow/core/protobuf/cluster.pb.h"
 #include "tensorflow/core/util/device_name_utils.h"
@@ -116,7 +119,7 @@ static const char* const kLocalService = "localservice";
 struct TensorAllocatorTraits {
   static void *allocate(size_t size, size_t alignment) {
 #if defined(_WIN32)
-    return ::_aligned_malloc(alignment, size);
+    return ::_aligned_malloc(size, alignment);
 #elif defined(__APPLE__)
     void *ptr;
     ::posix_memalign(&ptr, alignment, size);
@@ -135,32 +138,77 @@ struct TensorAllocatorTraits {
   }
 };
 
-// A simple Tensorflow Allocator which caches Tensor allocations in order to
-// avoid paying the kernel's clear_page_c() price.
+// A size-class slab allocator backing the host Tensors staged by
+// TransferToServer(), so that the blocks of the sizes seen at every step are
+// recycled, rather than paying the kernel's clear_page_c() price again.
+// Requests are rounded up to one of four size classes per power of two (so at
+// most 25% of a block is wasted), and every block is aligned to a cache line,
+// which satisfies all SIMD loads and stores. Freed blocks go on per-thread free
+// lists, which serve the common case without locking. A thread list outgrowing
+// its bound spills half of its blocks to a per-class depot shared by all
+// threads. The free blocks held by the allocator are bounded by a high-water
+// mark (XLA_TENSOR_ALLOCATOR_MAXSIZE): blocks freed above it, as well as the
+// ones larger than the biggest size class, are returned to the OS.
 class TensorAllocator : public tensorflow::Allocator {
-  struct AllocKey {
-    struct Hash {
-      size_t operator()(const AllocKey& hk) const {
-        return util::StdHashCombine(hk.alignment, hk.num_bytes);
-      }
-    };
+  // Cache line alignment, enough for AVX-512.
+  static constexpr size_t kAlignment = 64;
+  static constexpr size_t kMinClassBytes = 64;
+  static constexpr int kMinClassShift = 6;
+  static constexpr int kMaxClassShift = 28;
+  static constexpr size_t kMaxClassBytes = size_t(1) << kMaxClassShift;
+  static constexpr int kClassesPerShift = 4;
+  static constexpr int kNumClasses =
+      1 + (kMaxClassShift - kMinClassShift) * kClassesPerShift;
+  // Marks the blocks which are not part of any size class.
+  static constexpr uint32_t kDirectClass = kNumClasses;
+  // The bytes a thread keeps in the free list of a size class before spilling
+  // to the depot. Each list can always hold at least kMinThreadBlocks blocks.
+  static constexpr size_t kThreadClassBytes = 4 << 20;
+  static constexpr size_t kMinThreadBlocks = 2;
+
+  // Stored right before the memory returned to the caller.
+  struct BlockHeader {
+    uint32_t size_class = 0;
+    // The distance from the start of the OS allocation to the user memory.
+    uint32_t offset = 0;
+  };
 
-    bool operator==(const AllocKey& rhs) const {
-      return num_bytes == rhs.num_bytes && alignment == rhs.alignment;
+  // A singly linked list of free blocks, chained through their first bytes.
+  struct FreeList {
+    void* Pop() {
+      void* block = head;
+      head = *reinterpret_cast<void**>(block);
+      --count;
+      return block;
     }
 
-    size_t alignment = 0;
-    size_t num_bytes = 0;
-  };
+    void Push(void* block) {
+      *reinterpret_cast<void**>(block) = head;
+      head = block;
+      ++count;
+    }
 
-  struct AllocBlocks {
-    explicit AllocBlocks(const AllocKey& alloc_key) : alloc_key(alloc_key) {}
+    void* head = nullptr;
+    size_t count = 0;
+  };
 
-    AllocKey alloc_key;
-    std::vector<void*> blocks;
+  struct Depot {
+    std::mutex lock;
+    FreeList blocks;
   };
 
-  using AllocList = std::list<AllocBlocks>;
+  // Returns its blocks to the depots when its thread exits.
+  struct ThreadCache {
+    ~ThreadCache() {
+      TensorAllocator* allocator = TensorAllocator::Get();
+      for (int size_class = 0; size_class < kNumClasses; ++size_class) {
+        allocator->Spill(size_class, &lists[size_class],
+                         lists[size_class].count);
+      }
+    }
+
+    FreeList lists[kNumClasses];
+  };
 
  public:
   static TensorAllocator* Get() {
@@ -173,90 +221,127 @@ class TensorAllocator : public tensorflow::Allocator {
   std::string Name() override { return "XLA_TensorAllocator"; }
 
   void* AllocateRaw(size_t alignment, size_t num_bytes) override {
-    // We use an alignment-sized area before the memory returned to the caller,
-    // to store a pointer to its AllocBlocks.
-    alignment = std::max<size_t>(alignment, sizeof(void*));
-    // To call aligned_alloc(), num_bytes must be multiple of alignment.
-    num_bytes = RoundUpTo(num_bytes, alignment);
-
-    AllocKey alloc_key = {alignment, num_bytes};
-    void* block = nullptr;
-    AllocBlocks* alloc_blocks = nullptr;
-    std::lock_guard<std::mutex> lock(lock_);
-    auto it = allocs_.find(alloc_key);
-    if (it != allocs_.end()) {
-      alloc_blocks = &*it->second;
-      if (!alloc_blocks->blocks.empty()) {
-        block = alloc_blocks->blocks.back();
-        alloc_blocks->blocks.pop_back();
-      }
-      // LRU
-      alloc_list_.splice(alloc_list_.begin(), alloc_list_, it->second);
-    } else {
-      allocs_.emplace(alloc_key, alloc_list_.insert(alloc_list_.begin(),
-                                                    AllocBlocks(alloc_key)));
-      alloc_blocks = &alloc_list_.front();
+    if (alignment > kAlignment || num_bytes > kMaxClassBytes) {
+      return NewBlock(kDirectClass, std::max(alignment, size_t{kAlignment}),
+                      num_bytes);
+    }
+    int size_class = SizeClass(num_bytes);
+    FreeList* list = &GetThreadCache()->lists[size_class];
+    if (list->count == 0) {
+      Refill(size_class, list);
     }
-    if (block == nullptr) {
-      TrimCache(alloc_key.num_bytes);
-      block = NewBlock(alloc_blocks);
+    if (list->count == 0) {
+      XLA_COUNTER("TensorAllocatorSlabMiss", 1);
+      return NewBlock(size_class, kAlignment, ClassBytes(size_class));
     }
-    return block;
+    cached_bytes_ -= ClassBytes(size_class);
+    return list->Pop();
   }
 
   void DeallocateRaw(void* ptr) override {
-    if (ptr != nullptr) {
-      // The pointer to AllocBlocks is right before the user memory.
-      AllocBlocks* alloc_blocks = reinterpret_cast<AllocBlocks**>(ptr)[-1];
-      std::lock_guard<std::mutex> lock(lock_);
-      if (alloc_blocks->alloc_key.num_bytes < max_size_) {
-        alloc_blocks->blocks.push_back(ptr);
-      } else {
-        // We do not cache blocks whose size is bigger than the max cache size.
-        FreeBlock(ptr, alloc_blocks);
-      }
+    if (ptr == nullptr) {
+      return;
+    }
+    uint32_t size_class = GetHeader(ptr)->size_class;
+    if (size_class == kDirectClass) {
+      FreeBlock(ptr);
+      return;
+    }
+    size_t class_bytes = ClassBytes(size_class);
+    if (cached_bytes_.fetch_add(class_bytes) + class_bytes > max_size_) {
+      // Above the high-water mark, the block goes back to the OS.
+      cached_bytes_ -= class_bytes;
+      FreeBlock(ptr);
+      return;
+    }
+    FreeList* list = &GetThreadCache()->lists[size_class];
+    list->Push(ptr);
+    size_t max_blocks = std::max(size_t{kMinThreadBlocks},
+                                 kThreadClassBytes / class_bytes);
+    if (list->count > max_blocks) {
+      Spill(size_class, list, list->count / 2);
     }
   }
 
  private:
   explicit TensorAllocator(size_t max_size) : max_size_(max_size) {}
 
-  void* NewBlock(AllocBlocks* alloc_blocks) {
-    // We allocate an extra alignment sized area to store the AllocBlocks
-    // pointer.
-    void *ptr = TensorAllocatorTraits::allocate(
-        alloc_blocks->alloc_key.alignment + alloc_blocks->alloc_key.num_bytes,
-        alloc_blocks->alloc_key.alignment);
+  static ThreadCache* GetThreadCache() {
+    static thread_local ThreadCache cache;
+    return &cache;
+  }
+
+  static BlockHeader* GetHeader(void* ptr) {
+    return reinterpret_cast<BlockHeader*>(ptr) - 1;
+  }
+
+  static int SizeClass(size_t num_bytes) {
+    if (num_bytes <= kMinClassBytes) {
+      return 0;
+    }
+    // num_bytes is in (2^shift, 2^(shift + 1)], which is split in
+    // kClassesPerShift classes of step bytes.
+    int shift = tensorflow::Log2Floor64(num_bytes - 1);
+    size_t step = size_t(1) << (shift - 2);
+    size_t index = (num_bytes - (size_t(1) << shift) + step - 1) / step;
+    return 1 + (shift - kMinClassShift) * kClassesPerShift + index - 1;
+  }
+
+  static size_t ClassBytes(int size_class) {
+    if (size_class == 0) {
+      return kMinClassBytes;
+    }
+    int shift = kMinClassShift + (size_class - 1) / kClassesPerShift;
+    size_t index = 1 + (size_class - 1) % kClassesPerShift;
+    return (size_t(1) << shift) + index * (size_t(1) << (shift - 2));
+  }
+
+  void* NewBlock(uint32_t size_class, size_t alignment, size_t num_bytes) {
+    // The header takes an alignment sized area before the user memory, and
+    // aligned_alloc() needs a size multiple of the alignment.
+    void* ptr = TensorAllocatorTraits::allocate(
+        alignment + RoundUpTo(std::max<size_t>(num_bytes, 1), alignment),
+        alignment);
     XLA_CHECK(ptr != nullptr);
-    ptr = reinterpret_cast<char*>(ptr) + alloc_blocks->alloc_key.alignment;
-    // Store the pointer to AllocBlocks right before the user memory.
-    reinterpret_cast<AllocBlocks**>(ptr)[-1] = alloc_blocks;
-    size_ += alloc_blocks->alloc_key.num_bytes;
+    ptr = reinterpret_cast<char*>(ptr) + alignment;
+    BlockHeader* header = GetHeader(ptr);
+    header->size_class = size_class;
+    header->offset = alignment;
     return ptr;
   }
 
-  void FreeBlock(void* ptr, AllocBlocks* alloc_blocks) {
-    size_ -= alloc_blocks->alloc_key.num_bytes;
-    TensorAllocatorTraits::deallocate(
-        reinterpret_cast<char*>(ptr) - alloc_blocks->alloc_key.alignment);
+  static void FreeBlock(void* ptr) {
+    TensorAllocatorTraits::deallocate(reinterpret_cast<char*>(ptr) -
+                                      GetHeader(ptr)->offset);
   }
 
-  void TrimCache(size_t num_bytes) {
-    auto it = alloc_list_.rbegin();
-    for (; size_ + num_bytes > max_size_ && it != alloc_list_.rend(); ++it) {
-      AllocBlocks* alloc_blocks = &*it;
-      while (!alloc_blocks->blocks.empty() && size_ + num_bytes > max_size_) {
-        FreeBlock(alloc_blocks->blocks.back(), alloc_blocks);
-        alloc_blocks->blocks.pop_back();
-      }
+  // Moves up to half the thread list bound of blocks from the depot.
+  void Refill(int size_class, FreeList* list) {
+    Depot* depot = &depots_[size_class];
+    size_t count = std::max(size_t{kMinThreadBlocks},
+                            kThreadClassBytes / ClassBytes(size_class)) /
+                   2;
+    std::lock_guard<std::mutex> lock(depot->lock);
+    for (; count > 0 && depot->blocks.count > 0; --count) {
+      list->Push(depot->blocks.Pop());
+    }
+  }
+
+  void Spill(int size_class, FreeList* list, size_t count) {
+    if (count == 0) {
+      return;
+    }
+    Depot* depot = &depots_[size_class];
+    std::lock_guard<std::mutex> lock(depot->lock);
+    for (; count > 0; --count) {
+      depot->blocks.Push(list->Pop());
     }
   }
 
   size_t max_size_ = 0;
-  std::mutex lock_;
-  size_t size_ = 0;
-  AllocList alloc_list_;
-  absl::node_hash_map<AllocKey, AllocList::iterator, AllocKey::Hash> allocs_;
+  // The bytes of the free blocks held by the thread lists and the depots.
+  std::atomic<size_t> cached_bytes_{0};
+  Depot depots_[kNumClasses];
 };
 
 std::string StripPrefix(const std::string& value, const std::string& prefix) {
@@ -506,6 +591,14 @@ int64_t GetMaxTensorsPartitionSize() {
   return max_partition_size;
 }
 
+int64_t GetMaxInflightTransferPartitions() {
+  // Every partition in flight holds its tensors fully materialized in host
+  // memory, so this bounds the host staging memory used by large uploads.
+  static int64_t max_inflight_partitions = std::max<int64_t>(
+      sys_util::GetEnvInt("XRT_MAX_INFLIGHT_TRANSFER_PARTITIONS", 2), 1);
+  return max_inflight_partitions;
+}
+
 bool GpuIsAvailable() {
   std::vector<string> devices;
   tensorflow::Status s =
@@ -593,6 +686,7 @@ XrtComputationClient::XrtComputationClient(
     Options options,
     std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto)
     : options_(std::move(options)),
+      topology_proto_(std::move(topology_proto)),
       compilation_cache_(sys_util::GetEnvInt("XLA_COMPILATION_CACHE_SIZE", 64)),
       rng_seed_(0x5a2d296e9) {
   tensorflow::ConfigProto config = CreateConfigProto(options_);
@@ -623,20 +717,37 @@ XrtComputationClient::XrtComputationClient(
                << "/replica:0/task:" << worker_target.first.task_no;
   }
   TF_VLOG(1) << "XRT default device: " << options_.default_device;
-  MaybeCreateLocalService(options_);
-  InitializeDevices(std::move(topology_proto));
   StartHandleReleaser();
+  if (!GetMultiProcessingDevice().empty()) {
+    // The other processes wait for the mesh service at creation, so it cannot
+    // be deferred.
+    EnsureXrtInitialized();
+  }
 
   for (const auto& dev_target : options_.global_device_map) {
     AddDevice(std::make_unique<XrtDevice>(dev_target.first, this));
   }
 
-  for (auto& device : GetAllLocalDevicesForPlatform("gpu", "GPU")) {
+  // Only the GPU count is needed to pick the default device. The devices
+  // themselves are created when one is first looked up.
+  if (GetLocalDeviceCountForPlatform("gpu") > 0) {
     options_.default_device = "GPU:0";
-    AddDevice(std::move(device));
+    SetLazyDeviceInitializer([this]() {
+      for (auto& device : GetAllLocalDevicesForPlatform("gpu", "GPU")) {
+        AddDevice(std::move(device));
+      }
+    });
   }
 }
 
+void XrtComputationClient::EnsureXrtInitialized() {
+  std::call_once(xrt_init_once_, [this]() {
+    MaybeCreateLocalService(options_);
+    InitializeDevices(std::move(topology_proto_));
+    xrt_initialized_ = true;
+  });
+}
+
 std::vector<size_t> XrtComputationClient::PartitionTransferToServer(
     absl::Span<const TensorSource> tensors) {
   int64_t max_partition_size = GetMaxTensorsPartitionSize();
@@ -670,18 +781,26 @@ XrtComputationClient::XrtDevice::TransferToServer(
   }
   XLA_COUNTER("XrtPartitionedTransferToServer", 1);
 
-  util::MultiWait mwait(partitions.size());
+  // Partitions are picked up by a bounded number of senders, instead of being
+  // all converted at once, to cap the host memory used for staging.
+  size_t num_senders = std::min<size_t>(partitions.size(),
+                                        GetMaxInflightTransferPartitions());
+  std::atomic<size_t> next_partition(0);
+  util::MultiWait mwait(num_senders);
   std::vector<DataPtr> results(tensors.size());
-  for (size_t i = 0; i < partitions.size(); ++i) {
-    auto sender = [&, i]() {
-      size_t base_index = partitions[i];
-      size_t length = (i + 1 < partitions.size())
-                          ? partitions[i + 1] - base_index
-                          : tensors.size() - base_index;
-      auto partitions_results = client_->TransferToServerInternal(
-          this, tensors.subspan(base_index, length));
-      for (size_t r = 0; r < length; ++r) {
-        results[base_index + r] = std::move(partitions_results[r]);
+  for (size_t s = 0; s < num_senders; ++s) {
+    auto sender = [&]() {
+      for (size_t i = next_partition++; i < partitions.size();
+           i = next_partition++) {
+        size_t base_index = partitions[i];
+        size_t length = (i + 1 < partitions.size())
+                            ? partitions[i + 1] - base_index
+                            : tensors.size() - base_index;
+        auto partitions_results = client_->TransferToServerInternal(
+            this, tensors.subspan(base_index, length));
+        for (size_t r = 0; r < length; ++r) {
+          results[base_index + r] = std::move(partitions_results[r]);
+        }
       }
     };
     env::ScheduleIoClosure(mwait.Completer(std::move(sender)));
@@ -744,8 +863,10 @@ XrtComputationClient::TransferToServerInternal(
     SessionWork* session_work = &session_session_work.second;
     auto runner = [&, session, session_work]() {
       std::vector<tensorflow::Tensor> outputs;
-      XLA_CHECK_OK(session->session()->Run(
-          session_work->feed_inputs, session_work->outputs_handles, &outputs));
+      XLA_CHECK_OK(RunReleasingOnExhaustion([&]() {
+        return session->session()->Run(session_work->feed_inputs,
+                                       session_work->outputs_handles, &outputs);
+      }));
       XLA_CHECK_EQ(outputs.size(), session_work->outputs_handles.size());
 
       for (size_t i = 0; i < outputs.size(); ++i) {
@@ -819,6 +940,8 @@ std::vector<ComputationClient::ComputationPtr> XrtComputationClient::Compile(
     const std::string& device, const std::vector<std::string>& devices,
     std::vector<CompileInstance> instances) {
   metrics::TimedSection timed(CompileMetric());
+  // The device assignments need the TPU mesh coordinates.
+  EnsureXrtInitialized();
 
   std::mutex lock;
   util::MultiWait mwait(instances.size());
@@ -929,7 +1052,10 @@ XrtComputationClient::ExecuteComputation(
       GetSessionForDevice(session_cache_.get(), effective_device, &session_map);
   std::vector<tensorflow::Tensor> outputs;
   util::CheckComputationStatus(
-      session->session()->Run(feed_inputs, {exec_ops.front()}, &outputs),
+      RunReleasingOnExhaustion([&]() {
+        return session->session()->Run(feed_inputs, {exec_ops.front()},
+                                       &outputs);
+      }),
       {&computation.computation()}, {&computation.program_shape().result()});
   XLA_CHECK_EQ(outputs.size(), 1);
 
@@ -1257,6 +1383,7 @@ XrtComputationClient::DeconstructTuple(absl::Span<const DataPtr> tuples) {
 XrtSession* XrtComputationClient::GetSessionForTarget(
     XrtSessionCache* cache, const std::string& target,
     XrtSessionCache::SessionMap* session_map) {
+  EnsureXrtInitialized();
   return cache->GetSession(target, session_map);
 }
 
@@ -1420,8 +1547,16 @@ std::vector<tensorflow::Output> XrtComputationClient::CreateExecuteOps(
   return exec_ops;
 }
 
+bool XrtComputationClient::IsReleaseDue(
+    const ReleaseQueue& queue,
+    std::chrono::steady_clock::time_point now) const {
+  return !queue.handles.empty() &&
+         (queue.handles.size() >= release_batch_size_ ||
+          now >= queue.oldest + release_latency_);
+}
+
 void XrtComputationClient::ReleaseHandles(
-    std::vector<DeviceHandle>* handles,
+    ReleaseQueue* queue,
     const std::function<const XrtSession::CachedNode&(
         XrtSession*, const tensorflow::Scope&, const std::string&)>&
         op_generator,
@@ -1429,10 +1564,13 @@ void XrtComputationClient::ReleaseHandles(
   std::vector<DeviceHandle> released_handles;
   {
     std::lock_guard<std::mutex> lock(lock_);
-    released_handles.swap(*handles);
+    released_handles.swap(queue->handles);
   }
+  // Wakes up the callers held back by a full backlog.
+  release_cv_.notify_all();
   if (!released_handles.empty()) {
     metrics::TimedSection timed(timed_metric);
+    XLA_VALUE_METRIC("XrtReleaseBatchSize", released_handles.size());
 
     XrtSessionCache::SessionMap session_map;
     std::map<XrtSession*, std::vector<DeviceHandle>> session_handles_map;
@@ -1472,11 +1610,49 @@ void XrtComputationClient::StartHandleReleaser() {
   int64_t num_threads = sys_util::GetEnvInt(
       "XLA_HANDLE_RELEASE_THREADS",
       std::max<size_t>(options_.devices.size(), kMinReleaserThreads));
+  release_batch_size_ = std::max<int64_t>(
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_BATCH", 1024), 1);
+  release_latency_ = std::chrono::milliseconds(
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_LATENCY_MS", 10));
+  release_backlog_limit_ = std::max<int64_t>(
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_BACKLOG", 100000),
+      release_batch_size_);
+  release_backpressure_timeout_ = std::chrono::milliseconds(
+      sys_util::GetEnvInt("XLA_HANDLE_RELEASE_BACKPRESSURE_MS", 1000));
   triggered_task_ = absl::make_unique<util::TriggeredTask>(
       [this]() { HandleReleaser(); }, num_threads);
 }
 
 void XrtComputationClient::HandleReleaser() {
+  {
+    // Coalesces the releases until one of the queues is due, instead of
+    // issuing a release round-trip for every few handles, which would compete
+    // with the executions on the same sessions.
+    std::unique_lock<std::mutex> lock(lock_);
+    while (true) {
+      auto now = std::chrono::steady_clock::now();
+      if (released_data_handles_.handles.empty() &&
+          released_compile_handles_.handles.empty()) {
+        return;
+      }
+      if (IsReleaseDue(released_data_handles_, now) ||
+          IsReleaseDue(released_compile_handles_, now)) {
+        break;
+      }
+      auto deadline = std::chrono::steady_clock::time_point::max();
+      for (const ReleaseQueue* queue :
+           {&released_data_handles_, &released_compile_handles_}) {
+        if (!queue->handles.empty()) {
+          deadline = std::min(deadline, queue->oldest + release_latency_);
+        }
+      }
+      release_cv_.wait_until(lock, deadline);
+    }
+  }
+  FlushReleasedHandles();
+}
+
+void XrtComputationClient::FlushReleasedHandles() {
   auto data_op_generator =
       [this](XrtSession* session, const tensorflow::Scope& scope,
              const std::string& device) -> const XrtSession::CachedNode& {
@@ -1495,14 +1671,57 @@ void XrtComputationClient::HandleReleaser() {
                  DestroyCompileHandlesCounter());
 }
 
+Status XrtComputationClient::RunReleasingOnExhaustion(
+    const std::function<Status()>& run_fn) {
+  Status status = run_fn();
+  if (tensorflow::errors::IsResourceExhausted(status)) {
+    // The handles waiting in the release queues may hold the memory the step
+    // needs.
+    XLA_COUNTER("XrtReleaseOnExhaustion", 1);
+    FlushReleasedHandles();
+    status = run_fn();
+  }
+  return status;
+}
+
 void XrtComputationClient::ReleaseHandle(int64_t handle,
                                          const std::string& device,
-                                         std::vector<DeviceHandle>* handles) {
+                                         ReleaseQueue* queue) {
+  bool activate = false;
+  bool wake = false;
   {
-    std::lock_guard<std::mutex> lock(lock_);
-    handles->push_back({device, handle});
+    std::unique_lock<std::mutex> lock(lock_);
+    if (queue->handles.size() >= release_backlog_limit_) {
+      // The releasers are falling behind, so hold the caller back until they
+      // take the backlog, rather than letting it grow without bound. The wait
+      // is bounded, as the caller may be a thread the releasers depend on.
+      XLA_COUNTER("XrtReleaseBackPressure", 1);
+      lock.unlock();
+      triggered_task_->Activate();
+      lock.lock();
+      if (!release_cv_.wait_for(lock, release_backpressure_timeout_, [&]() {
+            return queue->handles.size() < release_backlog_limit_;
+          })) {
+        XLA_COUNTER("XrtReleaseBackPressureTimeouts", 1);
+      }
+    }
+    if (queue->handles.empty()) {
+      // Arms a releaser which waits for the latency threshold.
+      queue->oldest = std::chrono::steady_clock::now();
+      activate = true;
+    }
+    queue->handles.push_back({device, handle});
+    if (queue->handles.size() == release_batch_size_) {
+      // Wakes up the releaser waiting for the batch to fill.
+      wake = true;
+    }
+  }
+  if (wake) {
+    release_cv_.notify_all();
+  }
+  if (activate) {
+    triggered_task_->Activate();
   }
-  triggered_task_->Activate();
 }
 
 void XrtComputationClient::ReleaseXrtData(const std::string& device,
@@ -1766,6 +1985,10 @@ std::map<std::string, Metric> XrtComputationClient::GetMetrics() const {
            "XrtExecutorEvict"}};
 
   std::map<std::string, Metric> metrics_data;
+  if (!xrt_initialized_) {
+    // The workers have not been contacted yet, so they have no XRT metrics.
+    return metrics_data;
+  }
   xrt::XRTMetricsCollect metrics;
   metrics.add_metrics_regex("/tensorflow/xrt/.*");
 
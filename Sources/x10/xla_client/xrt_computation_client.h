@@ -18,6 +18,8 @@
 #define X10_XLA_CLIENT_XRT_COMPUTATION_CLIENT_H_
 
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <functional>
 #include <map>
 #include <memory>
@@ -57,6 +59,14 @@ class XrtComputationClient : public ComputationClient,
     int64_t handle;
   };
 
+  // The handles waiting to be released, which are coalesced until a count or
+  // a latency threshold is hit.
+  struct ReleaseQueue {
+    std::vector<DeviceHandle> handles;
+    // When the oldest of the handles was queued.
+    std::chrono::steady_clock::time_point oldest;
+  };
+
   class XrtDevice;
 
   struct XrtHandle {
@@ -292,7 +302,12 @@ class XrtComputationClient : public ComputationClient,
   std::pair<Worker, std::string> GetWorkerForXrtDevice(
       const std::string& xrt_device) const;
 
-  void ReleaseHandles(std::vector<DeviceHandle>* handles,
+  // Whether the handles of the queue are to be released now. Must be called
+  // while holding lock_.
+  bool IsReleaseDue(const ReleaseQueue& queue,
+                    std::chrono::steady_clock::time_point now) const;
+
+  void ReleaseHandles(ReleaseQueue* queue,
                       const std::function<const XrtSession::CachedNode&(
                           XrtSession*, const tensorflow::Scope&,
                           const std::string&)>& op_generator,
@@ -300,7 +315,7 @@ class XrtComputationClient : public ComputationClient,
                       metrics::Counter* destroy_counter);
 
   void ReleaseHandle(int64_t handle, const std::string& device,
-                     std::vector<DeviceHandle>* handles);
+                     ReleaseQueue* queue);
 
   void ReleaseXrtData(const std::string& device, int64_t handle);
 
@@ -310,10 +325,20 @@ class XrtComputationClient : public ComputationClient,
   // Starts the handle releaser thread (which runs the HandleReleaser() API).
   void StartHandleReleaser();
 
-  // The handler releaser function. Runs in the releaser thread and never
-  // returns.
+  // The handler releaser function. Runs in the releaser threads, waits until
+  // a release queue reaches the batch size or the latency threshold, and
+  // releases the queued handles.
   void HandleReleaser();
 
+  // Releases the queued handles right away, on the calling thread.
+  void FlushReleasedHandles();
+
+  // Runs run_fn, which runs a session step allocating device memory. If the
+  // step runs out of memory, the queued handles are released and the step is
+  // run once more. Only used for single device steps, which can be retried as
+  // a whole.
+  Status RunReleasingOnExhaustion(const std::function<Status()>& run_fn);
+
   // Retrieves the mesh coordinates of a given XRT device.
   const std::vector<int>& GetDeviceMeshCoords(
       const std::string& xrt_device) const;
@@ -321,6 +346,12 @@ class XrtComputationClient : public ComputationClient,
   void InitializeDevices(
       std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto);
 
+  // Starts the local service, and fetches the TPU topology and creates the
+  // mesh service (through InitializeDevices()), the first time it is called.
+  // This is deferred until an XRT device is first used, since short lived
+  // processes may never touch one.
+  void EnsureXrtInitialized();
+
   void CreateMeshService(const std::string& address,
                          const tensorflow::tpu::TopologyProto* topology_proto);
 
@@ -485,6 +516,10 @@ class XrtComputationClient : public ComputationClient,
   Options options_;
   std::mutex lock_;
   std::map<std::string, std::vector<int>> device_mesh_coords_;
+  // The topology handed to InitializeDevices() by EnsureXrtInitialized().
+  std::unique_ptr<tensorflow::tpu::TopologyProto> topology_proto_;
+  std::once_flag xrt_init_once_;
+  std::atomic<bool> xrt_initialized_{false};
   std::unique_ptr<XrtSessionCache> session_cache_;
   std::unique_ptr<XrtSessionCache> alloc_session_cache_;
   std::unique_ptr<util::TriggeredTask> triggered_task_;
@@ -493,8 +528,16 @@ class XrtComputationClient : public ComputationClient,
   std::atomic<size_t> rng_seed_;
   // Access to the following members must be done while holding lock_.
   // XRT thread safety semantics.
-  std::vector<DeviceHandle> released_data_handles_;
-  std::vector<DeviceHandle> released_compile_handles_;
+  ReleaseQueue released_data_handles_;
+  ReleaseQueue released_compile_handles_;
+  // Signaled when handles are queued or taken for release.
+  std::condition_variable release_cv_;
+  size_t release_batch_size_ = 0;
+  std::chrono::milliseconds release_latency_{0};
+  size_t release_backlog_limit_ = 0;
+  // How long a caller is held back by a full backlog, before queueing its
+  // handle anyway.
+  std::chrono::milliseconds release_backpressure_timeout_{0};
   // The mesh service which is used to coordinate all the client hosts which are
   // feeding different TPU devices in a POD (or slice) training.
   std::unique_ptr<service::MeshService> mesh_service_;
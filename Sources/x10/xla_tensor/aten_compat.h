@@ -19,8 +19,11 @@
 #include <cassert>
 #include <cstdint>
 #include <cstring>
+#include <functional>
+#include <memory>
 #include <ostream>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "absl/types/optional.h"
@@ -361,6 +364,7 @@
   _(aten, frobenius_norm)                                   \
   _(aten, full)                                             \
   _(aten, full_like)                                        \
+  _(aten, functional_scan)                                  \
   _(aten, functional_while)                                 \
   _(aten, gather)                                           \
   _(aten, ge)                                               \
@@ -769,25 +773,31 @@
   _(aten, xla_is_inf)                                       \
   _(aten, xla_is_nan)
 
-#define FORALL_XLA_SYMBOLS(_, __)  \
-  __(xla, all_to_all)              \
-  _(xla, as_strided_view_update)   \
-  _(xla, cast)                     \
-  _(xla, collective_permute)       \
-  _(xla, cross_replica_sum)        \
-  _(xla, device_data)              \
-  _(xla, diagonal_view_update)     \
-  _(xla, generic_slice)            \
-  _(xla, get_dimensions_size)      \
-  _(xla, moving_average)           \
-  _(xla, nms)                      \
-  _(xla, not_supported)            \
-  _(xla, replication_pad)          \
-  _(xla, replication_pad_backward) \
-  _(xla, select)                   \
-  _(xla, tensor_data)              \
-  _(xla, token)                    \
-  _(xla, unselect)                 \
+#define FORALL_XLA_SYMBOLS(_, __)       \
+  __(xla, all_finite)                   \
+  _(xla, all_to_all)                    \
+  _(xla, as_strided_view_update)        \
+  _(xla, cast)                          \
+  _(xla, collective_permute)            \
+  _(xla, conv_bias_activation)          \
+  _(xla, conv_bias_activation_backward) \
+  _(xla, cross_replica_sum)             \
+  _(xla, device_data)                   \
+  _(xla, diagonal_view_update)          \
+  _(xla, generic_slice)                 \
+  _(xla, get_dimensions_size)           \
+  _(xla, moving_average)                \
+  _(xla, nms)                           \
+  _(xla, not_supported)                 \
+  _(xla, optimizer_update)              \
+  _(xla, replication_pad)               \
+  _(xla, replication_pad_backward)      \
+  _(xla, rng_seed)                      \
+  _(xla, rng_seed_pair)                 \
+  _(xla, select)                        \
+  _(xla, tensor_data)                   \
+  _(xla, token)                         \
+  _(xla, unselect)                      \
   _(xla, update_slice)
 
 namespace at {
@@ -974,6 +984,9 @@ class AnyScalarBuffer {
   AnyScalarBuffer& operator=(AnyScalarBuffer&&) = delete;
   virtual ~AnyScalarBuffer() {}
 
+  // Whether the data is owned by a caller which waits for it to be released.
+  virtual bool borrowed() const { return false; }
+
   template <typename T>
   static std::unique_ptr<AnyScalarBuffer> make(std::unique_ptr<T[]> data,
                                                size_t len);
@@ -1064,6 +1077,31 @@ class NonOwnedAnyScalarBuffer : public AnyScalarBuffer {
   }
 };
 
+// Implementation of Scalar buffer backed by a caller owned data buffer. The
+// release function is called once the buffer is no longer referenced.
+template <typename T>
+class BorrowedAnyScalarBuffer : public AnyScalarBuffer {
+ public:
+  BorrowedAnyScalarBuffer(const T* data, size_t len,
+                          std::function<void()> release)
+      : AnyScalarBuffer(internal::GetScalarType<T>()),
+        release_(std::move(release)) {
+    set_base(data);
+    set_size(len);
+  }
+
+  ~BorrowedAnyScalarBuffer() override {
+    if (release_) {
+      release_();
+    }
+  }
+
+  bool borrowed() const override { return true; }
+
+ private:
+  std::function<void()> release_;
+};
+
 template <typename T>
 std::unique_ptr<AnyScalarBuffer> AnyScalarBuffer::make(
     std::unique_ptr<T[]> data, size_t len) {
@@ -1078,6 +1116,8 @@ inline size_t GetLenFromShape(const std::vector<int64_t>& shape) {
   return result;
 }
 
+// A host tensor, whose elements are stored contiguously in dim0-major order.
+// Copies share the buffer, which is never written after creation.
 class Tensor {
  public:
   Tensor(std::vector<float> data, std::vector<int64_t> shape)
@@ -1110,9 +1150,21 @@ class Tensor {
 
   const std::vector<int64_t>& shape() const { return shape_; }
 
+  size_t numel() const { return GetLenFromShape(shape_); }
+
+  size_t nbytes() const { return internal::GetSizeof(scalar_type()) * numel(); }
+
+  // The address of the first element.
+  template <typename T>
+  const T* data_ptr() const {
+    return data_->data<const T>();
+  }
+
+  const void* raw_data() const { return data_->raw_data(); }
+
   template <typename T>
   absl::Span<const T> data() const {
-    return absl::Span<const T>(data_->data<const T>(), data_->size());
+    return absl::Span<const T>(data_ptr<T>(), numel());
   }
 
   size_t rank() const { return shape().size(); }
@@ -1121,7 +1173,7 @@ class Tensor {
     switch (scalar_type()) {
 #define DEFINE_ITEM_CASE(name, aten_name, type) \
   case ScalarType::aten_name:                   \
-    return data<type>()[0];
+    return data_ptr<type>()[0];
       LIST_SCALAR_TYPES(DEFINE_ITEM_CASE)
 #undef DEFINE_ITEM_CASE
     }
@@ -0,0 +1,116 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/auto_mixed_precision.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+using OpNameSet = absl::flat_hash_set<std::string>;
+
+OpNameSet* LoadOpNames(const char* env, const char* defval) {
+  std::string names = xla::sys_util::GetEnvString(env, defval);
+  std::vector<std::string> name_list =
+      absl::StrSplit(names, ',', absl::SkipWhitespace());
+  return new OpNameSet(name_list.begin(), name_list.end());
+}
+
+const OpNameSet& AllowedOps() {
+  static const OpNameSet* ops = LoadOpNames(
+      "XLA_AMP_ALLOW_OPS",
+      "mm,matmul,tf_convolution,tf_conv_backprop_filter,"
+      "tf_conv_backprop_input,conv_bias_activation,"
+      "conv_bias_activation_backward");
+  return *ops;
+}
+
+const OpNameSet& DeniedOps() {
+  static const OpNameSet* ops = LoadOpNames(
+      "XLA_AMP_DENY_OPS",
+      "sum,mean,prod,cumsum,cumprod,softmax,log_softmax,"
+      "_log_softmax_backward_data,nll_loss,exp,log,pow");
+  return *ops;
+}
+
+// Strips the namespace from the qualified op name.
+absl::string_view OpName(const Node* node) {
+  absl::string_view name(node->op().op.toQualString());
+  size_t pos = name.rfind("::");
+  return pos == absl::string_view::npos ? name : name.substr(pos + 2);
+}
+
+xla::PrimitiveType DefaultReducedType() {
+  std::string type = xla::sys_util::GetEnvString("XLA_AMP_TYPE", "");
+  if (type.empty()) {
+    return xla::PRIMITIVE_TYPE_INVALID;
+  } else if (type == "bf16") {
+    return xla::PrimitiveType::BF16;
+  } else if (type == "f16") {
+    return xla::PrimitiveType::F16;
+  }
+  XLA_ERROR() << "Invalid mixed precision type: " << type;
+}
+
+std::atomic<int>& ReducedTypeStorage() {
+  static std::atomic<int>* type = new std::atomic<int>(DefaultReducedType());
+  return *type;
+}
+
+}  // namespace
+
+xla::PrimitiveType AutoMixedPrecision::reduced_type() {
+  return static_cast<xla::PrimitiveType>(ReducedTypeStorage().load());
+}
+
+void AutoMixedPrecision::set_reduced_type(xla::PrimitiveType type) {
+  XLA_CHECK(type == xla::PRIMITIVE_TYPE_INVALID ||
+            type == xla::PrimitiveType::BF16 ||
+            type == xla::PrimitiveType::F16)
+      << "Invalid mixed precision type: " << type;
+  ReducedTypeStorage().store(type);
+}
+
+xla::PrimitiveType AutoMixedPrecision::GetLoweringType(const Node* node) {
+  xla::PrimitiveType type = reduced_type();
+  if (type == xla::PRIMITIVE_TYPE_INVALID) {
+    return type;
+  }
+  absl::string_view name = OpName(node);
+  if (DeniedOps().contains(name)) {
+    return xla::PrimitiveType::F32;
+  }
+  if (AllowedOps().contains(name)) {
+    return type;
+  }
+  return xla::PRIMITIVE_TYPE_INVALID;
+}
+
+xla::hash_t AutoMixedPrecision::Hash() {
+  return xla::util::MHash(static_cast<int>(reduced_type()));
+}
+
+}  // namespace ir
+}  // namespace swift_xla
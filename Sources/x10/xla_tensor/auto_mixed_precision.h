@@ -0,0 +1,52 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/xla/xla_data.pb.h"
+
+namespace swift_xla {
+namespace ir {
+
+// Automatic mixed precision, applied while lowering the IR graph. Operations of
+// the allow list (matrix multiplications and convolutions by default) get their
+// F32 operands converted to the reduced precision type. Operations of the deny
+// list (reductions, softmax and losses by default) get their reduced precision
+// operands converted to F32. The outputs are converted back to the element type
+// of the IR node, so the model weights and the rest of the graph keep their
+// precision. The lists can be replaced with the comma separated op names in
+// XLA_AMP_ALLOW_OPS and XLA_AMP_DENY_OPS.
+class AutoMixedPrecision {
+ public:
+  // The reduced precision type, or PRIMITIVE_TYPE_INVALID if automatic mixed
+  // precision is disabled. The default is taken from XLA_AMP_TYPE, which can
+  // be "bf16" or "f16".
+  static xla::PrimitiveType reduced_type();
+
+  static void set_reduced_type(xla::PrimitiveType type);
+
+  // Returns the element type the floating point operands of node are lowered
+  // with, or PRIMITIVE_TYPE_INVALID if the node is lowered unchanged.
+  static xla::PrimitiveType GetLoweringType(const Node* node);
+
+  // Returns the hash to combine with the graph hash, so that computations
+  // lowered with different settings do not share a cache entry.
+  static xla::hash_t Hash();
+};
+
+}  // namespace ir
+}  // namespace swift_xla
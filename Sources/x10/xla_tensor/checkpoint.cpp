@@ -0,0 +1,339 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/checkpoint.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <memory>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace swift_xla {
+namespace {
+
+constexpr char kCheckpointMagic[8] = {'X', '1', '0', 'C', 'K', 'P', 'T', '1'};
+
+struct CheckpointEntry {
+  std::string name;
+  xla::PrimitiveType type = xla::PrimitiveType::PRIMITIVE_TYPE_INVALID;
+  std::vector<int64_t> dimensions;
+  uint64_t offset = 0;
+  uint64_t size = 0;
+};
+
+uint64_t GetAlignment() {
+  // Entries start on page boundaries, so that madvise() can be applied to the
+  // mapped ranges while loading.
+  static const uint64_t alignment = sysconf(_SC_PAGESIZE);
+  return alignment;
+}
+
+uint64_t AlignUp(uint64_t value) {
+  uint64_t alignment = GetAlignment();
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+int64_t GetBatchSize() {
+  // Bounds the host memory holding tensor values while saving, and the amount
+  // of data staged for upload while loading.
+  static const int64_t batch_size = xla::sys_util::GetEnvInt(
+      "XLA_CHECKPOINT_BATCH_SIZE", 1024 * 1024 * 1024);
+  return batch_size;
+}
+
+// Splits the entries into consecutive batches of about GetBatchSize() bytes,
+// returning the start index of every batch.
+std::vector<size_t> PartitionEntries(
+    const std::vector<CheckpointEntry>& entries) {
+  std::vector<size_t> partitions;
+  uint64_t current_size = 0;
+  for (size_t i = 0; i < entries.size(); ++i) {
+    if (partitions.empty() ||
+        current_size + entries[i].size > GetBatchSize()) {
+      partitions.push_back(i);
+      current_size = 0;
+    }
+    current_size += entries[i].size;
+  }
+  return partitions;
+}
+
+template <typename T>
+void AppendValue(std::string* data, T value) {
+  data->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+std::string SerializeIndex(const std::vector<CheckpointEntry>& entries) {
+  std::string index(kCheckpointMagic, sizeof(kCheckpointMagic));
+  AppendValue<uint64_t>(&index, entries.size());
+  for (auto& entry : entries) {
+    AppendValue<uint64_t>(&index, entry.name.size());
+    index.append(entry.name);
+    AppendValue<int32_t>(&index, entry.type);
+    AppendValue<uint64_t>(&index, entry.dimensions.size());
+    for (int64_t dim : entry.dimensions) {
+      AppendValue<int64_t>(&index, dim);
+    }
+    AppendValue<uint64_t>(&index, entry.offset);
+    AppendValue<uint64_t>(&index, entry.size);
+  }
+  return index;
+}
+
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Advance(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  std::string ReadString(size_t length) {
+    return std::string(Advance(length), length);
+  }
+
+ private:
+  const char* Advance(size_t length) {
+    XLA_CHECK_LE(length, size_ - offset_) << "Truncated checkpoint index";
+    const char* ptr = data_ + offset_;
+    offset_ += length;
+    return ptr;
+  }
+
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+std::vector<CheckpointEntry> ParseIndex(const char* data, size_t size) {
+  IndexReader reader(data, size);
+  XLA_CHECK_EQ(reader.ReadString(sizeof(kCheckpointMagic)),
+               std::string(kCheckpointMagic, sizeof(kCheckpointMagic)))
+      << "Not an x10 checkpoint";
+  std::vector<CheckpointEntry> entries(reader.Read<uint64_t>());
+  for (auto& entry : entries) {
+    entry.name = reader.ReadString(reader.Read<uint64_t>());
+    entry.type = static_cast<xla::PrimitiveType>(reader.Read<int32_t>());
+    entry.dimensions.resize(reader.Read<uint64_t>());
+    for (auto& dim : entry.dimensions) {
+      dim = reader.Read<int64_t>();
+    }
+    entry.offset = reader.Read<uint64_t>();
+    entry.size = reader.Read<uint64_t>();
+    XLA_CHECK(entry.offset <= size && entry.size <= size - entry.offset)
+        << "Checkpoint data for " << entry.name << " is out of bounds";
+    int64_t element_size = xla::ShapeUtil::ByteSizeOfPrimitiveType(entry.type);
+    XLA_CHECK_EQ(entry.size,
+                 element_size * xla::util::Multiply<int64_t>(entry.dimensions))
+        << "Wrong data size for " << entry.name;
+  }
+  return entries;
+}
+
+template <typename T>
+at::Tensor MakeMappedTensorTyped(const void* data,
+                                 std::vector<int64_t> dimensions) {
+  size_t length = xla::util::Multiply<int64_t>(dimensions);
+  return at::Tensor(std::make_unique<at::NonOwnedAnyScalarBuffer<T>>(
+                        reinterpret_cast<const T*>(data), length),
+                    std::move(dimensions));
+}
+
+// Wraps the mapped checkpoint data into a tensor, without copying it.
+at::Tensor MakeMappedTensor(at::ScalarType type, const void* data,
+                            std::vector<int64_t> dimensions) {
+  switch (type) {
+    case at::ScalarType::Bool:
+      return MakeMappedTensorTyped<bool>(data, std::move(dimensions));
+    case at::ScalarType::Byte:
+      return MakeMappedTensorTyped<uint8_t>(data, std::move(dimensions));
+    case at::ScalarType::Char:
+      return MakeMappedTensorTyped<int8_t>(data, std::move(dimensions));
+    case at::ScalarType::Short:
+      return MakeMappedTensorTyped<int16_t>(data, std::move(dimensions));
+    case at::ScalarType::Int:
+      return MakeMappedTensorTyped<int32_t>(data, std::move(dimensions));
+    case at::ScalarType::Long:
+      return MakeMappedTensorTyped<int64_t>(data, std::move(dimensions));
+    case at::ScalarType::Float:
+      return MakeMappedTensorTyped<float>(data, std::move(dimensions));
+    case at::ScalarType::Double:
+      return MakeMappedTensorTyped<double>(data, std::move(dimensions));
+    default:
+      XLA_ERROR() << "Unsupported checkpoint type: " << type;
+  }
+}
+
+void WriteFully(int fd, const void* data, size_t size, uint64_t offset) {
+  const char* bytes = reinterpret_cast<const char*>(data);
+  while (size > 0) {
+    ssize_t written = pwrite(fd, bytes, size, offset);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    XLA_CHECK_GT(written, 0)
+        << "Failed writing checkpoint: " << std::strerror(errno);
+    bytes += written;
+    size -= written;
+    offset += written;
+  }
+}
+
+}  // namespace
+
+void SaveCheckpoint(const std::string& path,
+                    absl::Span<const NamedTensor> tensors) {
+  tensorflow::profiler::TraceMe trace("SaveCheckpoint");
+  std::vector<CheckpointEntry> entries(tensors.size());
+  for (size_t i = 0; i < tensors.size(); ++i) {
+    const XLATensor& tensor = tensors[i].tensor;
+    at::ScalarType type = tensor.dtype();
+    XLA_CHECK(type != at::ScalarType::BFloat16 && type != at::ScalarType::Half)
+        << "Checkpoints do not support tensors of type " << type << ": "
+        << tensors[i].name;
+    entries[i].name = tensors[i].name;
+    entries[i].type = TensorTypeToRawXlaType(type);
+    entries[i].dimensions =
+        xla::util::ToVector<int64_t>(tensor.shape().get().dimensions());
+    entries[i].size =
+        xla::ShapeUtil::ByteSizeOfPrimitiveType(entries[i].type) *
+        xla::util::Multiply<int64_t>(entries[i].dimensions);
+  }
+  // The index size does not depend on the offsets, so it can be computed
+  // before they are assigned.
+  uint64_t offset = AlignUp(SerializeIndex(entries).size());
+  for (auto& entry : entries) {
+    entry.offset = offset;
+    offset = AlignUp(offset + entry.size);
+  }
+  std::string index = SerializeIndex(entries);
+
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  XLA_CHECK_GE(fd, 0) << "Unable to open " << path << ": "
+                      << std::strerror(errno);
+  xla::util::ExceptionCleanup close_file(
+      [fd](xla::util::ExceptionCleanup::StatusType) { close(fd); });
+  XLA_CHECK_EQ(ftruncate(fd, offset), 0)
+      << "Unable to resize " << path << ": " << std::strerror(errno);
+  WriteFully(fd, index.data(), index.size(), 0);
+
+  std::vector<size_t> partitions = PartitionEntries(entries);
+  for (size_t p = 0; p < partitions.size(); ++p) {
+    size_t start = partitions[p];
+    size_t end = p + 1 < partitions.size() ? partitions[p + 1] : entries.size();
+    std::vector<XLATensor> batch;
+    batch.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+      batch.push_back(tensors[i].tensor);
+    }
+    // The values land in scratch buffers which are dropped once written, so
+    // that no host copy is left behind on the saved tensors.
+    std::vector<std::unique_ptr<char[]>> values;
+    std::vector<void*> buffers;
+    std::vector<size_t> buffer_sizes;
+    values.reserve(batch.size());
+    buffers.reserve(batch.size());
+    buffer_sizes.reserve(batch.size());
+    for (size_t i = start; i < end; ++i) {
+      values.emplace_back(new char[entries[i].size]);
+      buffers.push_back(values.back().get());
+      buffer_sizes.push_back(entries[i].size);
+    }
+    XLATensor::MaterializeTensorsInto(&batch, buffers, buffer_sizes);
+    xla::util::MultiWait mwait(values.size());
+    for (size_t i = 0; i < values.size(); ++i) {
+      auto writer = [&, i]() {
+        WriteFully(fd, values[i].get(), entries[start + i].size,
+                   entries[start + i].offset);
+      };
+      xla::env::ScheduleIoClosure(mwait.Completer(std::move(writer)));
+    }
+    mwait.Wait();
+  }
+}
+
+std::vector<NamedTensor> LoadCheckpoint(const std::string& path,
+                                        const Device& device) {
+  tensorflow::profiler::TraceMe trace("LoadCheckpoint");
+  int fd = open(path.c_str(), O_RDONLY);
+  XLA_CHECK_GE(fd, 0) << "Unable to open " << path << ": "
+                      << std::strerror(errno);
+  struct stat file_stat;
+  int stat_result = fstat(fd, &file_stat);
+  size_t file_size = file_stat.st_size;
+  void* mapping = stat_result == 0 && file_size > 0
+                      ? mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0)
+                      : MAP_FAILED;
+  close(fd);
+  XLA_CHECK(mapping != MAP_FAILED)
+      << "Unable to map " << path << ": " << std::strerror(errno);
+  xla::util::ExceptionCleanup unmap_file(
+      [mapping, file_size](xla::util::ExceptionCleanup::StatusType) {
+        munmap(mapping, file_size);
+      });
+  const char* data = reinterpret_cast<const char*>(mapping);
+
+  std::vector<CheckpointEntry> entries = ParseIndex(data, file_size);
+  std::vector<NamedTensor> tensors;
+  tensors.reserve(entries.size());
+  std::vector<size_t> partitions = PartitionEntries(entries);
+  for (size_t p = 0; p < partitions.size(); ++p) {
+    size_t start = partitions[p];
+    size_t end = p + 1 < partitions.size() ? partitions[p + 1] : entries.size();
+    std::vector<at::Tensor> batch;
+    batch.reserve(end - start);
+    for (size_t i = start; i < end; ++i) {
+      const CheckpointEntry& entry = entries[i];
+      if (entry.size > 0) {
+        // Files written on hosts with a smaller page size may hold entries
+        // which are not aligned to ours.
+        uint64_t begin = entry.offset / GetAlignment() * GetAlignment();
+        XLA_CHECK_EQ(madvise(const_cast<char*>(data) + begin,
+                             entry.offset + entry.size - begin, MADV_WILLNEED),
+                     0)
+            << "Unable to prefetch " << entry.name << " from " << path << ": "
+            << std::strerror(errno);
+      }
+      batch.push_back(MakeMappedTensor(TensorTypeFromXlaType(entry.type),
+                                       data + entry.offset, entry.dimensions));
+    }
+    // The uploads complete before returning, so the mapping can be released
+    // once all the batches are done.
+    std::vector<xla::ComputationClient::DataPtr> handles =
+        CreateTensorsData(batch, device.ToString());
+    for (size_t i = 0; i < handles.size(); ++i) {
+      tensors.emplace_back(
+          entries[start + i].name,
+          XLATensor::Create(std::move(handles[i]), batch[i].scalar_type()));
+    }
+  }
+  return tensors;
+}
+
+}  // namespace swift_xla
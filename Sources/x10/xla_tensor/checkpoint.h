@@ -0,0 +1,52 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+
+namespace swift_xla {
+
+// Native x10 checkpoint format. The file starts with an index holding, for
+// every tensor, its name, element type, dimensions and the offset and size of
+// its data. The data of every tensor follows, starting at a page aligned
+// offset, in the default (dim0-major) layout and host byte order.
+
+struct NamedTensor {
+  NamedTensor(std::string name, XLATensor tensor)
+      : name(std::move(name)), tensor(std::move(tensor)) {}
+
+  std::string name;
+  XLATensor tensor;
+};
+
+// Writes the tensors to a checkpoint file at path. The tensor values are
+// downloaded in batches, whose buffers are written with parallel pwrite()
+// calls.
+void SaveCheckpoint(const std::string& path,
+                    absl::Span<const NamedTensor> tensors);
+
+// Loads the tensors of the checkpoint file at path onto device. The file is
+// memory mapped, and the tensors are uploaded in batches straight out of the
+// mapping.
+std::vector<NamedTensor> LoadCheckpoint(const std::string& path,
+                                        const Device& device);
+
+}  // namespace swift_xla
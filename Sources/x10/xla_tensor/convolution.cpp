@@ -34,6 +34,9 @@ namespace {
  *     - BuildConvBackwardInput
  *     - BuildConvBackwardWeight
  *     - BuildGradBias
+ *   - BuildConvolutionOverrideableBiasActivation and its backward, which wrap
+ *     the above with the bias add and a pointwise activation, keeping the
+ *     activation gradient of the forward pass for the backward pass.
  *
  * Here're detailed steps from a 4D input to inputs calling into
  * ConvGeneralDilated (the most general conv op in XLA).
@@ -294,6 +297,46 @@ ConvGrads BuildTransposedConvolutionBackward(
   return {grad_input, grad_weight, grad_bias};
 }
 
+ConvActivationResult BuildActivation(xla::XlaOp z, ConvActivation activation) {
+  const xla::Shape& shape = XlaHelpers::ShapeOfXlaOp(z);
+  xla::XlaBuilder* builder = z.builder();
+  xla::XlaOp zero = xla::Zero(builder, shape.element_type());
+  xla::XlaOp one = xla::One(builder, shape.element_type());
+  xla::XlaOp half =
+      XlaHelpers::ScalarValue<float>(0.5, shape.element_type(), builder);
+  switch (activation) {
+    case ConvActivation::kRelu:
+      return {xla::Max(z, zero), xla::Gt(z, zero)};
+    case ConvActivation::kRelu6: {
+      xla::XlaOp six =
+          XlaHelpers::ScalarValue<float>(6.0, shape.element_type(), builder);
+      return {xla::Clamp(zero, z, six),
+              xla::And(xla::Gt(z, zero), xla::Lt(z, six))};
+    }
+    case ConvActivation::kGelu: {
+      // Matches the tanh approximation used by the Swift gelu.
+      xla::XlaOp c = XlaHelpers::ScalarValue<float>(
+          0.7978845608, shape.element_type(), builder);
+      xla::XlaOp a = XlaHelpers::ScalarValue<float>(
+          0.044715, shape.element_type(), builder);
+      xla::XlaOp three =
+          XlaHelpers::ScalarValue<float>(3.0, shape.element_type(), builder);
+      xla::XlaOp z2 = z * z;
+      xla::XlaOp t = xla::Tanh(c * (z + a * z2 * z));
+      xla::XlaOp output = half * z * (one + t);
+      xla::XlaOp grad = half * (one + t) +
+                        half * z * (one - t * t) * c * (one + three * a * z2);
+      return {output, grad};
+    }
+    case ConvActivation::kSwish: {
+      xla::XlaOp s = half + half * xla::Tanh(half * z);
+      return {z * s, s * (one + z * (one - s))};
+    }
+  }
+  XLA_ERROR() << "Invalid convolution activation: "
+              << static_cast<int>(activation);
+}
+
 }  // namespace
 
 xla::XlaOp BuildConvolutionOverrideable(
@@ -337,6 +380,18 @@ xla::XlaOp BuildConvolutionOverrideableBias(
   return conv + bias_broadcast;
 }
 
+ConvActivationResult BuildConvolutionOverrideableBiasActivation(
+    xla::XlaOp input, xla::XlaOp kernel, xla::XlaOp bias,
+    absl::Span<const int64_t> stride, absl::Span<const int64_t> padding,
+    absl::Span<const int64_t> dilation, bool transposed,
+    absl::Span<const int64_t> output_padding, int64_t groups,
+    ConvActivation activation) {
+  xla::XlaOp z = BuildConvolutionOverrideableBias(
+      input, kernel, bias, stride, padding, dilation, transposed,
+      output_padding, groups);
+  return BuildActivation(z, activation);
+}
+
 ConvGrads BuildConvolutionBackwardOverrideable(
     xla::XlaOp grad_output, xla::XlaOp input, xla::XlaOp kernel,
     absl::Span<const int64_t> stride, absl::Span<const int64_t> padding,
@@ -357,4 +412,26 @@ ConvGrads BuildConvolutionBackwardOverrideable(
     return {grad_input, grad_weight, grad_bias};
   }
 }
+
+ConvGrads BuildConvolutionBiasActivationBackward(
+    xla::XlaOp grad_output, xla::XlaOp input, xla::XlaOp kernel,
+    xla::XlaOp activation_grad, absl::Span<const int64_t> stride,
+    absl::Span<const int64_t> padding, absl::Span<const int64_t> dilation,
+    bool transposed, absl::Span<const int64_t> output_padding, int64_t groups) {
+  const xla::Shape& grad_shape = XlaHelpers::ShapeOfXlaOp(grad_output);
+  xla::XlaOp grad_z;
+  if (XlaHelpers::ShapeOfXlaOp(activation_grad).element_type() ==
+      xla::PrimitiveType::PRED) {
+    grad_z = xla::Select(
+        activation_grad, grad_output,
+        xla::Broadcast(
+            xla::Zero(grad_output.builder(), grad_shape.element_type()),
+            grad_shape.dimensions()));
+  } else {
+    grad_z = grad_output * activation_grad;
+  }
+  return BuildConvolutionBackwardOverrideable(grad_z, input, kernel, stride,
+                                              padding, dilation, transposed,
+                                              output_padding, groups);
+}
 }  // namespace swift_xla
@@ -36,6 +36,27 @@ xla::XlaOp BuildConvolutionOverrideableBias(
     absl::Span<const int64_t> dilation, bool transposed,
     absl::Span<const int64_t> output_padding, int64_t groups);
 
+// The pointwise activations which can be fused with a convolution.
+enum class ConvActivation { kRelu, kRelu6, kGelu, kSwish };
+
+struct ConvActivationResult {
+  xla::XlaOp output;
+  // What the backward pass needs from the activation: a PRED mask of the
+  // positions it passes the gradient through for relu and relu6, the
+  // derivative of the activation at the pre-activation value otherwise.
+  xla::XlaOp activation_grad;
+};
+
+// Same as BuildConvolutionOverrideableBias, then applies the activation to the
+// result, so that the convolution, the bias add and the activation are emitted
+// as a single block which XLA fuses into the convolution epilogue.
+ConvActivationResult BuildConvolutionOverrideableBiasActivation(
+    xla::XlaOp input, xla::XlaOp kernel, xla::XlaOp bias,
+    absl::Span<const int64_t> stride, absl::Span<const int64_t> padding,
+    absl::Span<const int64_t> dilation, bool transposed,
+    absl::Span<const int64_t> output_padding, int64_t groups,
+    ConvActivation activation);
+
 struct ConvGrads {
   xla::XlaOp grad_input;
   xla::XlaOp grad_weight;
@@ -49,4 +70,12 @@ ConvGrads BuildConvolutionBackwardOverrideable(
     absl::Span<const int64_t> dilation, bool transposed,
     absl::Span<const int64_t> output_padding, int64_t groups);
 
+// Computes the gradients for a fused convolution, bias add and activation,
+// given the activation_grad computed by its forward pass.
+ConvGrads BuildConvolutionBiasActivationBackward(
+    xla::XlaOp grad_output, xla::XlaOp input, xla::XlaOp kernel,
+    xla::XlaOp activation_grad, absl::Span<const int64_t> stride,
+    absl::Span<const int64_t> padding, absl::Span<const int64_t> dilation,
+    bool transposed, absl::Span<const int64_t> output_padding, int64_t groups);
+
 }  // namespace swift_xla
@@ -0,0 +1,340 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/frozen_computation.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/scalar_pack.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/service/hlo.pb.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace swift_xla {
+namespace {
+
+constexpr char kFrozenMagic[8] = {'X', '1', '0', 'F', 'R', 'O', 'Z', '1'};
+
+template <typename T>
+void AppendValue(std::string* data, T value) {
+  data->append(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+class FrozenReader {
+ public:
+  FrozenReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  T Read() {
+    T value;
+    std::memcpy(&value, Advance(sizeof(value)), sizeof(value));
+    return value;
+  }
+
+  const char* Advance(size_t length) {
+    XLA_CHECK_LE(length, size_ - offset_) << "Truncated frozen computation";
+    const char* ptr = data_ + offset_;
+    offset_ += length;
+    return ptr;
+  }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t offset_ = 0;
+};
+
+// The size of the values of shape, in the default (dim0-major) layout.
+size_t DenseByteSize(const xla::Shape& shape) {
+  return xla::ShapeUtil::ByteSizeOfElements(shape);
+}
+
+// Copies the size bytes at data, holding the values of shape in the default
+// layout, into a host tensor. The file contents carry no alignment guarantee,
+// so they are not read in place.
+at::Tensor MakeHostTensor(const xla::Shape& shape, const char* data,
+                          size_t size) {
+  std::vector<int64_t> dimensions(shape.dimensions().begin(),
+                                  shape.dimensions().end());
+  size_t length = xla::util::Multiply<int64_t>(dimensions);
+  switch (TensorTypeFromXlaType(shape.element_type())) {
+#define DEFINE_HOST_TENSOR_CASE(name, aten_name, DType)          \
+  case at::ScalarType::aten_name: {                              \
+    XLA_CHECK_EQ(size, length * sizeof(DType));                  \
+    std::unique_ptr<DType[]> buffer(new DType[length]);          \
+    std::memcpy(buffer.get(), data, size);                       \
+    return at::Tensor(std::move(buffer), std::move(dimensions)); \
+  }
+    LIST_SCALAR_TYPES(DEFINE_HOST_TENSOR_CASE)
+#undef DEFINE_HOST_TENSOR_CASE
+    default:
+      XLA_ERROR() << "Unsupported frozen parameter type: " << shape;
+  }
+}
+
+}  // namespace
+
+FrozenComputation::FrozenComputation(
+    Device device, xla::XlaComputation computation,
+    std::vector<xla::ComputationClient::DataPtr> parameters_data,
+    std::vector<size_t> input_parameters,
+    std::vector<at::ScalarType> input_types,
+    std::vector<at::ScalarType> output_types)
+    : device_(std::move(device)),
+      parameters_data_(std::move(parameters_data)),
+      input_parameters_(std::move(input_parameters)),
+      input_types_(std::move(input_types)),
+      output_types_(std::move(output_types)) {
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+  XLA_CHECK_EQ(program_shape.parameters_size(), parameters_data_.size());
+  for (size_t index : input_parameters_) {
+    input_shapes_.push_back(program_shape.parameters(index));
+  }
+  output_shapes_ = GetComponentShapes(program_shape.result());
+  XLA_CHECK_EQ(output_shapes_.size(), output_types_.size());
+  xla::Shape shape =
+      MakeShapeWithDeviceLayout(program_shape.result(), device_.hw_type);
+  std::vector<xla::ComputationClient::CompileInstance> instances;
+  instances.push_back({std::move(computation), &shape});
+  TF_VLOG(3) << "Compiling frozen computation on device " << device_ << " ...";
+  computation_ = std::move(
+      xla::GetX10Device(device_)
+          ->Compile(xla::ComputationClient::GetCompilationDevices(
+                        device_.ToString(), {}),
+                    std::move(instances))
+          .front());
+}
+
+std::shared_ptr<FrozenComputation> FrozenComputation::Create(
+    absl::Span<const XLATensor> inputs, absl::Span<const XLATensor> outputs) {
+  tensorflow::profiler::TraceMe trace("FrozenComputation::Create");
+  XLA_CHECK(!outputs.empty()) << "Frozen computations need at least one output";
+  const Device& device = outputs.front().GetDevice();
+  std::vector<xla::ComputationClient::DataPtr> inputs_data;
+  std::vector<at::ScalarType> input_types;
+  // Scalar inputs read slices of the scalar packs, which the outputs share with
+  // the other scalars. They are given their own device data, which gets bound
+  // in place of the slice.
+  std::vector<ir::Value> scalar_slices;
+  std::vector<xla::ComputationClient::DataPtr> scalar_slices_data;
+  for (const XLATensor& input : inputs) {
+    XLA_CHECK_EQ(input.GetDevice(), device);
+    ir::Value ir_value = input.GetIrValue();
+    const ir::ops::DeviceData* device_data =
+        ir::ops::DeviceData::Cast(ir_value.node.get());
+    if (device_data != nullptr) {
+      inputs_data.push_back(device_data->data());
+    } else {
+      XLA_CHECK_EQ(input.shape().get().rank(), 0)
+          << "Frozen computation inputs must be device data, not "
+          << ir_value->ToString();
+      scalar_slices.push_back(ir_value);
+      scalar_slices_data.push_back(XLATensor(input).GetXlaData());
+      inputs_data.push_back(scalar_slices_data.back());
+    }
+    input_types.push_back(input.dtype());
+  }
+  std::vector<at::ScalarType> output_types;
+  ScalarPacks::Flush(device);
+  ir::Util::EmissionMap emit_status;
+  for (const ir::Value& slice : scalar_slices) {
+    emit_status[slice.node.get()] = ir::Util::kEmitted;
+  }
+  ir::RootLoweringContext lowering_ctx("FrozenComputation", device,
+                                       /*post_order=*/{},
+                                       std::move(emit_status));
+  for (size_t i = 0; i < scalar_slices.size(); ++i) {
+    lowering_ctx.AssignOutputOp(
+        scalar_slices[i], lowering_ctx.GetParameter(scalar_slices_data[i]));
+  }
+  for (const XLATensor& output : outputs) {
+    XLA_CHECK_EQ(output.GetDevice(), device);
+    lowering_ctx.AddResult(lowering_ctx.GetOutputOp(output.GetIrValue()));
+    output_types.push_back(output.dtype());
+  }
+  std::vector<xla::ComputationClient::DataPtr> parameters_data =
+      lowering_ctx.GetParametersData();
+  std::vector<size_t> input_parameters;
+  for (size_t i = 0; i < inputs_data.size(); ++i) {
+    auto it = std::find(parameters_data.begin(), parameters_data.end(),
+                        inputs_data[i]);
+    XLA_CHECK(it != parameters_data.end())
+        << "Frozen computation input " << i << " is not used by the outputs";
+    size_t index = it - parameters_data.begin();
+    XLA_CHECK(std::find(input_parameters.begin(), input_parameters.end(),
+                        index) == input_parameters.end())
+        << "Frozen computation input " << i << " is listed twice";
+    input_parameters.push_back(index);
+  }
+  for (size_t index : input_parameters) {
+    parameters_data[index] = nullptr;
+  }
+  return std::shared_ptr<FrozenComputation>(new FrozenComputation(
+      device, ConsumeValue(lowering_ctx.Build()), std::move(parameters_data),
+      std::move(input_parameters), std::move(input_types),
+      std::move(output_types)));
+}
+
+std::shared_ptr<FrozenComputation> FrozenComputation::Load(
+    const std::string& path, const Device& device) {
+  tensorflow::profiler::TraceMe trace("FrozenComputation::Load");
+  std::ifstream file(path, std::ios::binary);
+  XLA_CHECK(file) << "Unable to open " << path;
+  std::string contents((std::istreambuf_iterator<char>(file)),
+                       std::istreambuf_iterator<char>());
+  FrozenReader reader(contents.data(), contents.size());
+  XLA_CHECK_EQ(std::string(reader.Advance(sizeof(kFrozenMagic)),
+                           sizeof(kFrozenMagic)),
+               std::string(kFrozenMagic, sizeof(kFrozenMagic)))
+      << "Not an x10 frozen computation: " << path;
+  xla::HloModuleProto proto;
+  size_t proto_size = reader.Read<uint64_t>();
+  XLA_CHECK(proto.ParseFromArray(reader.Advance(proto_size), proto_size))
+      << "Invalid computation in " << path;
+  xla::XlaComputation computation(std::move(proto));
+  xla::ProgramShape program_shape = ConsumeValue(computation.GetProgramShape());
+
+  size_t parameter_count = reader.Read<uint64_t>();
+  XLA_CHECK_EQ(parameter_count, program_shape.parameters_size());
+  std::vector<size_t> input_parameters(reader.Read<uint64_t>());
+  std::vector<at::ScalarType> input_types(input_parameters.size());
+  std::vector<bool> is_input(parameter_count, false);
+  for (size_t i = 0; i < input_parameters.size(); ++i) {
+    input_parameters[i] = reader.Read<uint64_t>();
+    input_types[i] = static_cast<at::ScalarType>(reader.Read<int32_t>());
+    XLA_CHECK_LT(input_parameters[i], parameter_count);
+    is_input[input_parameters[i]] = true;
+  }
+  std::vector<size_t> frozen_parameters;
+  for (size_t i = 0; i < parameter_count; ++i) {
+    if (!is_input[i]) {
+      frozen_parameters.push_back(i);
+    }
+  }
+  std::vector<at::ScalarType> output_types(reader.Read<uint64_t>());
+  for (auto& type : output_types) {
+    type = static_cast<at::ScalarType>(reader.Read<int32_t>());
+  }
+
+  // The frozen values are stored in the dense layout, with the device element
+  // types, and get relaid out to the parameter layouts while uploading.
+  std::vector<xla::ComputationClient::DataPtr> frozen_data;
+  for (size_t index : frozen_parameters) {
+    const xla::Shape& shape = program_shape.parameters(index);
+    size_t size = reader.Read<uint64_t>();
+    XLA_CHECK_EQ(size, DenseByteSize(shape)) << "Wrong data size of " << shape;
+    at::Tensor tensor = MakeHostTensor(shape, reader.Advance(size), size);
+    frozen_data.push_back(TensorToXlaData(tensor, shape, device));
+  }
+  std::vector<xla::ComputationClient::DataPtr> parameters_data(
+      parameter_count);
+  for (size_t i = 0; i < frozen_parameters.size(); ++i) {
+    parameters_data[frozen_parameters[i]] = std::move(frozen_data[i]);
+  }
+  return std::shared_ptr<FrozenComputation>(new FrozenComputation(
+      device, std::move(computation), std::move(parameters_data),
+      std::move(input_parameters), std::move(input_types),
+      std::move(output_types)));
+}
+
+void FrozenComputation::Save(const std::string& path) const {
+  tensorflow::profiler::TraceMe trace("FrozenComputation::Save");
+  std::string header(kFrozenMagic, sizeof(kFrozenMagic));
+  std::string proto = computation_->computation().proto().SerializeAsString();
+  AppendValue<uint64_t>(&header, proto.size());
+  header.append(proto);
+  AppendValue<uint64_t>(&header, parameters_data_.size());
+  AppendValue<uint64_t>(&header, input_parameters_.size());
+  for (size_t i = 0; i < input_parameters_.size(); ++i) {
+    AppendValue<uint64_t>(&header, input_parameters_[i]);
+    AppendValue<int32_t>(&header, static_cast<int32_t>(input_types_[i]));
+  }
+  AppendValue<uint64_t>(&header, output_types_.size());
+  for (at::ScalarType type : output_types_) {
+    AppendValue<int32_t>(&header, static_cast<int32_t>(type));
+  }
+
+  // The frozen parameters are the ones with data, in parameter order.
+  std::vector<xla::ComputationClient::DataPtr> frozen_data;
+  for (auto& data : parameters_data_) {
+    if (data != nullptr) {
+      frozen_data.push_back(data);
+    }
+  }
+  // Downloads the frozen values with their device element types, which keeps
+  // them bit exact, in the default layout.
+  std::vector<at::ScalarType> types;
+  std::vector<std::unique_ptr<char[]>> buffers;
+  std::vector<void*> buffer_ptrs;
+  std::vector<size_t> sizes;
+  for (auto& data : frozen_data) {
+    types.push_back(TensorTypeFromXlaType(data->shape().element_type()));
+    sizes.push_back(DenseByteSize(data->shape()));
+    buffers.emplace_back(new char[sizes.back()]);
+    buffer_ptrs.push_back(buffers.back().get());
+  }
+  XlaDataToBuffers(frozen_data, types, buffer_ptrs, sizes);
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  XLA_CHECK(file) << "Unable to open " << path;
+  file.write(header.data(), header.size());
+  for (size_t i = 0; i < buffers.size(); ++i) {
+    uint64_t size = sizes[i];
+    file.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    file.write(buffers[i].get(), size);
+  }
+  XLA_CHECK(file.flush()) << "Failed writing " << path;
+}
+
+std::vector<xla::ComputationClient::DataPtr> FrozenComputation::Execute(
+    absl::Span<const xla::ComputationClient::DataPtr> inputs) const {
+  XLA_CHECK_EQ(inputs.size(), input_parameters_.size());
+  std::vector<xla::ComputationClient::DataPtr> arguments = parameters_data_;
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    XLA_CHECK(xla::ShapeUtil::Equal(inputs[i]->shape(), input_shapes_[i]))
+        << "Input " << i << " has shape " << inputs[i]->shape()
+        << ", expected " << input_shapes_[i];
+    arguments[input_parameters_[i]] = inputs[i];
+  }
+  xla::ComputationClient::ExecuteComputationOptions options;
+  return xla::GetX10Device(device_)->ExecuteComputation(*computation_,
+                                                        arguments, options);
+}
+
+std::vector<XLATensor> FrozenComputation::Execute(
+    absl::Span<const XLATensor> inputs) const {
+  std::vector<xla::ComputationClient::DataPtr> inputs_data;
+  for (XLATensor input : inputs) {
+    XLA_CHECK_EQ(input.GetDevice(), device_);
+    inputs_data.push_back(input.GetXlaData());
+  }
+  std::vector<xla::ComputationClient::DataPtr> results = Execute(inputs_data);
+  std::vector<XLATensor> outputs;
+  for (size_t i = 0; i < results.size(); ++i) {
+    outputs.push_back(
+        XLATensor::Create(std::move(results[i]), output_types_[i]));
+  }
+  return outputs;
+}
+
+}  // namespace swift_xla
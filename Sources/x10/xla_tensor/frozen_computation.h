@@ -0,0 +1,95 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+#include "tensorflow/compiler/xla/shape.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace swift_xla {
+
+// A graph frozen into a compiled executable. The device data read by the graph
+// is split into the inputs, which are bound on every execution, and the frozen
+// parameters (like the model weights), which are captured together with the
+// executable. Executing it skips tracing, IR construction and hashing, so its
+// host cost is the one of the launch. It can be saved to a file and loaded
+// back, possibly by another process.
+class FrozenComputation {
+ public:
+  // Compiles the computation of outputs. The inputs must be device data
+  // tensors or scalars, and all the other device data the outputs depend on is
+  // frozen with its current value.
+  static std::shared_ptr<FrozenComputation> Create(
+      absl::Span<const XLATensor> inputs, absl::Span<const XLATensor> outputs);
+
+  // Loads a frozen computation saved by Save(), and compiles it for device.
+  static std::shared_ptr<FrozenComputation> Load(const std::string& path,
+                                                 const Device& device);
+
+  // Writes the computation, the position of the inputs among its parameters
+  // and the values of the frozen parameters to path.
+  void Save(const std::string& path) const;
+
+  // Runs the computation with the given input data, whose shapes must be the
+  // input_shapes() ones, and returns the data of the outputs.
+  std::vector<xla::ComputationClient::DataPtr> Execute(
+      absl::Span<const xla::ComputationClient::DataPtr> inputs) const;
+
+  std::vector<XLATensor> Execute(absl::Span<const XLATensor> inputs) const;
+
+  const Device& device() const { return device_; }
+
+  // The device shapes and the element types of the inputs and outputs.
+  const std::vector<xla::Shape>& input_shapes() const { return input_shapes_; }
+
+  const std::vector<at::ScalarType>& input_types() const {
+    return input_types_;
+  }
+
+  const std::vector<xla::Shape>& output_shapes() const {
+    return output_shapes_;
+  }
+
+  const std::vector<at::ScalarType>& output_types() const {
+    return output_types_;
+  }
+
+ private:
+  FrozenComputation(
+      Device device, xla::XlaComputation computation,
+      std::vector<xla::ComputationClient::DataPtr> parameters_data,
+      std::vector<size_t> input_parameters,
+      std::vector<at::ScalarType> input_types,
+      std::vector<at::ScalarType> output_types);
+
+  Device device_;
+  xla::ComputationClient::ComputationPtr computation_;
+  // The values of the frozen parameters, and nullptr for the inputs.
+  std::vector<xla::ComputationClient::DataPtr> parameters_data_;
+  std::vector<size_t> input_parameters_;
+  std::vector<xla::Shape> input_shapes_;
+  std::vector<at::ScalarType> input_types_;
+  std::vector<xla::Shape> output_shapes_;
+  std::vector<at::ScalarType> output_types_;
+};
+
+}  // namespace swift_xla
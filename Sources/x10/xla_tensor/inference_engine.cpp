@@ -0,0 +1,392 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/inference_engine.h"
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/core/profiler/lib/traceme.h"
+
+namespace swift_xla {
+namespace {
+
+InferenceEngine::TensorSignature MakeSignature(at::ScalarType type,
+                                               const xla::Shape& shape,
+                                               int64_t batch_size) {
+  // The staging tensors are built out of plain C++ types, which do not tell
+  // the 16 bit floating point types apart from the integer ones.
+  XLA_CHECK(type != at::ScalarType::BFloat16 && type != at::ScalarType::Half)
+      << "Inference inputs and outputs cannot have type " << type;
+  auto dimensions = shape.dimensions();
+  XLA_CHECK(!dimensions.empty() && dimensions[0] == batch_size)
+      << "The leading dimension must be the batch size " << batch_size << ": "
+      << shape;
+  InferenceEngine::TensorSignature signature;
+  signature.type = type;
+  signature.dimensions.assign(dimensions.begin() + 1, dimensions.end());
+  signature.row_bytes =
+      xla::ShapeUtil::ByteSizeOfPrimitiveType(TensorTypeToRawXlaType(type)) *
+      xla::util::Multiply<int64_t>(signature.dimensions);
+  return signature;
+}
+
+bool SameSignatures(absl::Span<const InferenceEngine::TensorSignature> lhs,
+                    absl::Span<const InferenceEngine::TensorSignature> rhs) {
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    if (lhs[i].type != rhs[i].type || lhs[i].dimensions != rhs[i].dimensions) {
+      return false;
+    }
+  }
+  return true;
+}
+
+std::vector<int64_t> BatchDimensions(
+    const InferenceEngine::TensorSignature& signature, int64_t batch_size) {
+  std::vector<int64_t> dimensions({batch_size});
+  dimensions.insert(dimensions.end(), signature.dimensions.begin(),
+                    signature.dimensions.end());
+  return dimensions;
+}
+
+// Allocates a zero filled host tensor, and stores the address of its data in
+// data.
+at::Tensor MakeStagingTensor(at::ScalarType type,
+                             std::vector<int64_t> dimensions, char** data) {
+  size_t length = xla::util::Multiply<int64_t>(dimensions);
+  switch (type) {
+#define DEFINE_STAGING_CASE(name, aten_name, DType)              \
+  case at::ScalarType::aten_name: {                              \
+    std::unique_ptr<DType[]> buffer(new DType[length]());        \
+    *data = reinterpret_cast<char*>(buffer.get());               \
+    return at::Tensor(std::move(buffer), std::move(dimensions)); \
+  }
+    LIST_SCALAR_TYPES(DEFINE_STAGING_CASE)
+#undef DEFINE_STAGING_CASE
+    default:
+      XLA_ERROR() << "Unsupported inference type: " << type;
+  }
+}
+
+double Percentile(absl::Span<const double> sorted_values, double fraction) {
+  if (sorted_values.empty()) {
+    return 0;
+  }
+  size_t index = std::min<size_t>(sorted_values.size() - 1,
+                                  fraction * sorted_values.size());
+  return sorted_values[index];
+}
+
+}  // namespace
+
+InferenceEngine::InferenceEngine(const Device& device,
+                                 std::chrono::microseconds max_latency)
+    : device_(device), max_latency_(max_latency) {
+  batcher_ = std::thread([this]() { BatchLoop(); });
+}
+
+InferenceEngine::~InferenceEngine() {
+  stop_.store(true);
+  {
+    // Taking the lock makes sure the batcher is either waiting, or yet to
+    // check the stop flag.
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_one();
+  }
+  batcher_.join();
+}
+
+void InferenceEngine::AddBucket(int64_t batch_size,
+                                absl::Span<const XLATensor> inputs,
+                                absl::Span<const XLATensor> outputs) {
+  tensorflow::profiler::TraceMe trace("InferenceEngine::AddBucket");
+  TF_VLOG(3) << "Compiling inference bucket of batch size " << batch_size
+             << " on device " << device_;
+  AddBucket(batch_size, FrozenComputation::Create(inputs, outputs));
+}
+
+void InferenceEngine::AddBucket(
+    int64_t batch_size, std::shared_ptr<FrozenComputation> computation) {
+  XLA_CHECK_GT(batch_size, 0);
+  XLA_CHECK_EQ(computation->device(), device_);
+  std::vector<TensorSignature> input_signatures;
+  for (size_t i = 0; i < computation->input_shapes().size(); ++i) {
+    input_signatures.push_back(MakeSignature(computation->input_types()[i],
+                                             computation->input_shapes()[i],
+                                             batch_size));
+  }
+  std::vector<TensorSignature> output_signatures;
+  for (size_t i = 0; i < computation->output_shapes().size(); ++i) {
+    output_signatures.push_back(MakeSignature(computation->output_types()[i],
+                                              computation->output_shapes()[i],
+                                              batch_size));
+  }
+
+  std::lock_guard<std::mutex> lock(buckets_mutex_);
+  if (buckets_.empty()) {
+    input_signatures_ = std::move(input_signatures);
+    output_signatures_ = std::move(output_signatures);
+  } else {
+    XLA_CHECK(SameSignatures(input_signatures_, input_signatures) &&
+              SameSignatures(output_signatures_, output_signatures))
+        << "Inference buckets must have the same per example signatures";
+  }
+  XLA_CHECK(buckets_.emplace(batch_size, std::move(computation)).second)
+      << "Duplicated inference bucket of batch size " << batch_size;
+  max_batch_size_.store(buckets_.rbegin()->first);
+}
+
+std::future<void> InferenceEngine::Enqueue(absl::Span<const void* const> inputs,
+                                           absl::Span<void* const> outputs) {
+  XLA_CHECK_GT(max_batch_size_.load(), 0) << "No inference bucket was added";
+  {
+    std::lock_guard<std::mutex> lock(buckets_mutex_);
+    XLA_CHECK_EQ(inputs.size(), input_signatures_.size());
+    XLA_CHECK_EQ(outputs.size(), output_signatures_.size());
+  }
+  // The request is owned by the batcher once pushed, and the caller only keeps
+  // the future, so that it can wake up while the promise is being fulfilled.
+  Request* request = new Request();
+  request->inputs.assign(inputs.begin(), inputs.end());
+  request->outputs.assign(outputs.begin(), outputs.end());
+  request->enqueue_time = Clock::now();
+  std::future<void> done = request->done.get_future();
+  Push(request);
+  return done;
+}
+
+void InferenceEngine::Run(absl::Span<const void* const> inputs,
+                          absl::Span<void* const> outputs) {
+  Enqueue(inputs, outputs).get();
+}
+
+std::vector<InferenceEngine::TensorSignature>
+InferenceEngine::input_signatures() const {
+  std::lock_guard<std::mutex> lock(buckets_mutex_);
+  return input_signatures_;
+}
+
+std::vector<InferenceEngine::TensorSignature>
+InferenceEngine::output_signatures() const {
+  std::lock_guard<std::mutex> lock(buckets_mutex_);
+  return output_signatures_;
+}
+
+void InferenceEngine::Push(Request* request) {
+  request->next = pending_.load();
+  while (!pending_.compare_exchange_weak(request->next, request)) {
+  }
+  // Either the batcher sees the request before going to sleep, or this sees
+  // it sleeping.
+  if (sleeping_.load()) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    wake_.notify_one();
+  }
+}
+
+void InferenceEngine::TakePending(
+    std::vector<std::unique_ptr<Request>>* queue) {
+  size_t start = queue->size();
+  for (Request* request = pending_.exchange(nullptr); request != nullptr;
+       request = request->next) {
+    queue->emplace_back(request);
+  }
+  std::reverse(queue->begin() + start, queue->end());
+}
+
+void InferenceEngine::WaitForRequests(const Clock::time_point* deadline) {
+  std::unique_lock<std::mutex> lock(mutex_);
+  sleeping_.store(true);
+  auto ready = [this]() { return pending_.load() != nullptr || stop_.load(); };
+  if (deadline == nullptr) {
+    wake_.wait(lock, ready);
+  } else {
+    wake_.wait_until(lock, *deadline, ready);
+  }
+  sleeping_.store(false);
+}
+
+void InferenceEngine::BatchLoop() {
+  std::vector<std::unique_ptr<Request>> queue;
+  while (true) {
+    TakePending(&queue);
+    if (queue.empty()) {
+      if (stop_.load()) {
+        break;
+      }
+      WaitForRequests(/*deadline=*/nullptr);
+      continue;
+    }
+    size_t max_batch_size = max_batch_size_.load();
+    Clock::time_point deadline = queue.front()->enqueue_time + max_latency_;
+    while (queue.size() < max_batch_size && !stop_.load() &&
+           Clock::now() < deadline) {
+      WaitForRequests(&deadline);
+      TakePending(&queue);
+    }
+    size_t count = std::min(queue.size(), max_batch_size);
+    RunBatch(absl::MakeConstSpan(queue.data(), count));
+    queue.erase(queue.begin(), queue.begin() + count);
+  }
+}
+
+void InferenceEngine::RunBatch(
+    absl::Span<const std::unique_ptr<Request>> batch) {
+  tensorflow::profiler::TraceMe trace("InferenceEngine::RunBatch");
+  try {
+    std::unique_lock<std::mutex> lock(buckets_mutex_);
+    auto it = buckets_.lower_bound(batch.size());
+    XLA_CHECK(it != buckets_.end());
+    int64_t batch_size = it->first;
+    std::shared_ptr<FrozenComputation> computation = it->second;
+    // A bucket can be added while the batch runs, so work on copies.
+    std::vector<TensorSignature> input_signatures = input_signatures_;
+    std::vector<TensorSignature> output_signatures = output_signatures_;
+    lock.unlock();
+    XLA_COUNTER("InferenceBatches", 1);
+    XLA_VALUE_METRIC("InferenceBatchSize", batch.size());
+    XLA_VALUE_METRIC("InferencePaddedExamples", batch_size - batch.size());
+
+    std::vector<xla::ComputationClient::DataPtr> inputs;
+    for (size_t i = 0; i < input_signatures.size(); ++i) {
+      const TensorSignature& signature = input_signatures[i];
+      char* data = nullptr;
+      at::Tensor staging = MakeStagingTensor(
+          signature.type, BatchDimensions(signature, batch_size), &data);
+      for (size_t j = 0; j < batch.size(); ++j) {
+        std::memcpy(data + j * signature.row_bytes, batch[j]->inputs[i],
+                    signature.row_bytes);
+      }
+      inputs.push_back(TensorToXlaData(
+          staging, computation->input_shapes()[i], device_));
+    }
+    std::vector<xla::ComputationClient::DataPtr> results =
+        computation->Execute(inputs);
+
+    std::vector<at::ScalarType> types;
+    std::vector<std::unique_ptr<char[]>> staging;
+    std::vector<void*> buffers;
+    std::vector<size_t> sizes;
+    for (const TensorSignature& signature : output_signatures) {
+      types.push_back(signature.type);
+      sizes.push_back(batch_size * signature.row_bytes);
+      staging.emplace_back(new char[sizes.back()]);
+      buffers.push_back(staging.back().get());
+    }
+    XlaDataToBuffers(results, types, buffers, sizes);
+    for (size_t i = 0; i < output_signatures.size(); ++i) {
+      size_t row_bytes = output_signatures[i].row_bytes;
+      for (size_t j = 0; j < batch.size(); ++j) {
+        std::memcpy(batch[j]->outputs[i], staging[i].get() + j * row_bytes,
+                    row_bytes);
+      }
+    }
+    batch_count_ += 1;
+    example_count_ += batch.size();
+    for (auto& request : batch) {
+      request->done.set_value();
+    }
+  } catch (...) {
+    std::exception_ptr error = std::current_exception();
+    for (auto& request : batch) {
+      request->done.set_exception(error);
+    }
+  }
+}
+
+InferenceLoadStats RunInferenceLoad(InferenceEngine* engine,
+                                    int64_t num_clients,
+                                    int64_t requests_per_client) {
+  XLA_CHECK_GT(num_clients, 0);
+  XLA_CHECK_GT(requests_per_client, 0);
+  std::vector<std::vector<double>> latencies(num_clients);
+  int64_t start_batches = engine->batch_count();
+  int64_t start_examples = engine->example_count();
+  auto client = [&](int64_t index) {
+    std::vector<std::vector<char>> input_rows;
+    std::vector<std::vector<char>> output_rows;
+    for (auto& signature : engine->input_signatures()) {
+      input_rows.emplace_back(signature.row_bytes);
+    }
+    for (auto& signature : engine->output_signatures()) {
+      output_rows.emplace_back(signature.row_bytes);
+    }
+    std::vector<const void*> inputs;
+    std::vector<void*> outputs;
+    for (auto& row : input_rows) {
+      inputs.push_back(row.data());
+    }
+    for (auto& row : output_rows) {
+      outputs.push_back(row.data());
+    }
+    latencies[index].reserve(requests_per_client);
+    for (int64_t i = 0; i < requests_per_client; ++i) {
+      auto start = InferenceEngine::Clock::now();
+      engine->Run(inputs, outputs);
+      std::chrono::duration<double, std::milli> latency =
+          InferenceEngine::Clock::now() - start;
+      latencies[index].push_back(latency.count());
+    }
+  };
+
+  auto start = InferenceEngine::Clock::now();
+  std::vector<std::thread> clients;
+  for (int64_t i = 0; i < num_clients; ++i) {
+    clients.emplace_back(client, i);
+  }
+  for (auto& thread : clients) {
+    thread.join();
+  }
+  std::chrono::duration<double> elapsed = InferenceEngine::Clock::now() - start;
+
+  std::vector<double> all_latencies;
+  for (auto& client_latencies : latencies) {
+    all_latencies.insert(all_latencies.end(), client_latencies.begin(),
+                         client_latencies.end());
+  }
+  std::sort(all_latencies.begin(), all_latencies.end());
+  InferenceLoadStats stats;
+  stats.requests = all_latencies.size();
+  stats.seconds = elapsed.count();
+  stats.throughput = stats.seconds > 0 ? stats.requests / stats.seconds : 0;
+  stats.p50_latency_ms = Percentile(all_latencies, 0.5);
+  stats.p99_latency_ms = Percentile(all_latencies, 0.99);
+  int64_t batches = engine->batch_count() - start_batches;
+  stats.mean_batch_size =
+      batches > 0
+          ? static_cast<double>(engine->example_count() - start_examples) /
+                batches
+          : 0;
+  return stats;
+}
+
+std::string InferenceLoadStatsToString(const InferenceLoadStats& stats) {
+  std::stringstream ss;
+  ss << stats.requests << " requests in " << stats.seconds << " s, "
+     << stats.throughput << " requests/s, p50 " << stats.p50_latency_ms
+     << " ms, p99 " << stats.p99_latency_ms << " ms, mean batch size "
+     << stats.mean_batch_size;
+  return ss.str();
+}
+
+}  // namespace swift_xla
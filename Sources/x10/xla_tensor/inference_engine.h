@@ -0,0 +1,157 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/frozen_computation.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor.h"
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+
+namespace swift_xla {
+
+// An inference runtime serving a traced model without re-tracing it. The model
+// is compiled once for every batch size bucket. Requests, each holding a single
+// example, are pushed on a lock-free queue from any thread. A batcher thread
+// coalesces them until the largest bucket is full or the oldest request reaches
+// its latency deadline, pads the batch to the smallest bucket which fits it,
+// and runs the cached executable straight on the device. The result rows are
+// then copied back to the requests.
+class InferenceEngine {
+ public:
+  using Clock = std::chrono::steady_clock;
+
+  // The element type and the per example dimensions of an input or output.
+  struct TensorSignature {
+    at::ScalarType type;
+    std::vector<int64_t> dimensions;
+    size_t row_bytes = 0;
+  };
+
+  InferenceEngine(const Device& device, std::chrono::microseconds max_latency);
+
+  // Runs the requests still queued, then stops the batcher thread.
+  ~InferenceEngine();
+
+  // Compiles the outputs for batches of batch_size examples. The inputs must be
+  // device data tensors whose leading dimension is batch_size, and so must be
+  // the one of the outputs. All the other device data the outputs depend on,
+  // like the model weights, is captured as is. Every bucket must have the same
+  // per example input and output signatures.
+  void AddBucket(int64_t batch_size, absl::Span<const XLATensor> inputs,
+                 absl::Span<const XLATensor> outputs);
+
+  // Adds a bucket running a frozen computation, like a loaded one, whose
+  // inputs and outputs have batch_size as leading dimension.
+  void AddBucket(int64_t batch_size,
+                 std::shared_ptr<FrozenComputation> computation);
+
+  // Queues a single example. The inputs point to the per example values of
+  // the inputs, and the outputs to the buffers receiving the per example
+  // values of the outputs, both in the default layout. The buffers must stay
+  // valid until the returned future is ready.
+  std::future<void> Enqueue(absl::Span<const void* const> inputs,
+                            absl::Span<void* const> outputs);
+
+  // Queues a single example and waits for its outputs.
+  void Run(absl::Span<const void* const> inputs,
+           absl::Span<void* const> outputs);
+
+  // The signatures are set by the first bucket, so they are empty until one is
+  // added.
+  std::vector<TensorSignature> input_signatures() const;
+
+  std::vector<TensorSignature> output_signatures() const;
+
+  // The number of batches run, and of examples in them.
+  int64_t batch_count() const { return batch_count_.load(); }
+
+  int64_t example_count() const { return example_count_.load(); }
+
+ private:
+  struct Request {
+    std::vector<const void*> inputs;
+    std::vector<void*> outputs;
+    std::promise<void> done;
+    Clock::time_point enqueue_time;
+    Request* next = nullptr;
+  };
+
+  void Push(Request* request);
+
+  // Appends the pushed requests to queue, in arrival order.
+  void TakePending(std::vector<std::unique_ptr<Request>>* queue);
+
+  // Waits until a request is pushed, the engine is stopped, or the deadline
+  // (if not nullptr) passes.
+  void WaitForRequests(const Clock::time_point* deadline);
+
+  void BatchLoop();
+
+  void RunBatch(absl::Span<const std::unique_ptr<Request>> batch);
+
+  Device device_;
+  std::chrono::microseconds max_latency_;
+  // The signatures and the buckets are guarded by buckets_mutex_.
+  std::vector<TensorSignature> input_signatures_;
+  std::vector<TensorSignature> output_signatures_;
+  // Keyed by batch size.
+  std::map<int64_t, std::shared_ptr<FrozenComputation>> buckets_;
+  mutable std::mutex buckets_mutex_;
+  std::atomic<int64_t> max_batch_size_{0};
+  // The pushed requests, the most recent first.
+  std::atomic<Request*> pending_{nullptr};
+  std::atomic<bool> sleeping_{false};
+  std::atomic<bool> stop_{false};
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::atomic<int64_t> batch_count_{0};
+  std::atomic<int64_t> example_count_{0};
+  std::thread batcher_;
+};
+
+struct InferenceLoadStats {
+  int64_t requests = 0;
+  double seconds = 0;
+  // Requests per second.
+  double throughput = 0;
+  double p50_latency_ms = 0;
+  double p99_latency_ms = 0;
+  double mean_batch_size = 0;
+};
+
+// Local load generator. Each of the num_clients threads sends
+// requests_per_client zero filled requests to the engine, one at a time, and
+// the latency of every request is recorded.
+InferenceLoadStats RunInferenceLoad(InferenceEngine* engine,
+                                    int64_t num_clients,
+                                    int64_t requests_per_client);
+
+std::string InferenceLoadStatsToString(const InferenceLoadStats& stats);
+
+}  // namespace swift_xla
@@ -167,6 +167,7 @@ const xla::Shape& Node::shape(size_t output_index) const {
 
 void Node::AddOperand(NodePtr node, size_t index) {
   XLA_CHECK_LT(index, node->num_outputs());
+  depends_on_placeholder_ |= node->depends_on_placeholder();
   operands_.push_back(std::move(node));
   operands_as_outputs_.push_back(Output(operands_.back().get(), index));
 }
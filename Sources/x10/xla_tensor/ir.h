@@ -204,6 +204,11 @@ class Node {
 
   const MetaData& metadata() const { return metadata_; }
 
+  // Whether the graph rooted at this node contains a loop placeholder. This is
+  // propagated from the operands at construction, so that the discovery of the
+  // extra inputs of a loop only needs to walk its body.
+  bool depends_on_placeholder() const { return depends_on_placeholder_; }
+
   virtual std::string ToString() const;
 
   virtual NodePtr Clone(OpList operands) const;
@@ -215,6 +220,10 @@ class Node {
   XlaOpVector ReturnOps(absl::Span<const xla::XlaOp> ops,
                         LoweringContext* loctx) const;
 
+ protected:
+  // Marks this node as a loop placeholder, see depends_on_placeholder().
+  void MarkPlaceholder() { depends_on_placeholder_ = true; }
+
  private:
   // Adds node's index output number as operand.
   void AddOperand(NodePtr node, size_t index = 0);
@@ -239,6 +248,7 @@ class Node {
   xla::hash_t hash_ = 0;
   // The IR specific metadata attached to the IR node.
   MetaData metadata_;
+  bool depends_on_placeholder_ = false;
 
  public:
   static bool s_log_graph_changes_;
@@ -23,6 +23,7 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/debug_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/scalar_pack.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
 
@@ -287,6 +288,9 @@ std::string DumpUtil::PostOrderToText(absl::Span<const Node* const> post_order,
 
 std::string DumpUtil::ToHlo(absl::Span<const Value> values,
                             const Device& device) {
+  // Lowering device data needs their handles, which scalar packs only get
+  // once uploaded.
+  ScalarPacks::Flush(device);
   ir::RootLoweringContext lowering_ctx("IrToHlo", device);
   for (auto& ir_value : values) {
     xla::XlaOp root = lowering_ctx.GetOutputOp(ir_value);
@@ -20,6 +20,8 @@
 #include "absl/strings/str_cat.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/auto_mixed_precision.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 
 namespace swift_xla {
 namespace ir {
@@ -74,11 +76,19 @@ RootLoweringContext::RootLoweringContext(const std::string& name, Device device)
 
 RootLoweringContext::RootLoweringContext(
     const std::string& name, Device device,
-    absl::Span<const Node* const> post_order, Util::EmissionMap emit_status)
+    absl::Span<const Node* const> post_order, Util::EmissionMap emit_status,
+    absl::Span<const RematerializationSegment> remat_segments)
     : LoweringContext(&builder_, std::move(device), std::move(emit_status)),
       builder_(name) {
-  for (auto node : post_order) {
-    LowerNode(node);
+  auto segment = remat_segments.begin();
+  for (size_t i = 0; i < post_order.size(); ++i) {
+    for (; segment != remat_segments.end() && segment->position == i;
+         ++segment) {
+      xla::XlaOp anchor =
+          i > 0 ? GetOutputOp(Output(post_order[i - 1], 0)) : xla::XlaOp();
+      EmitRematerialization(*segment, anchor, this);
+    }
+    LowerNode(post_order[i]);
   }
 }
 
@@ -158,13 +168,47 @@ XlaOpVector LoweringContext::LowerNode(const Node* node) {
   // TODO(asuhan): handle errors without crashing
   HloMetadataSetter meta_setter(this, node);
 
-  result_ops = node->Lower(this);
+  xla::PrimitiveType amp_type = AutoMixedPrecision::GetLoweringType(node);
+  result_ops = amp_type != xla::PRIMITIVE_TYPE_INVALID
+                   ? LowerNodeWithType(node, amp_type)
+                   : node->Lower(this);
   if (!builder()->first_error().ok()) {
     ReportBuilderError(node, /*error_msg=*/nullptr);
   }
   return result_ops;
 }
 
+XlaOpVector LoweringContext::LowerNodeWithType(const Node* node,
+                                               xla::PrimitiveType type) {
+  auto is_converted = [type](xla::PrimitiveType operand_type) {
+    return operand_type != type && (operand_type == xla::PrimitiveType::F32 ||
+                                    operand_type == xla::PrimitiveType::BF16 ||
+                                    operand_type == xla::PrimitiveType::F16);
+  };
+  // Hand the converted operands to the node lowering, and restore the original
+  // ones for the other users afterwards.
+  std::vector<std::pair<Output, xla::XlaOp>> original_ops;
+  for (const auto& operand : node->operands()) {
+    xla::XlaOp op = GetOutputOp(operand);
+    if (is_converted(XlaHelpers::TypeOfXlaOp(op))) {
+      original_ops.emplace_back(operand, op);
+      AssignOutputOp(operand, xla::ConvertElementType(op, type));
+    }
+  }
+  XlaOpVector result_ops = node->Lower(this);
+  for (auto& output_op : original_ops) {
+    AssignOutputOp(output_op.first, output_op.second);
+  }
+  for (size_t i = 0; i < result_ops.size(); ++i) {
+    xla::PrimitiveType node_type = node->shape(i).element_type();
+    if (XlaHelpers::TypeOfXlaOp(result_ops[i]) != node_type) {
+      result_ops[i] = xla::ConvertElementType(result_ops[i], node_type);
+      AssignOutputOp(Output(node, i), result_ops[i]);
+    }
+  }
+  return result_ops;
+}
+
 void LoweringContext::ReportBuilderError(const Node* node,
                                          const char* error_msg) {
   std::stringstream ss;
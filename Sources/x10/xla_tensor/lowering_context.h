@@ -27,6 +27,7 @@
 #include "tensorflow/compiler/xla/xla_client/device.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/rematerialization.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/types.h"
 #include "tensorflow/core/platform/macros.h"
@@ -96,6 +97,10 @@ class LoweringContext {
     size_t index = 0;
   };
 
+  // Lowers the node with its floating point operands converted to type, and
+  // converts the outputs back to the element types of the node.
+  XlaOpVector LowerNodeWithType(const Node* node, xla::PrimitiveType type);
+
   // Reports an XLA builder error for the given node.
   TF_ATTRIBUTE_NORETURN void ReportBuilderError(const Node* node,
                                                 const char* error_msg);
@@ -114,9 +119,12 @@ class LoweringContext {
 class RootLoweringContext : public LoweringContext {
  public:
   explicit RootLoweringContext(const std::string& name, Device device);
-  RootLoweringContext(const std::string& name, Device device,
-                      absl::Span<const Node* const> post_order,
-                      Util::EmissionMap emit_status);
+  // Lowers the nodes of post_order. The rematerialization segments are
+  // recomputed right before the node at their position is lowered.
+  RootLoweringContext(
+      const std::string& name, Device device,
+      absl::Span<const Node* const> post_order, Util::EmissionMap emit_status,
+      absl::Span<const RematerializationSegment> remat_segments = {});
   xla::XlaBuilder builder_;
 };
 
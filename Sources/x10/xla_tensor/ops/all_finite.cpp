@@ -0,0 +1,58 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/all_finite.h"
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/xla/client/lib/arithmetic.h"
+#include "tensorflow/compiler/xla/primitive_util.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+AllFinite::AllFinite(absl::Span<const Value> values)
+    : Node(xla_all_finite, values, xla::ShapeUtil::MakeShape(xla::PRED, {}),
+           /*num_outputs=*/1, xla::util::MHash(values.size())) {}
+
+NodePtr AllFinite::Clone(OpList operands) const {
+  return MakeNode<AllFinite>(operands);
+}
+
+XlaOpVector AllFinite::Lower(LoweringContext* loctx) const {
+  xla::XlaBuilder* builder = loctx->builder();
+  xla::XlaOp result = xla::ConstantR0<bool>(builder, true);
+  xla::XlaComputation and_computation =
+      xla::CreateScalarAndComputation(xla::PRED, builder);
+  // The per operand reductions are siblings, which XLA fuses together.
+  for (auto& operand : operands()) {
+    xla::XlaOp op = loctx->GetOutputOp(operand);
+    if (!xla::primitive_util::IsFloatingPointType(
+            XlaHelpers::TypeOfXlaOp(op))) {
+      continue;
+    }
+    result = xla::And(
+        result, xla::ReduceAll(xla::IsFinite(op),
+                               xla::ConstantR0<bool>(builder, true),
+                               and_computation));
+  }
+  return ReturnOp(result, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
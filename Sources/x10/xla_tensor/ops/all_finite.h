@@ -0,0 +1,38 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// Computes whether all the elements of all the operands are finite, as a
+// single boolean scalar. Operands which are not floating point are skipped.
+class AllFinite : public Node {
+ public:
+  explicit AllFinite(absl::Span<const Value> values);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -18,14 +18,27 @@
 #include <sstream>
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
 
 namespace swift_xla {
 namespace ir {
 namespace ops {
+namespace {
+
+xla::hash_t LiteralHash(const xla::Literal& value) {
+  // The node hash already covers the shape, so array literals only need their
+  // data hashed, which can be large.
+  if (value.shape().IsArray()) {
+    return DataTreeHash(value.untyped_data(), value.size_bytes());
+  }
+  return value.Hash();
+}
+
+}  // namespace
 
 Constant::Constant(xla::Literal value)
     : Node(OpKind(at::prim::Constant), value.shape(), /*num_outputs=*/1,
-           value.Hash()),
+           LiteralHash(value)),
       value_(std::move(value)) {}
 
 std::string Constant::ToString() const {
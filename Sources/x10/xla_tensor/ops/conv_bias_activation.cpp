@@ -0,0 +1,104 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/conv_bias_activation.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& input, const Value& kernel,
+                           const Value& bias,
+                           absl::Span<const int64_t> stride,
+                           absl::Span<const int64_t> padding,
+                           absl::Span<const int64_t> dilation, bool transposed,
+                           absl::Span<const int64_t> output_padding,
+                           int64_t groups, ConvActivation activation) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 3);
+    ConvActivationResult result = BuildConvolutionOverrideableBiasActivation(
+        operands[0], operands[1], operands[2], stride, padding, dilation,
+        transposed, output_padding, groups, activation);
+    return xla::Tuple(operands[0].builder(),
+                      {result.output, result.activation_grad});
+  };
+  return InferOutputShape({input.shape(), kernel.shape(), bias.shape()},
+                          lower_for_shape_fn);
+}
+
+}  // namespace
+
+ConvBiasActivation::ConvBiasActivation(
+    const Value& input, const Value& kernel, const Value& bias,
+    std::vector<int64_t> stride, std::vector<int64_t> padding,
+    std::vector<int64_t> dilation, bool transposed,
+    std::vector<int64_t> output_padding, int64_t groups,
+    ConvActivation activation)
+    : Node(xla_conv_bias_activation, {input, kernel, bias},
+           [&]() {
+             return NodeOutputShape(input, kernel, bias, stride, padding,
+                                    dilation, transposed, output_padding,
+                                    groups, activation);
+           },
+           /*num_outputs=*/2,
+           xla::util::MHash(stride, padding, dilation, transposed,
+                            output_padding, groups,
+                            xla::util::GetEnumValue(activation))),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      transposed_(transposed),
+      output_padding_(std::move(output_padding)),
+      groups_(groups),
+      activation_(activation) {}
+
+NodePtr ConvBiasActivation::Clone(OpList operands) const {
+  return MakeNode<ConvBiasActivation>(
+      operands.at(0), operands.at(1), operands.at(2), stride_, padding_,
+      dilation_, transposed_, output_padding_, groups_, activation_);
+}
+
+XlaOpVector ConvBiasActivation::Lower(LoweringContext* loctx) const {
+  xla::XlaOp input = loctx->GetOutputOp(operand(0));
+  xla::XlaOp kernel = loctx->GetOutputOp(operand(1));
+  xla::XlaOp bias = loctx->GetOutputOp(operand(2));
+  ConvActivationResult result = BuildConvolutionOverrideableBiasActivation(
+      input, kernel, bias, stride_, padding_, dilation_, transposed_,
+      output_padding_, groups_, activation_);
+  return ReturnOps({result.output, result.activation_grad}, loctx);
+}
+
+std::string ConvBiasActivation::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", stride=(" << absl::StrJoin(stride_, ", ")
+     << "), padding=(" << absl::StrJoin(padding_, ", ") << "), dilation=("
+     << absl::StrJoin(dilation_, ", ") << "), transposed=" << transposed_
+     << ", output_padding=(" << absl::StrJoin(output_padding_, ", ")
+     << "), groups=" << groups_
+     << ", activation=" << xla::util::GetEnumValue(activation_);
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/convolution.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// A convolution followed by a bias add and a pointwise activation, lowered as
+// a single block. The first output is the activation of the result, and the
+// second one is what the backward pass needs from the activation (see
+// BuildConvolutionOverrideableBiasActivation).
+class ConvBiasActivation : public Node {
+ public:
+  ConvBiasActivation(const Value& input, const Value& kernel,
+                     const Value& bias, std::vector<int64_t> stride,
+                     std::vector<int64_t> padding,
+                     std::vector<int64_t> dilation, bool transposed,
+                     std::vector<int64_t> output_padding, int64_t groups,
+                     ConvActivation activation);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  const std::vector<int64_t>& stride() const { return stride_; }
+
+  const std::vector<int64_t>& padding() const { return padding_; }
+
+  const std::vector<int64_t>& dilation() const { return dilation_; }
+
+  bool transposed() const { return transposed_; }
+
+  const std::vector<int64_t>& output_padding() const {
+    return output_padding_;
+  }
+
+  int64_t groups() const { return groups_; }
+
+  ConvActivation activation() const { return activation_; }
+
+ private:
+  std::vector<int64_t> stride_;
+  std::vector<int64_t> padding_;
+  std::vector<int64_t> dilation_;
+  bool transposed_;
+  std::vector<int64_t> output_padding_;
+  int64_t groups_;
+  ConvActivation activation_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,106 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/conv_bias_activation_backward.h"
+
+#include "absl/strings/str_join.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/convolution.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(const Value& grad_output, const Value& input,
+                           const Value& kernel, const Value& activation_grad,
+                           absl::Span<const int64_t> stride,
+                           absl::Span<const int64_t> padding,
+                           absl::Span<const int64_t> dilation, bool transposed,
+                           absl::Span<const int64_t> output_padding,
+                           int64_t groups) {
+  auto lower_for_shape_fn =
+      [&](absl::Span<const xla::XlaOp> operands) -> xla::XlaOp {
+    XLA_CHECK_EQ(operands.size(), 4);
+    ConvGrads grads = BuildConvolutionBiasActivationBackward(
+        operands[0], operands[1], operands[2], operands[3], stride, padding,
+        dilation, transposed, output_padding, groups);
+    return xla::Tuple(operands[0].builder(),
+                      {grads.grad_input, grads.grad_weight, grads.grad_bias});
+  };
+  return InferOutputShape({grad_output.shape(), input.shape(), kernel.shape(),
+                           activation_grad.shape()},
+                          lower_for_shape_fn);
+}
+
+}  // namespace
+
+ConvBiasActivationBackward::ConvBiasActivationBackward(
+    const Value& grad_output, const Value& input, const Value& kernel,
+    const Value& activation_grad, std::vector<int64_t> stride,
+    std::vector<int64_t> padding, std::vector<int64_t> dilation,
+    bool transposed, std::vector<int64_t> output_padding, int64_t groups)
+    : Node(xla_conv_bias_activation_backward,
+           {grad_output, input, kernel, activation_grad},
+           [&]() {
+             return NodeOutputShape(grad_output, input, kernel,
+                                    activation_grad, stride, padding,
+                                    dilation, transposed, output_padding,
+                                    groups);
+           },
+           /*num_outputs=*/3,
+           xla::util::MHash(stride, padding, dilation, transposed,
+                            output_padding, groups)),
+      stride_(std::move(stride)),
+      padding_(std::move(padding)),
+      dilation_(std::move(dilation)),
+      transposed_(transposed),
+      output_padding_(std::move(output_padding)),
+      groups_(groups) {}
+
+NodePtr ConvBiasActivationBackward::Clone(OpList operands) const {
+  return MakeNode<ConvBiasActivationBackward>(
+      operands.at(0), operands.at(1), operands.at(2), operands.at(3), stride_,
+      padding_, dilation_, transposed_, output_padding_, groups_);
+}
+
+XlaOpVector ConvBiasActivationBackward::Lower(LoweringContext* loctx) const {
+  xla::XlaOp grad_output = loctx->GetOutputOp(operand(0));
+  xla::XlaOp input = loctx->GetOutputOp(operand(1));
+  xla::XlaOp kernel = loctx->GetOutputOp(operand(2));
+  xla::XlaOp activation_grad = loctx->GetOutputOp(operand(3));
+  ConvGrads grads = BuildConvolutionBiasActivationBackward(
+      grad_output, input, kernel, activation_grad, stride_, padding_,
+      dilation_, transposed_, output_padding_, groups_);
+  return ReturnOps({grads.grad_input, grads.grad_weight, grads.grad_bias},
+                   loctx);
+}
+
+std::string ConvBiasActivationBackward::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString() << ", stride=(" << absl::StrJoin(stride_, ", ")
+     << "), padding=(" << absl::StrJoin(padding_, ", ") << "), dilation=("
+     << absl::StrJoin(dilation_, ", ") << "), transposed=" << transposed_
+     << ", output_padding=(" << absl::StrJoin(output_padding_, ", ")
+     << "), groups=" << groups_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -0,0 +1,70 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// The backward of ConvBiasActivation. The operands are the gradient of the
+// output, the input, the kernel and the activation_grad output of the forward
+// node, and the outputs are the gradients of the input, kernel and bias.
+class ConvBiasActivationBackward : public Node {
+ public:
+  ConvBiasActivationBackward(const Value& grad_output, const Value& input,
+                             const Value& kernel,
+                             const Value& activation_grad,
+                             std::vector<int64_t> stride,
+                             std::vector<int64_t> padding,
+                             std::vector<int64_t> dilation, bool transposed,
+                             std::vector<int64_t> output_padding,
+                             int64_t groups);
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  std::string ToString() const override;
+
+  const std::vector<int64_t>& stride() const { return stride_; }
+
+  const std::vector<int64_t>& padding() const { return padding_; }
+
+  const std::vector<int64_t>& dilation() const { return dilation_; }
+
+  bool transposed() const { return transposed_; }
+
+  const std::vector<int64_t>& output_padding() const {
+    return output_padding_;
+  }
+
+  int64_t groups() const { return groups_; }
+
+ private:
+  std::vector<int64_t> stride_;
+  std::vector<int64_t> padding_;
+  std::vector<int64_t> dilation_;
+  bool transposed_;
+  std::vector<int64_t> output_padding_;
+  int64_t groups_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
@@ -25,6 +25,8 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/infer_output_shape.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/constant.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/random.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/xla_lower_util.h"
 #include "tensorflow/compiler/tf2xla/lib/random.h"
@@ -176,6 +178,16 @@ NodePtr BroadcastTensors(absl::Span<const Value> tensors) {
       std::move(lower_fn), /*num_outputs=*/tensors.size());
 }
 
+NodePtr RngSeedPair(const Value& seed) {
+  auto lower_fn = [](const Node& node, LoweringContext* loctx) -> XlaOpVector {
+    xla::XlaOp xla_seed = loctx->GetOutputOp(node.operand(0));
+    return node.ReturnOp(swift_xla::RngSeedPair(xla_seed), loctx);
+  };
+  return GenericOp(xla_rng_seed_pair, {seed},
+                   xla::ShapeUtil::MakeShape(xla::PrimitiveType::S32, {2}),
+                   std::move(lower_fn));
+}
+
 }  // namespace ops
 }  // namespace ir
 }  // namespace swift_xla
@@ -73,6 +73,9 @@ NodePtr LinSpace(at::Scalar start, at::Scalar stop, int64_t num,
 
 NodePtr BroadcastTensors(absl::Span<const Value> tensors);
 
+// Converts a U64 seed into the S32[2] seeds of the stateless random operations.
+NodePtr RngSeedPair(const Value& seed);
+
 }  // namespace ops
 }  // namespace ir
 }  // namespace swift_xla
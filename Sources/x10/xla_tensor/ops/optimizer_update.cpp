@@ -0,0 +1,114 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/optimizer_update.h"
+
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+namespace {
+
+xla::Shape NodeOutputShape(absl::Span<const Value> weights,
+                           absl::Span<const Value> states) {
+  std::vector<xla::Shape> tuple_shapes;
+  tuple_shapes.reserve(weights.size() + states.size());
+  for (auto& weight : weights) {
+    tuple_shapes.push_back(weight.shape());
+  }
+  for (auto& state : states) {
+    tuple_shapes.push_back(state.shape());
+  }
+  return xla::ShapeUtil::MakeTupleShape(tuple_shapes);
+}
+
+std::vector<Value> GetOperandList(absl::Span<const Value> hyperparameters,
+                                  absl::Span<const Value> weights,
+                                  absl::Span<const Value> grads,
+                                  absl::Span<const Value> states) {
+  std::vector<Value> operand_list(hyperparameters.begin(),
+                                  hyperparameters.end());
+  operand_list.insert(operand_list.end(), weights.begin(), weights.end());
+  operand_list.insert(operand_list.end(), grads.begin(), grads.end());
+  operand_list.insert(operand_list.end(), states.begin(), states.end());
+  return operand_list;
+}
+
+}  // namespace
+
+OptimizerUpdate::OptimizerUpdate(OptimizerUpdateType update_type,
+                                 bool nesterov, bool weight_decay,
+                                 absl::Span<const Value> hyperparameters,
+                                 absl::Span<const Value> weights,
+                                 absl::Span<const Value> grads,
+                                 absl::Span<const Value> states)
+    : Node(xla_optimizer_update,
+           GetOperandList(hyperparameters, weights, grads, states),
+           [&]() { return NodeOutputShape(weights, states); },
+           /*num_outputs=*/weights.size() + states.size(),
+           xla::util::MHash(xla::util::GetEnumValue(update_type), nesterov,
+                            weight_decay)),
+      update_type_(update_type),
+      nesterov_(nesterov),
+      weight_decay_(weight_decay),
+      num_weights_(weights.size()) {}
+
+NodePtr OptimizerUpdate::Clone(OpList operands) const {
+  size_t num_hyperparameters =
+      OptimizerUpdateHyperparameterCount(update_type_);
+  OpList weights = operands.subspan(num_hyperparameters, num_weights_);
+  OpList grads =
+      operands.subspan(num_hyperparameters + num_weights_, num_weights_);
+  return MakeNode<OptimizerUpdate>(
+      update_type_, nesterov_, weight_decay_,
+      operands.subspan(0, num_hyperparameters), weights, grads,
+      operands.subspan(num_hyperparameters + 2 * num_weights_));
+}
+
+XlaOpVector OptimizerUpdate::Lower(LoweringContext* loctx) const {
+  size_t num_hyperparameters =
+      OptimizerUpdateHyperparameterCount(update_type_);
+  std::vector<xla::XlaOp> inputs;
+  inputs.reserve(operands().size());
+  for (auto& operand : operands()) {
+    inputs.push_back(loctx->GetOutputOp(operand));
+  }
+  absl::Span<const xla::XlaOp> ops(inputs);
+  OptimizerUpdateResult result = BuildOptimizerUpdate(
+      update_type_, nesterov_, weight_decay_,
+      ops.subspan(0, num_hyperparameters),
+      ops.subspan(num_hyperparameters, num_weights_),
+      ops.subspan(num_hyperparameters + num_weights_, num_weights_),
+      ops.subspan(num_hyperparameters + 2 * num_weights_));
+  std::vector<xla::XlaOp> outputs(std::move(result.steps));
+  outputs.insert(outputs.end(), result.states.begin(), result.states.end());
+  return ReturnOps(outputs, loctx);
+}
+
+std::string OptimizerUpdate::ToString() const {
+  std::stringstream ss;
+  ss << Node::ToString()
+     << ", update_type=" << xla::util::GetEnumValue(update_type_)
+     << ", nesterov=" << nesterov_ << ", weight_decay=" << weight_decay_
+     << ", num_weights=" << num_weights_;
+  return ss.str();
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
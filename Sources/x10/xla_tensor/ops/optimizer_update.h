@@ -0,0 +1,60 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/optimizer_updates.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+// Updates a list of weights with a single node. The operands are the
+// hyperparameters, weights, gradients and states, in this order, and the
+// outputs are the steps for every weight followed by the new states.
+class OptimizerUpdate : public Node {
+ public:
+  OptimizerUpdate(OptimizerUpdateType update_type, bool nesterov,
+                  bool weight_decay, absl::Span<const Value> hyperparameters,
+                  absl::Span<const Value> weights,
+                  absl::Span<const Value> grads,
+                  absl::Span<const Value> states);
+
+  std::string ToString() const override;
+
+  NodePtr Clone(OpList operands) const override;
+
+  XlaOpVector Lower(LoweringContext* loctx) const override;
+
+  OptimizerUpdateType update_type() const { return update_type_; }
+
+  bool nesterov() const { return nesterov_; }
+
+  bool weight_decay() const { return weight_decay_; }
+
+  size_t num_weights() const { return num_weights_; }
+
+ private:
+  OptimizerUpdateType update_type_;
+  bool nesterov_;
+  bool weight_decay_;
+  size_t num_weights_;
+};
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
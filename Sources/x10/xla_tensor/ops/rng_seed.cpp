@@ -0,0 +1,45 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/rng_seed.h"
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/random.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace ops {
+
+RngSeed::RngSeed(const Value& state)
+    : Node(xla_rng_seed, {state},
+           xla::ShapeUtil::MakeTupleShape(
+               {xla::ShapeUtil::MakeShape(xla::PrimitiveType::U64, {}),
+                state.shape()}),
+           /*num_outputs=*/2) {}
+
+NodePtr RngSeed::Clone(OpList operands) const {
+  return MakeNode<RngSeed>(operands.at(0));
+}
+
+XlaOpVector RngSeed::Lower(LoweringContext* loctx) const {
+  xla::XlaOp state = loctx->GetOutputOp(operand(0));
+  auto seed_and_state = SplitRngState(state);
+  return ReturnOps({seed_and_state.first, seed_and_state.second}, loctx);
+}
+
+}  // namespace ops
+}  // namespace ir
+}  // namespace swift_xla
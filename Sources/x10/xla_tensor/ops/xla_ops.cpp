@@ -20,11 +20,16 @@ namespace swift_xla {
 namespace ir {
 namespace ops {
 
+const OpKindWrapper xla_all_finite(xla_symbols::all_finite);
 const OpKindWrapper xla_all_to_all(xla_symbols::all_to_all);
 const OpKindWrapper xla_as_strided_view_update(
     xla_symbols::as_strided_view_update);
 const OpKindWrapper xla_cast(xla_symbols::cast);
 const OpKindWrapper xla_collective_permute(xla_symbols::collective_permute);
+const OpKindWrapper xla_conv_bias_activation(
+    xla_symbols::conv_bias_activation);
+const OpKindWrapper xla_conv_bias_activation_backward(
+    xla_symbols::conv_bias_activation_backward);
 const OpKindWrapper xla_cross_replica_sum(xla_symbols::cross_replica_sum);
 const OpKindWrapper xla_device_data(xla_symbols::device_data);
 const OpKindWrapper xla_diagonal_view_update(xla_symbols::diagonal_view_update);
@@ -33,9 +38,12 @@ const OpKindWrapper xla_get_dimensions_size(xla_symbols::get_dimensions_size);
 const OpKindWrapper xla_moving_average(xla_symbols::moving_average);
 const OpKindWrapper xla_nms(xla_symbols::nms);
 const OpKindWrapper xla_not_supported(xla_symbols::not_supported);
+const OpKindWrapper xla_optimizer_update(xla_symbols::optimizer_update);
 const OpKindWrapper xla_replication_pad(xla_symbols::replication_pad);
 const OpKindWrapper xla_replication_pad_backward(
     xla_symbols::replication_pad_backward);
+const OpKindWrapper xla_rng_seed(xla_symbols::rng_seed);
+const OpKindWrapper xla_rng_seed_pair(xla_symbols::rng_seed_pair);
 const OpKindWrapper xla_select(xla_symbols::select);
 const OpKindWrapper xla_tensor_data(xla_symbols::tensor_data);
 const OpKindWrapper xla_token(xla_symbols::token);
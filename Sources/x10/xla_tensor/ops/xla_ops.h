@@ -37,10 +37,13 @@ class OpKindWrapper {
   OpKind op_kind_;
 };
 
+extern const OpKindWrapper xla_all_finite;
 extern const OpKindWrapper xla_all_to_all;
 extern const OpKindWrapper xla_as_strided_view_update;
 extern const OpKindWrapper xla_cast;
 extern const OpKindWrapper xla_collective_permute;
+extern const OpKindWrapper xla_conv_bias_activation;
+extern const OpKindWrapper xla_conv_bias_activation_backward;
 extern const OpKindWrapper xla_cross_replica_sum;
 extern const OpKindWrapper xla_device_data;
 extern const OpKindWrapper xla_diagonal_view_update;
@@ -49,8 +52,11 @@ extern const OpKindWrapper xla_get_dimensions_size;
 extern const OpKindWrapper xla_moving_average;
 extern const OpKindWrapper xla_nms;
 extern const OpKindWrapper xla_not_supported;
+extern const OpKindWrapper xla_optimizer_update;
 extern const OpKindWrapper xla_replication_pad;
 extern const OpKindWrapper xla_replication_pad_backward;
+extern const OpKindWrapper xla_rng_seed;
+extern const OpKindWrapper xla_rng_seed_pair;
 extern const OpKindWrapper xla_select;
 extern const OpKindWrapper xla_tensor_data;
 extern const OpKindWrapper xla_token;
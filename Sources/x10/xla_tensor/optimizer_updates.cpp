@@ -0,0 +1,208 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/optimizer_updates.h"
+
+#include <map>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/convert_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
+#include "tensorflow/compiler/xla/client/lib/constants.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace {
+
+// The weights of a given element type, which are updated together out of a
+// single flat buffer.
+struct FlatGroup {
+  std::vector<size_t> indices;
+  std::vector<xla::Shape> shapes;
+};
+
+std::map<xla::PrimitiveType, FlatGroup> GetFlatGroups(
+    absl::Span<const xla::XlaOp> weights) {
+  std::map<xla::PrimitiveType, FlatGroup> groups;
+  for (size_t i = 0; i < weights.size(); ++i) {
+    xla::Shape shape = XlaHelpers::ShapeOfXlaOp(weights[i]);
+    FlatGroup& group = groups[shape.element_type()];
+    group.indices.push_back(i);
+    group.shapes.push_back(std::move(shape));
+  }
+  return groups;
+}
+
+// Flattens and concatenates ops[base + index] for every weight of the group.
+xla::XlaOp Pack(absl::Span<const xla::XlaOp> ops, const FlatGroup& group,
+                size_t base) {
+  std::vector<xla::XlaOp> flat_ops;
+  flat_ops.reserve(group.indices.size());
+  for (size_t i = 0; i < group.indices.size(); ++i) {
+    flat_ops.push_back(
+        xla::Reshape(ops[base + group.indices[i]],
+                     {xla::ShapeUtil::ElementsIn(group.shapes[i])}));
+  }
+  return flat_ops.size() == 1
+             ? flat_ops.front()
+             : xla::ConcatInDim(flat_ops.front().builder(), flat_ops, 0);
+}
+
+// Splits a buffer created by Pack() back into the weight shaped pieces, and
+// stores them at (*results)[base + index].
+void Unpack(xla::XlaOp flat, const FlatGroup& group, size_t base,
+            std::vector<xla::XlaOp>* results) {
+  int64_t start = 0;
+  for (size_t i = 0; i < group.indices.size(); ++i) {
+    int64_t size = xla::ShapeUtil::ElementsIn(group.shapes[i]);
+    xla::XlaOp slice = xla::SliceInDim(flat, start, start + size,
+                                       /*stride=*/1, /*dimno=*/0);
+    (*results)[base + group.indices[i]] =
+        xla::Reshape(slice, group.shapes[i].dimensions());
+    start += size;
+  }
+}
+
+xla::XlaOp L2Norm(xla::XlaOp input, xla::PrimitiveType type) {
+  xla::XlaOp zero = xla::Zero(input.builder(), type);
+  return xla::Sqrt(xla::ReduceAll(input * input, zero,
+                                  XlaHelpers::CreateAddComputation(type)));
+}
+
+// Computes the LARS trust ratio of every weight of the group, broadcast over
+// the elements of the weight within the flat buffer.
+xla::XlaOp BuildTrustRatios(absl::Span<const xla::XlaOp> weights,
+                            absl::Span<const xla::XlaOp> grads,
+                            const FlatGroup& group, xla::XlaOp weight_decay,
+                            xla::XlaOp trust_coefficient, xla::XlaOp epsilon,
+                            xla::PrimitiveType type) {
+  xla::XlaBuilder* builder = weight_decay.builder();
+  xla::XlaOp zero = xla::Zero(builder, type);
+  xla::XlaOp one = xla::One(builder, type);
+  std::vector<xla::XlaOp> ratios;
+  ratios.reserve(group.indices.size());
+  for (size_t i = 0; i < group.indices.size(); ++i) {
+    xla::XlaOp param_norm = L2Norm(weights[group.indices[i]], type);
+    xla::XlaOp grad_norm = L2Norm(grads[group.indices[i]], type);
+    xla::XlaOp trust_ratio =
+        trust_coefficient * param_norm /
+        (grad_norm + weight_decay * param_norm + epsilon);
+    xla::XlaOp ratio =
+        xla::Select(xla::Gt(grad_norm + param_norm, zero), trust_ratio, one);
+    ratios.push_back(xla::Broadcast(
+        ratio, {xla::ShapeUtil::ElementsIn(group.shapes[i])}));
+  }
+  return ratios.size() == 1 ? ratios.front()
+                            : xla::ConcatInDim(builder, ratios, 0);
+}
+
+}  // namespace
+
+size_t OptimizerUpdateHyperparameterCount(OptimizerUpdateType type) {
+  switch (type) {
+    case OptimizerUpdateType::kSgd:
+      return 3;
+    case OptimizerUpdateType::kAdam:
+    case OptimizerUpdateType::kLars:
+      return 5;
+  }
+  XLA_ERROR() << "Invalid optimizer update type: "
+              << xla::util::GetEnumValue(type);
+}
+
+size_t OptimizerUpdateStateCount(OptimizerUpdateType type) {
+  switch (type) {
+    case OptimizerUpdateType::kSgd:
+    case OptimizerUpdateType::kLars:
+      return 1;
+    case OptimizerUpdateType::kAdam:
+      return 2;
+  }
+  XLA_ERROR() << "Invalid optimizer update type: "
+              << xla::util::GetEnumValue(type);
+}
+
+OptimizerUpdateResult BuildOptimizerUpdate(
+    OptimizerUpdateType type, bool nesterov, bool weight_decay,
+    absl::Span<const xla::XlaOp> hyperparameters,
+    absl::Span<const xla::XlaOp> weights, absl::Span<const xla::XlaOp> grads,
+    absl::Span<const xla::XlaOp> states) {
+  size_t num_weights = weights.size();
+  size_t num_states = OptimizerUpdateStateCount(type);
+  XLA_CHECK(!weights.empty());
+  XLA_CHECK_EQ(hyperparameters.size(),
+               OptimizerUpdateHyperparameterCount(type));
+  XLA_CHECK_EQ(grads.size(), num_weights);
+  XLA_CHECK_EQ(states.size(), num_states * num_weights);
+
+  OptimizerUpdateResult result;
+  result.steps.resize(num_weights);
+  result.states.resize(states.size());
+  for (auto& type_group : GetFlatGroups(weights)) {
+    xla::PrimitiveType element_type = type_group.first;
+    const FlatGroup& group = type_group.second;
+    std::vector<xla::XlaOp> hp;
+    hp.reserve(hyperparameters.size());
+    for (xla::XlaOp hyperparameter : hyperparameters) {
+      hp.push_back(MaybeConvertTo(hyperparameter, element_type));
+    }
+    xla::XlaOp grad = Pack(grads, group, 0);
+    switch (type) {
+      case OptimizerUpdateType::kSgd:
+      case OptimizerUpdateType::kLars: {
+        xla::XlaOp lr = hp[0];
+        xla::XlaOp momentum = hp[1];
+        xla::XlaOp wd = hp[2];
+        if (weight_decay) {
+          grad = grad + Pack(weights, group, 0) * wd;
+        }
+        if (type == OptimizerUpdateType::kLars) {
+          // The trust ratios are computed from the original gradients.
+          grad = grad * BuildTrustRatios(weights, grads, group, wd,
+                                         /*trust_coefficient=*/hp[3],
+                                         /*epsilon=*/hp[4], element_type);
+        }
+        xla::XlaOp velocity = momentum * Pack(states, group, 0) - grad * lr;
+        xla::XlaOp step = nesterov ? momentum * velocity - grad * lr : velocity;
+        Unpack(step, group, 0, &result.steps);
+        Unpack(velocity, group, 0, &result.states);
+        break;
+      }
+      case OptimizerUpdateType::kAdam: {
+        xla::XlaOp lr = hp[0];
+        xla::XlaOp beta1 = hp[1];
+        xla::XlaOp beta2 = hp[2];
+        xla::XlaOp wd = hp[3];
+        xla::XlaOp epsilon = hp[4];
+        xla::XlaOp one = xla::One(grad.builder(), element_type);
+        xla::XlaOp first_moment =
+            beta1 * Pack(states, group, 0) + grad * (one - beta1);
+        xla::XlaOp second_moment =
+            beta2 * Pack(states, group, num_weights) +
+            grad * grad * (one - beta2);
+        xla::XlaOp update =
+            first_moment / (xla::Sqrt(second_moment) + epsilon) +
+            Pack(weights, group, 0) * wd;
+        Unpack(xla::Neg(lr) * update, group, 0, &result.steps);
+        Unpack(first_moment, group, 0, &result.states);
+        Unpack(second_moment, group, num_weights, &result.states);
+        break;
+      }
+    }
+  }
+  return result;
+}
+
+}  // namespace swift_xla
@@ -0,0 +1,66 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+
+namespace swift_xla {
+
+// Multi-tensor optimizer updates. Every update takes its scalar
+// hyperparameters, the weights, their gradients and the optimizer state
+// tensors, and computes the step to add to each weight together with the new
+// optimizer state. The hyperparameters are, in order:
+//
+//   kSgd:  learning_rate, momentum, weight_decay
+//   kAdam: learning_rate, beta1, beta2, weight_decay, epsilon
+//   kLars: learning_rate, momentum, weight_decay, trust_coefficient, epsilon
+//
+// kSgd and kLars keep one state tensor (velocity) per weight, kAdam two (first
+// and second moment). The state tensors are passed state-major, so the j-th
+// state of weight i sits at index j * weights.size() + i.
+enum class OptimizerUpdateType {
+  kSgd,
+  kAdam,
+  kLars,
+};
+
+struct OptimizerUpdateResult {
+  std::vector<xla::XlaOp> steps;
+  std::vector<xla::XlaOp> states;
+};
+
+// Returns the number of hyperparameters taken by the given update type.
+size_t OptimizerUpdateHyperparameterCount(OptimizerUpdateType type);
+
+// Returns the number of state tensors kept per weight by the given update
+// type.
+size_t OptimizerUpdateStateCount(OptimizerUpdateType type);
+
+// Builds the update of all the weights at once. The weights, gradients and
+// states are flattened and concatenated into one buffer per element type, so
+// the elementwise math is emitted once for the whole group instead of once per
+// weight.
+OptimizerUpdateResult BuildOptimizerUpdate(
+    OptimizerUpdateType type, bool nesterov, bool weight_decay,
+    absl::Span<const xla::XlaOp> hyperparameters,
+    absl::Span<const xla::XlaOp> weights, absl::Span<const xla::XlaOp> grads,
+    absl::Span<const xla::XlaOp> states);
+
+}  // namespace swift_xla
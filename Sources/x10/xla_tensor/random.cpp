@@ -19,6 +19,7 @@
 
 #include "tensorflow/compiler/xla/client/lib/constants.h"
 #include "tensorflow/compiler/xla/client/lib/prng.h"
+#include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/sys_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/convert_ops.h"
@@ -185,4 +186,41 @@ xla::XlaOp RngNormal(xla::XlaOp seed, const xla::Shape& shape, xla::XlaOp mean,
   }
 }
 
+std::pair<xla::XlaOp, xla::XlaOp> SplitRngState(xla::XlaOp state) {
+  xla::XlaBuilder* builder = state.builder();
+  xla::XlaOp u64_state = xla::BitcastConvertType(state, xla::PrimitiveType::U64);
+  xla::XlaOp key = xla::Reshape(xla::SliceInDim(u64_state, 0, 1, 1, 0), {});
+  xla::XlaOp counter =
+      xla::Reshape(xla::SliceInDim(u64_state, 1, 2, 1, 0), {});
+  // The philox generator replaces the state with the scrambled key, so the
+  // counter is folded into the key as well.
+  xla::XlaOp mixed_key =
+      key ^ (counter *
+             xla::ConstantR0<xla::uint64>(builder, 0x9E3779B97F4A7C15ULL));
+  xla::XlaOp seed =
+      GetBitGenerator()(mixed_key, counter,
+                        xla::ShapeUtil::MakeShape(xla::PrimitiveType::U64, {}))
+          .value;
+  xla::XlaOp next_counter =
+      counter + xla::One(builder, xla::PrimitiveType::U64);
+  xla::XlaOp next_state =
+      xla::BitcastConvertType(xla::ConcatScalars(builder, {key, next_counter}),
+                              xla::PrimitiveType::S64);
+  return std::make_pair(seed, next_state);
+}
+
+xla::XlaOp RngSeedPair(xla::XlaOp seed) {
+  xla::XlaBuilder* builder = seed.builder();
+  // The stateless operations sign extend the seeds, so they are kept positive.
+  xla::XlaOp mask = xla::ConstantR0<xla::uint64>(builder, 0x7fffffff);
+  xla::XlaOp low = xla::ConvertElementType(xla::And(seed, mask),
+                                           xla::PrimitiveType::S32);
+  xla::XlaOp high = xla::ConvertElementType(
+      xla::And(xla::ShiftRightLogical(
+                   seed, xla::ConstantR0<xla::uint64>(builder, 32)),
+               mask),
+      xla::PrimitiveType::S32);
+  return xla::ConcatScalars(builder, {low, high});
+}
+
 }  // namespace swift_xla
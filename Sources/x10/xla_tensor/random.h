@@ -16,6 +16,8 @@
 
 #pragma once
 
+#include <utility>
+
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 
 namespace swift_xla {
@@ -26,4 +28,13 @@ xla::XlaOp RngUniform(xla::XlaOp seed, const xla::Shape& shape,
 xla::XlaOp RngNormal(xla::XlaOp seed, const xla::Shape& shape, xla::XlaOp mean,
                      xla::XlaOp std);
 
+// Splits the counter based RNG state of a device, a S64[2] tensor holding the
+// key and the counter, into the U64 seed of a random operation and the next
+// state. The seed is drawn with the bit generator selected by
+// XLA_RNG_BIT_GENERATOR.
+std::pair<xla::XlaOp, xla::XlaOp> SplitRngState(xla::XlaOp state);
+
+// Converts a U64 seed into the S32[2] seeds of the stateless random operations.
+xla::XlaOp RngSeedPair(xla::XlaOp seed);
+
 }  // namespace swift_xla
@@ -0,0 +1,387 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/rematerialization.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/xla/shape_util.h"
+
+namespace swift_xla {
+namespace ir {
+namespace {
+
+// Operations which are cheap to recompute compared to the memory their outputs
+// hold: elementwise operations, views and the reductions norms are built of.
+bool IsCheap(const Node* node) {
+  if (node->num_outputs() != 1) {
+    return false;
+  }
+  switch (node->op().op) {
+    case at::aten::abs:
+    case at::aten::add:
+    case at::aten::clamp:
+    case at::aten::div:
+    case at::aten::erf:
+    case at::aten::exp:
+    case at::aten::expand:
+    case at::aten::expm1:
+    case at::aten::gelu:
+    case at::aten::leaky_relu:
+    case at::aten::log:
+    case at::aten::log1p:
+    case at::aten::max:
+    case at::aten::mean:
+    case at::aten::min:
+    case at::aten::mul:
+    case at::aten::neg:
+    case at::aten::permute:
+    case at::aten::pow:
+    case at::aten::reciprocal:
+    case at::aten::relu:
+    case at::aten::rsqrt:
+    case at::aten::sigmoid:
+    case at::aten::sign:
+    case at::aten::softplus:
+    case at::aten::sqrt:
+    case at::aten::sub:
+    case at::aten::sum:
+    case at::aten::tanh:
+    case at::aten::view:
+    case at::aten::where:
+    case at::prim::Constant:
+    case xla_symbols::cast:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Values which are available anywhere in the computation, without holding
+// memory of their own. Slices and views of device data, like the scalars read
+// out of the scalar packs, count as well.
+bool IsAvailable(const Node* node) {
+  while (node->op() == OpKind(at::aten::xla_slice) ||
+         node->op() == OpKind(at::aten::view)) {
+    node = node->operand(0).node;
+  }
+  return node->op() == OpKind(xla_symbols::device_data) ||
+         node->op() == OpKind(at::prim::Constant);
+}
+
+int64_t OutputBytes(const Output& output) {
+  return xla::ShapeUtil::ByteSizeOf(output.shape(), sizeof(void*));
+}
+
+int64_t NodeFlops(const Node* node) {
+  int64_t elements = xla::ShapeUtil::ElementsIn(node->shape());
+  for (const auto& operand : node->operands()) {
+    elements = std::max(elements, xla::ShapeUtil::ElementsIn(operand.shape()));
+  }
+  return elements;
+}
+
+struct Candidate {
+  Output root;
+  // The value is released after the user at gap_start, and recomputed for the
+  // user at gap_end.
+  size_t gap_start = 0;
+  size_t gap_end = 0;
+  int64_t bytes = 0;
+  bool done = false;
+};
+
+class RematerializationPlanner {
+ public:
+  RematerializationPlanner(absl::Span<const Node* const> post_order,
+                           absl::Span<const Value> roots,
+                           const RematerializationConfig& config)
+      : post_order_(post_order), config_(config) {
+    for (size_t i = 0; i < post_order_.size(); ++i) {
+      for (const auto& operand : post_order_[i]->operands()) {
+        auto& uses = uses_[operand];
+        if (uses.empty() || uses.back() != i) {
+          uses.push_back(i);
+        }
+      }
+    }
+    for (const auto& root : roots) {
+      held_.insert(Output(root.node.get(), root.index));
+    }
+  }
+
+  RematerializationPlan Run() {
+    RematerializationPlan plan;
+    ComputeLiveBytes();
+    plan.stats.peak_bytes = PeakBytes();
+    plan.stats.rematerialized_peak_bytes = plan.stats.peak_bytes;
+    if (plan.stats.peak_bytes <= config_.memory_budget) {
+      return plan;
+    }
+    std::vector<Candidate> candidates = CollectCandidates();
+    while (plan.stats.rematerialized_peak_bytes > config_.memory_budget) {
+      size_t peak_position = PeakPosition();
+      Candidate* best = nullptr;
+      RematerializationSegment best_segment;
+      for (auto& candidate : candidates) {
+        if (candidate.done || candidate.gap_start >= peak_position ||
+            candidate.gap_end <= peak_position ||
+            (best != nullptr && candidate.bytes <= best->bytes)) {
+          continue;
+        }
+        RematerializationSegment segment;
+        if (!BuildSegment(candidate, &segment)) {
+          // Values only get released, so the candidate will not become valid
+          // later on.
+          candidate.done = true;
+          continue;
+        }
+        best = &candidate;
+        best_segment = std::move(segment);
+      }
+      if (best == nullptr) {
+        break;
+      }
+      best->done = true;
+      for (size_t i = best->gap_start + 1; i < best->gap_end; ++i) {
+        live_bytes_[i] -= best->bytes;
+      }
+      released_[best->root] = std::make_pair(best->gap_start, best->gap_end);
+      for (const auto& input : best_segment.inputs) {
+        input_positions_[input].push_back(best_segment.position);
+      }
+      plan.stats.extra_flops += best_segment.flops;
+      plan.stats.rematerialized_peak_bytes = PeakBytes();
+      plan.segments.push_back(std::move(best_segment));
+    }
+    plan.stats.segments = plan.segments.size();
+    std::stable_sort(plan.segments.begin(), plan.segments.end(),
+                     [](const RematerializationSegment& a,
+                        const RematerializationSegment& b) {
+                       return a.position < b.position;
+                     });
+    return plan;
+  }
+
+ private:
+  size_t LastUse(const Output& output, size_t position) const {
+    if (held_.contains(output)) {
+      return post_order_.size();
+    }
+    auto it = uses_.find(output);
+    return it != uses_.end() ? it->second.back() : position;
+  }
+
+  void ComputeLiveBytes() {
+    std::vector<int64_t> deltas(post_order_.size() + 1, 0);
+    for (size_t i = 0; i < post_order_.size(); ++i) {
+      const Node* node = post_order_[i];
+      if (IsAvailable(node)) {
+        continue;
+      }
+      for (size_t j = 0; j < node->num_outputs(); ++j) {
+        Output output(node, j);
+        int64_t bytes = OutputBytes(output);
+        deltas[i] += bytes;
+        deltas[std::min(LastUse(output, i) + 1, post_order_.size())] -= bytes;
+      }
+    }
+    live_bytes_.resize(post_order_.size());
+    int64_t live = 0;
+    for (size_t i = 0; i < post_order_.size(); ++i) {
+      live += deltas[i];
+      live_bytes_[i] = live;
+    }
+  }
+
+  size_t PeakPosition() const {
+    return std::max_element(live_bytes_.begin(), live_bytes_.end()) -
+           live_bytes_.begin();
+  }
+
+  int64_t PeakBytes() const {
+    return live_bytes_.empty() ? 0 : live_bytes_[PeakPosition()];
+  }
+
+  std::vector<Candidate> CollectCandidates() const {
+    std::vector<Candidate> candidates;
+    for (size_t i = 0; i < post_order_.size(); ++i) {
+      const Node* node = post_order_[i];
+      Output output(node, 0);
+      if (!IsCheap(node) || IsAvailable(node) || held_.contains(output)) {
+        continue;
+      }
+      auto it = uses_.find(output);
+      if (it == uses_.end()) {
+        continue;
+      }
+      // Split the uses at the widest gap.
+      Candidate candidate;
+      candidate.root = output;
+      size_t previous = i;
+      for (size_t use : it->second) {
+        if (use - previous > candidate.gap_end - candidate.gap_start) {
+          candidate.gap_start = previous;
+          candidate.gap_end = use;
+        }
+        previous = use;
+      }
+      if (candidate.gap_end - candidate.gap_start < config_.min_distance) {
+        continue;
+      }
+      candidate.bytes = OutputBytes(output);
+      candidates.push_back(candidate);
+    }
+    return candidates;
+  }
+
+  bool IsLiveAt(const Output& output, size_t position) const {
+    if (IsAvailable(output.node) || held_.contains(output)) {
+      return true;
+    }
+    auto it = uses_.find(output);
+    if (it == uses_.end() || it->second.back() < position) {
+      return false;
+    }
+    auto rit = released_.find(output);
+    return rit == released_.end() || position <= rit->second.first ||
+           position >= rit->second.second;
+  }
+
+  bool BuildSegment(const Candidate& candidate,
+                    RematerializationSegment* segment) const {
+    // Releasing the value must not break a segment already using it as input.
+    auto pit = input_positions_.find(candidate.root);
+    if (pit != input_positions_.end()) {
+      for (size_t position : pit->second) {
+        if (position > candidate.gap_start && position < candidate.gap_end) {
+          return false;
+        }
+      }
+    }
+    segment->root = candidate.root;
+    segment->position = candidate.gap_end;
+    segment->bytes = candidate.bytes;
+    const std::string& scope = candidate.root.node->metadata().scope;
+    absl::flat_hash_set<const Node*> nodes = {candidate.root.node};
+    absl::flat_hash_set<Output, Output::Hasher> inputs;
+    std::vector<const Node*> stack = {candidate.root.node};
+    while (!stack.empty()) {
+      const Node* node = stack.back();
+      stack.pop_back();
+      segment->flops += NodeFlops(node);
+      for (const auto& operand : node->operands()) {
+        if (nodes.contains(operand.node) || inputs.contains(operand)) {
+          continue;
+        }
+        bool live = IsLiveAt(operand, candidate.gap_end);
+        if (live || !IsCheap(operand.node) ||
+            (config_.use_scopes && operand.node->metadata().scope != scope)) {
+          if (!live) {
+            return false;
+          }
+          inputs.insert(operand);
+          segment->inputs.push_back(operand);
+        } else {
+          if (nodes.size() >= config_.max_segment_nodes) {
+            return false;
+          }
+          nodes.insert(operand.node);
+          stack.push_back(operand.node);
+        }
+      }
+    }
+    return true;
+  }
+
+  absl::Span<const Node* const> post_order_;
+  const RematerializationConfig& config_;
+  OutputMap<std::vector<size_t>> uses_;
+  absl::flat_hash_set<Output, Output::Hasher> held_;
+  std::vector<int64_t> live_bytes_;
+  OutputMap<std::pair<size_t, size_t>> released_;
+  OutputMap<std::vector<size_t>> input_positions_;
+};
+
+}  // namespace
+
+const RematerializationConfig& GetRematerializationConfig() {
+  static const RematerializationConfig* config = []() {
+    RematerializationConfig* config = new RematerializationConfig();
+    config->memory_budget =
+        xla::sys_util::GetEnvInt("XLA_REMAT_MEMORY_BUDGET", 0);
+    config->min_distance = xla::sys_util::GetEnvInt(
+        "XLA_REMAT_MIN_DISTANCE", config->min_distance);
+    config->max_segment_nodes = xla::sys_util::GetEnvInt(
+        "XLA_REMAT_MAX_SEGMENT_NODES", config->max_segment_nodes);
+    config->use_scopes =
+        xla::sys_util::GetEnvBool("XLA_REMAT_USE_SCOPES", false);
+    return config;
+  }();
+  return *config;
+}
+
+RematerializationPlan PlanRematerialization(
+    absl::Span<const Node* const> post_order, absl::Span<const Value> roots,
+    const RematerializationConfig& config) {
+  return RematerializationPlanner(post_order, roots, config).Run();
+}
+
+void EmitRematerialization(const RematerializationSegment& segment,
+                           xla::XlaOp anchor, LoweringContext* loctx) {
+  std::vector<xla::XlaOp> barrier_ops;
+  barrier_ops.reserve(segment.inputs.size() + 1);
+  for (const auto& input : segment.inputs) {
+    barrier_ops.push_back(loctx->GetOutputOp(input));
+  }
+  if (anchor.valid()) {
+    barrier_ops.push_back(anchor);
+  }
+  // The recomputation reads the inputs through an optimization barrier, which
+  // also carries the anchor. So XLA can neither merge it with the original
+  // value, nor schedule it before the anchor is computed.
+  xla::XlaOp barrier =
+      xla::OptimizationBarrier(xla::Tuple(loctx->builder(), barrier_ops));
+  Util::EmissionMap emap;
+  for (const auto& input : segment.inputs) {
+    emap[input.node] = Util::kEmitted;
+  }
+  LoweringContext remat_loctx(loctx->builder(), loctx->device(),
+                              std::move(emap));
+  for (size_t i = 0; i < segment.inputs.size(); ++i) {
+    remat_loctx.AssignOutputOp(segment.inputs[i],
+                               xla::GetTupleElement(barrier, i));
+  }
+  loctx->AssignOutputOp(segment.root, remat_loctx.GetOutputOp(segment.root));
+}
+
+std::string RematerializationStatsToString(
+    const RematerializationStats& stats) {
+  std::stringstream ss;
+  ss << "segments=" << stats.segments << " peak_bytes=" << stats.peak_bytes
+     << " rematerialized_peak_bytes=" << stats.rematerialized_peak_bytes
+     << " memory_saved="
+     << stats.peak_bytes - stats.rematerialized_peak_bytes
+     << " extra_flops=" << stats.extra_flops;
+  return ss.str();
+}
+
+}  // namespace ir
+}  // namespace swift_xla
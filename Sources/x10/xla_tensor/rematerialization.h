@@ -0,0 +1,93 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "tensorflow/compiler/xla/client/xla_builder.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+
+namespace swift_xla {
+namespace ir {
+
+class LoweringContext;
+
+// A value which is released after its early users, and recomputed right before
+// the first of its late users is lowered. The recomputation starts from the
+// inputs, which are all live at that point anyway.
+struct RematerializationSegment {
+  Output root;
+  std::vector<Output> inputs;
+  // Post order position of the first late user.
+  size_t position = 0;
+  int64_t bytes = 0;
+  int64_t flops = 0;
+};
+
+struct RematerializationStats {
+  // Peak bytes held by intermediate values before and after the pass.
+  int64_t peak_bytes = 0;
+  int64_t rematerialized_peak_bytes = 0;
+  // Estimated extra element operations run by the recomputations.
+  int64_t extra_flops = 0;
+  size_t segments = 0;
+};
+
+struct RematerializationPlan {
+  // Sorted by position.
+  std::vector<RematerializationSegment> segments;
+  RematerializationStats stats;
+};
+
+struct RematerializationConfig {
+  // The peak of bytes held by intermediate values the pass aims for.
+  int64_t memory_budget = 0;
+  // Values are only recomputed if their users are at least this far apart in
+  // the post order.
+  size_t min_distance = 16;
+  // The maximum number of nodes recomputed for a single value.
+  size_t max_segment_nodes = 8;
+  // Whether recomputed segments stay within the IR scope of their root.
+  bool use_scopes = false;
+};
+
+// Returns the configuration taken from the XLA_REMAT_* environment variables.
+// Rematerialization is disabled when the memory budget is not positive.
+const RematerializationConfig& GetRematerializationConfig();
+
+// Picks the cheap values (elementwise operations and reductions) of the post
+// order to recompute, until the estimated peak of live intermediate values fits
+// in the memory budget, or no candidate is left. Values which are held by the
+// roots are never released.
+RematerializationPlan PlanRematerialization(
+    absl::Span<const Node* const> post_order, absl::Span<const Value> roots,
+    const RematerializationConfig& config);
+
+// Emits the recomputation of the segment and assigns it as the lowering of
+// its root, so that the following users pick it up. The recomputation is not
+// started before anchor, the last value lowered before the late user, is
+// available. The anchor can be invalid for segments at the start of the graph.
+void EmitRematerialization(const RematerializationSegment& segment,
+                           xla::XlaOp anchor, LoweringContext* loctx);
+
+std::string RematerializationStatsToString(const RematerializationStats& stats);
+
+}  // namespace ir
+}  // namespace swift_xla
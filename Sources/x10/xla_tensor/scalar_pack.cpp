@@ -0,0 +1,145 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/scalar_pack.h"
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "tensorflow/compiler/xla/xla_client/computation_client.h"
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/metrics.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/view.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_slice.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
+
+namespace swift_xla {
+namespace {
+
+struct ScalarPack {
+  at::ScalarType scalar_type;
+  std::vector<at::Scalar> values;
+  xla::ComputationClient::DataPtr data;
+  ir::Value ir_value;
+};
+
+at::Tensor MakePackTensor(const ScalarPack& pack, int64_t capacity) {
+  switch (pack.scalar_type) {
+#define PACK_TENSOR_CASE(name, aten_name, DType)          \
+  case at::ScalarType::aten_name: {                       \
+    std::unique_ptr<DType[]> data(new DType[capacity]()); \
+    for (size_t i = 0; i < pack.values.size(); ++i) {     \
+      data[i] = pack.values[i].to<DType>();               \
+    }                                                     \
+    return at::Tensor(std::move(data), {capacity});       \
+  }
+    LIST_SCALAR_TYPES(PACK_TENSOR_CASE)
+#undef PACK_TENSOR_CASE
+  }
+}
+
+class ScalarPackArena {
+ public:
+  static ScalarPackArena* Get() {
+    static ScalarPackArena* arena = new ScalarPackArena();
+    return arena;
+  }
+
+  ir::Value GetIrValue(at::Scalar value, at::ScalarType scalar_type,
+                       const Device& device) {
+    std::lock_guard<std::mutex> lock(lock_);
+    ScalarPack* pack = GetOpenPack(scalar_type, device);
+    int64_t index = pack->values.size();
+    pack->values.push_back(value);
+    ir::Value slice = ir::MakeNode<ir::ops::XlaSlice>(
+        pack->ir_value, std::vector<int64_t>{index},
+        std::vector<int64_t>{index + 1}, std::vector<int64_t>{1});
+    return ir::MakeNode<ir::ops::View>(slice, std::vector<int64_t>());
+  }
+
+  void Flush(const Device& device) {
+    std::vector<ScalarPack> packs;
+    {
+      std::lock_guard<std::mutex> lock(lock_);
+      auto it = device_packs_.find(device);
+      if (it == device_packs_.end()) {
+        return;
+      }
+      packs = std::move(it->second);
+      device_packs_.erase(it);
+    }
+    std::vector<at::Tensor> tensors;
+    tensors.reserve(packs.size());
+    for (auto& pack : packs) {
+      tensors.push_back(MakePackTensor(pack, capacity_));
+    }
+    std::vector<xla::ComputationClient::DataPtr> handles =
+        CreateTensorsData(tensors, device.ToString());
+    for (size_t i = 0; i < packs.size(); ++i) {
+      packs[i].data->Assign(*handles[i]);
+    }
+    XLA_COUNTER("ScalarPackUploads", packs.size());
+  }
+
+ private:
+  ScalarPackArena()
+      : capacity_(xla::sys_util::GetEnvInt("XLA_SCALAR_PACK_SIZE", 64)) {}
+
+  // Returns the pack the next scalar of the given type should go to, creating
+  // a new one once the current is full.
+  ScalarPack* GetOpenPack(at::ScalarType scalar_type, const Device& device) {
+    std::vector<ScalarPack>& packs = device_packs_[device];
+    for (auto it = packs.rbegin(); it != packs.rend(); ++it) {
+      if (it->scalar_type == scalar_type && it->values.size() < capacity_) {
+        return &*it;
+      }
+    }
+    ScalarPack pack;
+    pack.scalar_type = scalar_type;
+    pack.data = xla::GetX10Device(device)->CreateDataPlaceholder(
+        CreateComputationShapeFromTensor(MakePackTensor(pack, capacity_),
+                                         &device));
+    pack.ir_value = ir::MakeNode<ir::ops::DeviceData>(pack.data);
+    packs.push_back(std::move(pack));
+    return &packs.back();
+  }
+
+  std::mutex lock_;
+  size_t capacity_ = 0;
+  std::map<Device, std::vector<ScalarPack>> device_packs_;
+};
+
+}  // namespace
+
+bool ScalarPacks::Enabled() {
+  static const bool enabled =
+      xla::sys_util::GetEnvBool("XLA_PACK_SCALARS", true);
+  return enabled;
+}
+
+ir::Value ScalarPacks::GetIrValue(at::Scalar value, at::ScalarType scalar_type,
+                                  const Device& device) {
+  return ScalarPackArena::Get()->GetIrValue(std::move(value), scalar_type,
+                                            device);
+}
+
+void ScalarPacks::Flush(const Device& device) {
+  ScalarPackArena::Get()->Flush(device);
+}
+
+}  // namespace swift_xla
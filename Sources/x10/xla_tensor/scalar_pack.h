@@ -0,0 +1,47 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/aten_compat.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
+#include "tensorflow/compiler/xla/xla_client/device.h"
+
+namespace swift_xla {
+
+// Per device staging area for the scalar values which IR graphs read from
+// device data (learning rates, step counts, loss scales, ...). Instead of one
+// transfer per scalar, the values are collected into fixed size packs, which
+// get uploaded with a single transfer when the graphs reading them are synced.
+// Every scalar is emitted as a slice of the device data holding its pack, so
+// the graph hashes depend on the position of the scalars within the packs, but
+// not on their values.
+class ScalarPacks {
+ public:
+  // Whether the scalars should be routed through packs. Can be turned off with
+  // XLA_PACK_SCALARS=0.
+  static bool Enabled();
+
+  // Returns an IR value holding value as a scalar of scalar_type on device.
+  static ir::Value GetIrValue(at::Scalar value, at::ScalarType scalar_type,
+                              const Device& device);
+
+  // Uploads the pending packs of device. Must be called before lowering the IR
+  // graphs which read them.
+  static void Flush(const Device& device);
+};
+
+}  // namespace swift_xla
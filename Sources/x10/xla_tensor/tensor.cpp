@@ -20,6 +20,7 @@
 #include <condition_variable>
 #include <exception>
 #include <functional>
+#include <map>
 #include <mutex>
 #include <set>
 #include <stdexcept>
@@ -35,6 +36,7 @@
 #include "tensorflow/compiler/xla/xla_client/thread_pool.h"
 #include "tensorflow/compiler/xla/xla_client/unique.h"
 #include "tensorflow/compiler/xla/xla_client/xla_util.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/auto_mixed_precision.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/debug_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_dump_util.h"
@@ -44,8 +46,12 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/cast.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/device_data.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/expand.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/rng_seed.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/scalar.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/rematerialization.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/scalar_pack.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_convert.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/tensor_util.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
@@ -314,6 +320,12 @@ bool ShouldSyncIrValue(const ir::Value& ir_value) {
   return ir_value->op() != ir::ops::xla_not_supported;
 }
 
+void CopyTensorDataInto(const at::Tensor& tensor_data, void* buffer,
+                        size_t buffer_size) {
+  XLA_CHECK_EQ(tensor_data.nbytes(), buffer_size) << "Wrong buffer size";
+  ParallelMemcpy(buffer, tensor_data.raw_data(), buffer_size);
+}
+
 }  // namespace
 
 // The DeviceContextArena holds per device live information and statistics,
@@ -325,9 +337,14 @@ class XLATensor::DeviceContextArena {
   struct DeviceContext {
     std::mutex lock;
     absl::flat_hash_map<int64_t, std::weak_ptr<Data>> tensors_data;
+    // Guards the RNG fields. The RNG state is a live tensor, whose creation
+    // and updates take the lock above.
+    std::mutex rng_lock;
     xla::uint64 seed = 101;
-    xla::uint64 running_seed = 101;
-    ir::Value seed_ir_value;
+    // The S64[2] key and counter of the counter based RNG. The counter is
+    // advanced within the computations using the seeds, so the state never
+    // leaves the device. Created lazily from the seed.
+    absl::optional<XLATensor> rng_state;
   };
 
  public:
@@ -377,33 +394,59 @@ class XLATensor::DeviceContextArena {
     return tensors;
   }
 
-  xla::uint64 GetRunningSeed(const Device& device) {
+  ir::Value GetRngSeed(const Device& device) {
     DeviceContext* devctx = GetDeviceContext(device);
-    std::lock_guard<std::mutex> lock(devctx->lock);
-    return devctx->running_seed;
+    std::lock_guard<std::mutex> lock(devctx->rng_lock);
+    XLATensor& state = GetRngState(devctx, device);
+    ir::NodePtr node = ir::MakeNode<ir::ops::RngSeed>(state.GetIrValue());
+    state.SetIrValue(ir::Value(node, 1));
+    return ir::Value(node, 0);
+  }
+
+  XLATensor GetRngState(const Device& device) {
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->rng_lock);
+    // Hands out a different tensor, so that the advances of the state do not
+    // show up in it.
+    return XLATensor::Create(GetRngState(devctx, device).GetIrValue(), device);
+  }
+
+  void SetRngState(const Device& device, const XLATensor& state) {
+    XLA_CHECK(xla::ShapeUtil::Equal(
+        state.shape().get(),
+        xla::ShapeUtil::MakeShape(xla::PrimitiveType::S64, {2})))
+        << "Invalid RNG state shape: " << state.shape().get();
+    DeviceContext* devctx = GetDeviceContext(device);
+    std::lock_guard<std::mutex> lock(devctx->rng_lock);
+    devctx->rng_state = XLATensor::Create(state.GetIrValue(), device);
   }
 
   void SetRngSeed(const Device* device, xla::uint64 seed) {
     auto fn = [&](DeviceContext* devctx) {
-      std::lock_guard<std::mutex> lock(devctx->lock);
+      std::lock_guard<std::mutex> lock(devctx->rng_lock);
       devctx->seed = seed;
-      devctx->running_seed = devctx->seed;
-      devctx->seed_ir_value = ir::Value();
+      devctx->rng_state = absl::nullopt;
     };
     ForAllDeviceContexts(fn, device);
   }
 
-  void StepRngSeed(const Device* device) {
-    auto fn = [&](DeviceContext* devctx) {
-      std::lock_guard<std::mutex> lock(devctx->lock);
-      devctx->seed = 1012031 + devctx->seed * 7012063;
-      devctx->running_seed = devctx->seed;
-      devctx->seed_ir_value = ir::Value();
-    };
-    ForAllDeviceContexts(fn, device);
+ private:
+  XLATensor& GetRngState(DeviceContext* devctx, const Device& device) {
+    if (!devctx->rng_state) {
+      std::unique_ptr<int64_t[]> values(
+          new int64_t[2]{static_cast<int64_t>(devctx->seed), 0});
+      // The state is always S64, which the RNG ops bitcast to U64, even when
+      // Long tensors are stored as S32 on the device (XLA_USE_32BIT_LONG).
+      xla::Shape shape = MakeArrayShapeFromDimensions(
+          {2}, /*dynamic_dimensions=*/{}, xla::PrimitiveType::S64,
+          device.hw_type);
+      devctx->rng_state = XLATensor::Create(
+          TensorToXlaData(at::Tensor(std::move(values), {2}), shape, device),
+          at::ScalarType::Long);
+    }
+    return *devctx->rng_state;
   }
 
- private:
   std::vector<DeviceContext*> GetAllDeviceContexts() {
     std::vector<DeviceContext*> all_device_contexts;
     all_device_contexts.reserve(device_contexts_.size());
@@ -591,6 +634,7 @@ xla::ComputationClient::DataPtr XLATensor::GetXlaData() {
   } else {
     XLA_CHECK(data()->tensor_data);
     data()->xla_data = TensorToXlaData(*data()->tensor_data, GetDevice());
+    ReleaseBorrowedTensorData();
   }
   return data()->xla_data;
 }
@@ -683,6 +727,14 @@ ir::Value XLATensor::GetIrValue() const {
   }
   c10::optional<at::Tensor> tensor_data = CurrentTensorData();
   XLA_CHECK(tensor_data);
+  if (tensor_data->rank() > 0 && tensor_data->buffer().borrowed()) {
+    // Keep the uploaded data instead of the borrowed buffer, so that it can be
+    // released right away.
+    data()->xla_data = TensorToXlaData(*tensor_data, GetDevice());
+    ReleaseBorrowedTensorData();
+    AssignIrValue(CreateTensorNode(data()->xla_data, /*read_only=*/false));
+    return data()->ir_value;
+  }
   AssignIrValue(GetIrValueForTensor(*tensor_data, GetDevice()));
   return data()->ir_value;
 }
@@ -699,6 +751,12 @@ c10::optional<at::Tensor> XLATensor::CurrentTensorData() const {
   return data()->tensor_data;
 }
 
+void XLATensor::ReleaseBorrowedTensorData() const {
+  if (data()->tensor_data && data()->tensor_data->buffer().borrowed()) {
+    data()->tensor_data = absl::nullopt;
+  }
+}
+
 ir::Value XLATensor::GetIrValueForTensor(const at::Tensor& tensor,
                                          const Device& device) const {
   xla::ComputationClient::DataPtr data;
@@ -710,6 +768,10 @@ ir::Value XLATensor::GetIrValueForTensor(const at::Tensor& tensor,
           std::move(value),
           MakeXlaPrimitiveType(tensor.scalar_type(), &device));
     }
+    if (ScalarPacks::Enabled()) {
+      return ScalarPacks::GetIrValue(std::move(value), tensor.scalar_type(),
+                                     device);
+    }
     data = GetDeviceData(tensor, device);
     read_only = true;
   } else {
@@ -725,6 +787,10 @@ ir::Value XLATensor::GetIrValueForScalar(at::Scalar value,
   if (IsSpecialScalar(value)) {
     return ir::ops::ScalarOp(std::move(value), type);
   }
+  if (ScalarPacks::Enabled()) {
+    return ScalarPacks::GetIrValue(std::move(value),
+                                   TensorTypeFromXlaType(type), device);
+  }
   xla::ComputationClient::DataPtr data =
       GetDeviceData(value, TensorTypeFromXlaType(type), device);
   data->SetInfo(
@@ -905,6 +971,152 @@ std::vector<at::Tensor> XLATensor::GetTensorsFused(
   return results;
 }
 
+std::vector<at::Tensor> XLATensor::MaterializeTensors(
+    std::vector<XLATensor>* tensors) {
+  std::vector<c10::optional<at::Tensor>> results(tensors->size());
+  std::map<Device, std::vector<size_t>> device_indices;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    results[i] = (*tensors)[i].CurrentTensorData();
+    if (!results[i]) {
+      device_indices[(*tensors)[i].GetDevice()].push_back(i);
+    }
+  }
+  for (auto& device_and_indices : device_indices) {
+    const std::vector<size_t>& indices = device_and_indices.second;
+    std::vector<XLATensor> device_tensors;
+    device_tensors.reserve(indices.size());
+    for (auto index : indices) {
+      device_tensors.push_back((*tensors)[index]);
+    }
+    DeviceBarrier(device_and_indices.first);
+    SyncTensorsGraph(&device_tensors, {}, /*wait=*/true,
+                     /*sync_xla_data=*/false);
+
+    std::vector<xla::ComputationClient::DataPtr> tensors_data;
+    std::vector<at::ScalarType> element_types;
+    tensors_data.reserve(device_tensors.size());
+    element_types.reserve(device_tensors.size());
+    for (auto& tensor : device_tensors) {
+      tensors_data.push_back(tensor.GetXlaData());
+      element_types.push_back(tensor.dtype());
+    }
+    std::vector<at::Tensor> values =
+        XlaDataToTensors(tensors_data, element_types);
+    for (size_t i = 0; i < indices.size(); ++i) {
+      device_tensors[i].SetTensorData(values[i]);
+      results[indices[i]] = std::move(values[i]);
+    }
+  }
+  std::vector<at::Tensor> tensors_values;
+  tensors_values.reserve(results.size());
+  for (auto& result : results) {
+    tensors_values.push_back(std::move(*result));
+  }
+  return tensors_values;
+}
+
+void XLATensor::MaterializeTensorsInto(std::vector<XLATensor>* tensors,
+                                       absl::Span<void* const> buffers,
+                                       absl::Span<const size_t> buffer_sizes) {
+  XLA_CHECK_EQ(tensors->size(), buffers.size());
+  XLA_CHECK_EQ(tensors->size(), buffer_sizes.size());
+  std::map<Device, std::vector<size_t>> device_indices;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
+    if (tensor_data) {
+      CopyTensorDataInto(*tensor_data, buffers[i], buffer_sizes[i]);
+    } else {
+      device_indices[(*tensors)[i].GetDevice()].push_back(i);
+    }
+  }
+  for (auto& device_and_indices : device_indices) {
+    const std::vector<size_t>& indices = device_and_indices.second;
+    std::vector<XLATensor> device_tensors;
+    device_tensors.reserve(indices.size());
+    for (auto index : indices) {
+      device_tensors.push_back((*tensors)[index]);
+    }
+    DeviceBarrier(device_and_indices.first);
+    SyncTensorsGraph(&device_tensors, {}, /*wait=*/true,
+                     /*sync_xla_data=*/false);
+
+    std::vector<xla::ComputationClient::DataPtr> tensors_data;
+    std::vector<at::ScalarType> element_types;
+    std::vector<void*> device_buffers;
+    std::vector<size_t> device_buffer_sizes;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      tensors_data.push_back(device_tensors[i].GetXlaData());
+      element_types.push_back(device_tensors[i].dtype());
+      device_buffers.push_back(buffers[indices[i]]);
+      device_buffer_sizes.push_back(buffer_sizes[indices[i]]);
+    }
+    XlaDataToBuffers(tensors_data, element_types, device_buffers,
+                     device_buffer_sizes);
+  }
+}
+
+std::shared_ptr<XLATensor::MaterializeAsync> XLATensor::MaterializeTensorsAsync(
+    std::vector<XLATensor>* tensors, absl::Span<void* const> buffers,
+    absl::Span<const size_t> buffer_sizes) {
+  XLA_CHECK_EQ(tensors->size(), buffers.size());
+  XLA_CHECK_EQ(tensors->size(), buffer_sizes.size());
+  auto async = std::make_shared<MaterializeAsync>();
+  std::map<Device, std::vector<size_t>> device_indices;
+  for (size_t i = 0; i < tensors->size(); ++i) {
+    c10::optional<at::Tensor> tensor_data = (*tensors)[i].CurrentTensorData();
+    if (tensor_data) {
+      CopyTensorDataInto(*tensor_data, buffers[i], buffer_sizes[i]);
+    } else {
+      device_indices[(*tensors)[i].GetDevice()].push_back(i);
+    }
+  }
+  async->mwait.Reset(device_indices.size());
+  for (auto& device_and_indices : device_indices) {
+    const Device& device = device_and_indices.first;
+    const std::vector<size_t>& indices = device_and_indices.second;
+    std::vector<XLATensor> device_tensors;
+    device_tensors.reserve(indices.size());
+    for (auto index : indices) {
+      device_tensors.push_back((*tensors)[index]);
+    }
+    // The device lock is held by the scheduled computation until it completes,
+    // so the transfer below, which grabs it, sees the final device data.
+    SyncTensorsGraph(&device_tensors, {}, /*wait=*/false,
+                     /*sync_xla_data=*/false);
+
+    std::vector<xla::ComputationClient::DataPtr> tensors_data;
+    std::vector<at::ScalarType> element_types;
+    std::vector<void*> device_buffers;
+    std::vector<size_t> device_buffer_sizes;
+    for (size_t i = 0; i < indices.size(); ++i) {
+      // The computation may still be running, so this can be the placeholder
+      // its results get assigned to.
+      xla::ComputationClient::DataPtr xla_data =
+          device_tensors[i].CurrentXlaData();
+      XLA_CHECK(xla_data != nullptr);
+      tensors_data.push_back(std::move(xla_data));
+      element_types.push_back(device_tensors[i].dtype());
+      device_buffers.push_back(buffers[indices[i]]);
+      device_buffer_sizes.push_back(buffer_sizes[indices[i]]);
+    }
+    auto transferfn = [device, tensors_data = std::move(tensors_data),
+                       element_types = std::move(element_types),
+                       device_buffers = std::move(device_buffers),
+                       device_buffer_sizes = std::move(device_buffer_sizes)]() {
+      xla::util::ExceptionCleanup unlocker = LockDevice(device);
+      for (auto& xla_data : tensors_data) {
+        XLA_CHECK(xla_data->HasValue())
+            << "Materialized device data was not computed: "
+            << xla_data->shape();
+      }
+      XlaDataToBuffers(tensors_data, element_types, device_buffers,
+                       device_buffer_sizes);
+    };
+    xla::env::ScheduleIoClosure(async->mwait.Completer(std::move(transferfn)));
+  }
+  return async;
+}
+
 std::vector<XLATensor> XLATensor::CreateTensors(
     const std::vector<at::Tensor>& tensors,
     const std::vector<std::string>& devices) {
@@ -997,8 +1209,10 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   std::vector<at::Tensor> at_tensors;
   std::vector<size_t> at_tensor_index;
   // The force_xla_data controls aliasing compilation, so effectively the same
-  // graph with on/off force_xla_data should not match, hash wise.
-  coll.hash = xla::util::MHash(config.force_xla_data);
+  // graph with on/off force_xla_data should not match, hash wise. The same
+  // goes for automatic mixed precision, which changes the lowering.
+  coll.hash = xla::util::HashCombine(xla::util::MHash(config.force_xla_data),
+                                     ir::AutoMixedPrecision::Hash());
   coll.config = config;
   coll.device = *unique_device;
   coll.indices.reserve(tensors.size());
@@ -1010,6 +1224,9 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
   }
   TF_VLOG(4) << "Waiting on device barrier for device " << coll.device
              << " done!";
+  // The scalar packs must hold their values before the graphs get lowered, as
+  // their device data handles identify the computation parameters.
+  ScalarPacks::Flush(coll.device);
   for (size_t i = 0; i < tensors.size(); ++i) {
     if (tensors[i].CurrentXlaData() == nullptr) {
       ir::Value ir_value = tensors[i].CurrentIrValue();
@@ -1041,8 +1258,10 @@ XLATensor::SyncTensorCollection XLATensor::CollectSyncTensors(
       // If we are here, it means that the IR Value for the tensor is not
       // present. Also, we uploaded the at::Tensor data to the device, but such
       // data is still valid so we leave it live on the XLA tensor (so that a
-      // following ToTensor() does not need to fetch it from device).
+      // following ToTensor() does not need to fetch it from device). Borrowed
+      // data is dropped though, as its owner may release it at any time.
       tensors[at_tensor_index[i]].data()->xla_data = std::move(handles[i]);
+      tensors[at_tensor_index[i]].ReleaseBorrowedTensorData();
     }
   }
   TF_VLOG(4) << "Tensors graph hash " << xla::util::HexHash(coll.hash)
@@ -1255,7 +1474,6 @@ void XLATensor::SyncLiveTensorsGraph(const Device* device,
 
 void XLATensor::MarkStep(const Device* device) {
   XLA_COUNTER("MarkStep", 1);
-  DeviceContextArena::Get()->StepRngSeed(device);
   ir::ScopePusher::ResetScopes();
   g_tls_data.Reset();
 }
@@ -1361,9 +1579,27 @@ XLATensor::CompilationResult XLATensor::Compile(
   static const bool enable_aliasing =
       xla::sys_util::GetEnvBool("XLA_ENABLE_PARAM_ALIASING", false);
   xla::util::Unique<Device> unique_device;
-  ir::RootLoweringContext lowering_ctx("SyncTensorsGraph", coll.device,
-                                       po_data->post_order,
-                                       std::move(po_data->emission_map));
+  const ir::RematerializationConfig& remat_config =
+      ir::GetRematerializationConfig();
+  ir::RematerializationPlan remat_plan;
+  if (remat_config.memory_budget > 0) {
+    remat_plan = ir::PlanRematerialization(
+        po_data->post_order, CollectRoots(tensors, coll.indices), remat_config);
+    TF_VLOG(3) << "Rematerialization of IR graph hash "
+               << xla::util::HexHash(coll.hash) << ": "
+               << ir::RematerializationStatsToString(remat_plan.stats);
+    if (!remat_plan.segments.empty()) {
+      XLA_COUNTER("RematerializedSegments", remat_plan.stats.segments);
+      XLA_VALUE_METRIC("RematerializationMemorySaved",
+                       remat_plan.stats.peak_bytes -
+                           remat_plan.stats.rematerialized_peak_bytes);
+      XLA_VALUE_METRIC("RematerializationExtraFlops",
+                       remat_plan.stats.extra_flops);
+    }
+  }
+  ir::RootLoweringContext lowering_ctx(
+      "SyncTensorsGraph", coll.device, po_data->post_order,
+      std::move(po_data->emission_map), remat_plan.segments);
   for (auto index : coll.indices) {
     ir::Value ir_value = tensors[index].CurrentIrValue();
     xla::XlaOp root = lowering_ctx.GetOutputOp(ir_value);
@@ -1474,8 +1710,16 @@ void XLATensor::SetRngSeed(const Device* device, xla::uint64 seed) {
   DeviceContextArena::Get()->SetRngSeed(device, seed);
 }
 
-xla::uint64 XLATensor::GetRunningSeed(const Device& device) {
-  return DeviceContextArena::Get()->GetRunningSeed(device);
+ir::Value XLATensor::GetRngSeed(const Device& device) {
+  return DeviceContextArena::Get()->GetRngSeed(device);
+}
+
+XLATensor XLATensor::GetRngState(const Device& device) {
+  return DeviceContextArena::Get()->GetRngState(device);
+}
+
+void XLATensor::SetRngState(const Device& device, const XLATensor& state) {
+  DeviceContextArena::Get()->SetRngState(device, state);
 }
 
 bool XLATensor::ApplyTraceletCutpoint() {
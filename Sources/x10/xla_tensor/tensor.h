@@ -22,10 +22,12 @@
 #include <unordered_map>
 
 #include "tensorflow/compiler/tf2xla/xla_tensor/computation.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/convolution.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/cross_replica_reduces.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/optimizer_updates.h"
 #include "tensorflow/compiler/xla/client/lib/pooling.h"
 #include "tensorflow/compiler/xla/client/xla_builder.h"
 #include "tensorflow/compiler/xla/status.h"
@@ -124,11 +126,18 @@ class XLATensor {
       at::Scalar value, const xla::Shape& shape,
       c10::optional<at::ScalarType> logical_element_type, const Device& device);
 
+  // Returns the U64 seed of a random operation, and advances the RNG state of
+  // the device within the computation, without any host transfer.
   static ir::Value GetRngSeed(const Device& device);
 
+  // Resets the RNG state of the device, or of all the devices if device is
+  // nullptr.
   static void SetRngSeed(const Device* device, xla::uint64 seed);
 
-  static xla::uint64 GetRunningSeed(const Device& device);
+  // The S64[2] RNG state of the device, to checkpoint and restore.
+  static XLATensor GetRngState(const Device& device);
+
+  static void SetRngState(const Device& device, const XLATensor& state);
 
   // Dispatches a comparison operator, setting the logical type of the result
   // appropriately.
@@ -179,6 +188,37 @@ class XLATensor {
   // tensors must be on the same device.
   static std::vector<at::Tensor> GetTensors(std::vector<XLATensor>* tensors);
 
+  // Same as calling ToTensor(/*detached=*/false) on each of the tensors, but
+  // the pending IR operations are applied with a single computation, and the
+  // device data is fetched with a single batched transfer, per device.
+  static std::vector<at::Tensor> MaterializeTensors(
+      std::vector<XLATensor>* tensors);
+
+  // Same as MaterializeTensors(), but writes the values straight into the
+  // given host buffers, which hold the tensors dtype() elements, without
+  // intermediate host tensors.
+  static void MaterializeTensorsInto(std::vector<XLATensor>* tensors,
+                                     absl::Span<void* const> buffers,
+                                     absl::Span<const size_t> buffer_sizes);
+
+  // Tracks an asynchronous materialization started by
+  // MaterializeTensorsAsync(). The buffers hold the values once mwait
+  // completes.
+  struct MaterializeAsync {
+    MaterializeAsync() : mwait(0) {}
+
+    xla::util::MultiWait mwait;
+  };
+
+  // Asynchronous version of MaterializeTensorsInto(). The pending IR
+  // operations are scheduled for execution on the calling thread, while the
+  // transfers of the results into the buffers happen in background, once the
+  // computations completed. The buffers must stay valid until the returned
+  // object, which can be used to poll or wait for the values, completes.
+  static std::shared_ptr<MaterializeAsync> MaterializeTensorsAsync(
+      std::vector<XLATensor>* tensors, absl::Span<void* const> buffers,
+      absl::Span<const size_t> buffer_sizes);
+
   // Operation which creates XLA tensors out of CPU tensors by batching the
   // requests to the computation servers.
   static std::vector<XLATensor> CreateTensors(
@@ -206,6 +246,10 @@ class XLATensor {
                                AllReduceType reduce_type, double scale,
                                std::vector<std::vector<int64_t>> groups);
 
+  // Returns a boolean scalar telling whether all the elements of all the
+  // floating point tensors are finite, computed with a single node.
+  static XLATensor all_finite(absl::Span<const XLATensor> tensors);
+
   static std::pair<XLATensor, ir::Value> all_to_all(
       const XLATensor& input, const ir::Value& token,
       int64_t split_dimension, int64_t concat_dimension,
@@ -215,9 +259,43 @@ class XLATensor {
       const XLATensor& input, const ir::Value& token,
       std::vector<std::pair<int64_t, int64_t>> source_target_pairs);
 
+  // Computes activation(convolution(input, kernel) + bias) with a single node.
+  // Returns the result together with the activation gradient tensor to be
+  // passed to conv_bias_activation_backward.
+  static std::pair<XLATensor, XLATensor> conv_bias_activation(
+      const XLATensor& input, const XLATensor& kernel, const XLATensor& bias,
+      std::vector<int64_t> stride, std::vector<int64_t> padding,
+      std::vector<int64_t> dilation, bool transposed,
+      std::vector<int64_t> output_padding, int64_t groups,
+      ConvActivation activation);
+
+  // Returns the gradients of the input, kernel and bias of
+  // conv_bias_activation.
+  static std::tuple<XLATensor, XLATensor, XLATensor>
+  conv_bias_activation_backward(const XLATensor& grad_output,
+                                const XLATensor& input,
+                                const XLATensor& kernel,
+                                const XLATensor& activation_grad,
+                                std::vector<int64_t> stride,
+                                std::vector<int64_t> padding,
+                                std::vector<int64_t> dilation, bool transposed,
+                                std::vector<int64_t> output_padding,
+                                int64_t groups);
+
   static XLATensor get_dimensions_size(const XLATensor& input,
                                        std::vector<int64_t> dimensions);
 
+  // Computes the steps of a multi-tensor optimizer update, and returns them
+  // together with the new optimizer states. See optimizer_updates.h for the
+  // hyperparameters and states layout.
+  static std::pair<std::vector<XLATensor>, std::vector<XLATensor>>
+  optimizer_update(OptimizerUpdateType update_type, bool nesterov,
+                   bool weight_decay,
+                   absl::Span<const XLATensor> hyperparameters,
+                   absl::Span<const XLATensor> weights,
+                   absl::Span<const XLATensor> grads,
+                   absl::Span<const XLATensor> states);
+
   static std::vector<XLATensor> user_computation(
       const std::string& opname, absl::Span<const XLATensor> inputs,
       ComputationPtr computation);
@@ -234,6 +312,10 @@ class XLATensor {
   static std::vector<XLATensor> broadcast_tensors(
       absl::Span<const XLATensor> tensors);
 
+  // Returns the S32[2] seeds of a stateless random operation, drawn from the
+  // RNG state of the device.
+  static XLATensor rng_seeds(const Device& device);
+
   static XLATensor tf_StatelessRandomNormal(absl::Span<const int64_t> size,
                                             const XLATensor& seeds,
                                             const Device& device,
@@ -400,6 +482,10 @@ class XLATensor {
 
   void SetTensorData(at::Tensor tensor_data);
 
+  // Drops the host data once it has been uploaded, if it is borrowed from a
+  // caller waiting for it to be released.
+  void ReleaseBorrowedTensorData() const;
+
   ir::Value CreateTensorNode(xla::ComputationClient::DataPtr data,
                              bool read_only) const;
 
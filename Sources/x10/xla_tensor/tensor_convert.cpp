@@ -0,0 +1,404 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_convert.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include "tensorflow/compiler/xla/xla_client/debug_macros.h"
+#include "tensorflow/compiler/xla/xla_client/multi_wait.h"
+#include "tensorflow/compiler/xla/xla_client/sys_util.h"
+#include "tensorflow/compiler/xla/xla_client/tf_logging.h"
+#include "tensorflow/compiler/xla/xla_client/thread_pool.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define X10_CONVERT_X86 1
+#include <cpuid.h>
+#include <immintrin.h>
+#elif defined(__aarch64__) && defined(__ARM_NEON)
+#define X10_CONVERT_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace swift_xla {
+namespace {
+
+// The minimum number of elements converted by a single thread.
+const int64_t kMinConvertChunk = 128 * 1024;
+// The minimum number of bytes copied by a single thread.
+const int64_t kMinMemcpyChunk = 2 * 1024 * 1024;
+// Chunk boundaries are aligned to this many elements, so that only the last
+// chunk runs into the scalar tail of the vectorized loops.
+const int64_t kChunkAlignment = 64;
+// The hardware conversions keep the NaN payloads, while Eigen maps all the NaNs
+// to this quiet NaN, keeping only their sign.
+const uint16_t kHalfQuietNaN = 0x7e00;
+const uint16_t kHalfSignMask = 0x8000;
+
+using FloatToBFloat16Fn = void (*)(const float*, tensorflow::bfloat16*,
+                                   int64_t);
+using BFloat16ToFloatFn = void (*)(const tensorflow::bfloat16*, float*,
+                                   int64_t);
+using FloatToHalfFn = void (*)(const float*, xla::half*, int64_t);
+using HalfToFloatFn = void (*)(const xla::half*, float*, int64_t);
+
+struct ConvertKernels {
+  const char* isa;
+  FloatToBFloat16Fn float_to_bf16;
+  BFloat16ToFloatFn bf16_to_float;
+  FloatToHalfFn float_to_half;
+  HalfToFloatFn half_to_float;
+};
+
+void ScalarFloatToBFloat16(const float* src, tensorflow::bfloat16* dest,
+                           int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    dest[i] = tensorflow::bfloat16(src[i]);
+  }
+}
+
+void ScalarBFloat16ToFloat(const tensorflow::bfloat16* src, float* dest,
+                           int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    dest[i] = static_cast<float>(src[i]);
+  }
+}
+
+void ScalarFloatToHalf(const float* src, xla::half* dest, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    dest[i] = xla::half(src[i]);
+  }
+}
+
+void ScalarHalfToFloat(const xla::half* src, float* dest, int64_t n) {
+  for (int64_t i = 0; i < n; ++i) {
+    dest[i] = static_cast<float>(src[i]);
+  }
+}
+
+#if defined(X10_CONVERT_X86)
+
+// Rounds the 8 floats in v to nearest-even bfloat16, mapping NaNs to the same
+// quiet NaN tensorflow::bfloat16 uses. The results are in the lower 16 bits of
+// each 32 bit lane.
+__attribute__((target("avx2"))) inline __m256i Avx2RoundToBFloat16(__m256 v) {
+  __m256i bits = _mm256_castps_si256(v);
+  __m256i lsb =
+      _mm256_and_si256(_mm256_srli_epi32(bits, 16), _mm256_set1_epi32(1));
+  __m256i bias = _mm256_add_epi32(lsb, _mm256_set1_epi32(0x7fff));
+  __m256i rounded = _mm256_srli_epi32(_mm256_add_epi32(bits, bias), 16);
+  __m256i nan_mask = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+  return _mm256_blendv_epi8(rounded, _mm256_set1_epi32(0x7fc0), nan_mask);
+}
+
+__attribute__((target("avx2"))) void Avx2FloatToBFloat16(
+    const float* src, tensorflow::bfloat16* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i lo = Avx2RoundToBFloat16(_mm256_loadu_ps(src + i));
+    __m256i hi = Avx2RoundToBFloat16(_mm256_loadu_ps(src + i + 8));
+    // The pack works within 128 bit lanes, so the 64 bit quads need to be
+    // reordered as 0, 2, 1, 3.
+    __m256i packed =
+        _mm256_permute4x64_epi64(_mm256_packus_epi32(lo, hi), 0xd8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), packed);
+  }
+  ScalarFloatToBFloat16(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx2"))) void Avx2BFloat16ToFloat(
+    const tensorflow::bfloat16* src, float* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    __m256i bits = _mm256_slli_epi32(_mm256_cvtepu16_epi32(values), 16);
+    _mm256_storeu_ps(dest + i, _mm256_castsi256_ps(bits));
+  }
+  ScalarBFloat16ToFloat(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) void Avx2FloatToHalf(const float* src,
+                                                           xla::half* dest,
+                                                           int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m256 v = _mm256_loadu_ps(src + i);
+    __m128i values = _mm256_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+    __m256i nan_mask = _mm256_castps_si256(_mm256_cmp_ps(v, v, _CMP_UNORD_Q));
+    __m128i nan_mask16 = _mm_packs_epi32(_mm256_castsi256_si128(nan_mask),
+                                         _mm256_extracti128_si256(nan_mask, 1));
+    __m128i quiet_nan =
+        _mm_or_si128(_mm_and_si128(values, _mm_set1_epi16(kHalfSignMask)),
+                     _mm_set1_epi16(kHalfQuietNaN));
+    values = _mm_blendv_epi8(values, quiet_nan, nan_mask16);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), values);
+  }
+  ScalarFloatToHalf(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx2,f16c"))) void Avx2HalfToFloat(const xla::half* src,
+                                                           float* dest,
+                                                           int64_t n) {
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    __m128i values =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+    _mm256_storeu_ps(dest + i, _mm256_cvtph_ps(values));
+  }
+  ScalarHalfToFloat(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void Avx512FloatToBFloat16(
+    const float* src, tensorflow::bfloat16* dest, int64_t n) {
+  const __m512i one = _mm512_set1_epi32(1);
+  const __m512i round_bias = _mm512_set1_epi32(0x7fff);
+  const __m512i quiet_nan = _mm512_set1_epi32(0x7fc0);
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 v = _mm512_loadu_ps(src + i);
+    __m512i bits = _mm512_castps_si512(v);
+    __m512i lsb = _mm512_and_si512(_mm512_srli_epi32(bits, 16), one);
+    __m512i rounded = _mm512_srli_epi32(
+        _mm512_add_epi32(bits, _mm512_add_epi32(lsb, round_bias)), 16);
+    __mmask16 nan_mask = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    rounded = _mm512_mask_blend_epi32(nan_mask, rounded, quiet_nan);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i),
+                        _mm512_cvtepi32_epi16(rounded));
+  }
+  ScalarFloatToBFloat16(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void Avx512BFloat16ToFloat(
+    const tensorflow::bfloat16* src, float* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    __m512i bits = _mm512_slli_epi32(_mm512_cvtepu16_epi32(values), 16);
+    _mm512_storeu_ps(dest + i, _mm512_castsi512_ps(bits));
+  }
+  ScalarBFloat16ToFloat(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx512f,avx2"))) void Avx512FloatToHalf(
+    const float* src, xla::half* dest, int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m512 v = _mm512_loadu_ps(src + i);
+    __m256i values = _mm512_cvtps_ph(v, _MM_FROUND_TO_NEAREST_INT);
+    __mmask16 nan_mask = _mm512_cmp_ps_mask(v, v, _CMP_UNORD_Q);
+    __m256i nan_mask16 = _mm512_cvtepi32_epi16(
+        _mm512_maskz_mov_epi32(nan_mask, _mm512_set1_epi32(-1)));
+    __m256i quiet_nan = _mm256_or_si256(
+        _mm256_and_si256(values, _mm256_set1_epi16(kHalfSignMask)),
+        _mm256_set1_epi16(kHalfQuietNaN));
+    values = _mm256_blendv_epi8(values, quiet_nan, nan_mask16);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dest + i), values);
+  }
+  ScalarFloatToHalf(src + i, dest + i, n - i);
+}
+
+__attribute__((target("avx512f"))) void Avx512HalfToFloat(const xla::half* src,
+                                                          float* dest,
+                                                          int64_t n) {
+  int64_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m256i values =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+    _mm512_storeu_ps(dest + i, _mm512_cvtph_ps(values));
+  }
+  ScalarHalfToFloat(src + i, dest + i, n - i);
+}
+
+bool CpuHasF16C() {
+  unsigned int eax, ebx, ecx, edx;
+  if (__get_cpuid(1, &eax, &ebx, &ecx, &edx) == 0) {
+    return false;
+  }
+  return (ecx & bit_F16C) != 0;
+}
+
+#elif defined(X10_CONVERT_NEON)
+
+inline uint16x4_t NeonRoundToBFloat16(float32x4_t v) {
+  uint32x4_t bits = vreinterpretq_u32_f32(v);
+  uint32x4_t lsb = vandq_u32(vshrq_n_u32(bits, 16), vdupq_n_u32(1));
+  uint32x4_t bias = vaddq_u32(lsb, vdupq_n_u32(0x7fff));
+  uint32x4_t rounded = vshrq_n_u32(vaddq_u32(bits, bias), 16);
+  uint32x4_t not_nan = vceqq_f32(v, v);
+  return vmovn_u32(vbslq_u32(not_nan, rounded, vdupq_n_u32(0x7fc0)));
+}
+
+void NeonFloatToBFloat16(const float* src, tensorflow::bfloat16* dest,
+                         int64_t n) {
+  uint16_t* out = reinterpret_cast<uint16_t*>(dest);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint16x4_t lo = NeonRoundToBFloat16(vld1q_f32(src + i));
+    uint16x4_t hi = NeonRoundToBFloat16(vld1q_f32(src + i + 4));
+    vst1q_u16(out + i, vcombine_u16(lo, hi));
+  }
+  ScalarFloatToBFloat16(src + i, dest + i, n - i);
+}
+
+void NeonBFloat16ToFloat(const tensorflow::bfloat16* src, float* dest,
+                         int64_t n) {
+  const uint16_t* in = reinterpret_cast<const uint16_t*>(src);
+  int64_t i = 0;
+  for (; i + 8 <= n; i += 8) {
+    uint16x8_t values = vld1q_u16(in + i);
+    vst1q_f32(dest + i,
+              vreinterpretq_f32_u32(vshll_n_u16(vget_low_u16(values), 16)));
+    vst1q_f32(dest + i + 4,
+              vreinterpretq_f32_u32(vshll_high_n_u16(values, 16)));
+  }
+  ScalarBFloat16ToFloat(src + i, dest + i, n - i);
+}
+
+void NeonFloatToHalf(const float* src, xla::half* dest, int64_t n) {
+  uint16_t* out = reinterpret_cast<uint16_t*>(dest);
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float32x4_t v = vld1q_f32(src + i);
+    uint16x4_t values = vreinterpret_u16_f16(vcvt_f16_f32(v));
+    uint16x4_t not_nan = vmovn_u32(vceqq_f32(v, v));
+    uint16x4_t quiet_nan = vorr_u16(vand_u16(values, vdup_n_u16(kHalfSignMask)),
+                                    vdup_n_u16(kHalfQuietNaN));
+    vst1_u16(out + i, vbsl_u16(not_nan, values, quiet_nan));
+  }
+  ScalarFloatToHalf(src + i, dest + i, n - i);
+}
+
+void NeonHalfToFloat(const xla::half* src, float* dest, int64_t n) {
+  const uint16_t* in = reinterpret_cast<const uint16_t*>(src);
+  int64_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    float16x4_t values = vreinterpret_f16_u16(vld1_u16(in + i));
+    vst1q_f32(dest + i, vcvt_f32_f16(values));
+  }
+  ScalarHalfToFloat(src + i, dest + i, n - i);
+}
+
+#endif
+
+ConvertKernels SelectConvertKernels() {
+  ConvertKernels scalar_kernels = {"scalar", ScalarFloatToBFloat16,
+                                   ScalarBFloat16ToFloat, ScalarFloatToHalf,
+                                   ScalarHalfToFloat};
+  // XLA_HOST_CONVERT_ISA=scalar can be used to disable the vectorized kernels.
+  std::string isa =
+      xla::sys_util::GetEnvString("XLA_HOST_CONVERT_ISA", "auto");
+  if (isa == "scalar") {
+    return scalar_kernels;
+  }
+#if defined(X10_CONVERT_X86)
+  __builtin_cpu_init();
+  if (isa != "avx2" && __builtin_cpu_supports("avx512f")) {
+    return {"avx512", Avx512FloatToBFloat16, Avx512BFloat16ToFloat,
+            Avx512FloatToHalf, Avx512HalfToFloat};
+  }
+  if (__builtin_cpu_supports("avx2") && CpuHasF16C()) {
+    return {"avx2", Avx2FloatToBFloat16, Avx2BFloat16ToFloat, Avx2FloatToHalf,
+            Avx2HalfToFloat};
+  }
+#elif defined(X10_CONVERT_NEON)
+  return {"neon", NeonFloatToBFloat16, NeonBFloat16ToFloat, NeonFloatToHalf,
+          NeonHalfToFloat};
+#endif
+  return scalar_kernels;
+}
+
+const ConvertKernels& GetConvertKernels() {
+  static const ConvertKernels* kernels = []() {
+    ConvertKernels* selected = new ConvertKernels(SelectConvertKernels());
+    TF_VLOG(1) << "Using " << selected->isa << " host conversion kernels";
+    return selected;
+  }();
+  return *kernels;
+}
+
+template <typename S, typename D>
+void ParallelConvert(void (*kernel)(const S*, D*, int64_t), const S* src,
+                     D* dest, int64_t n) {
+  ParallelForChunks(n, kMinConvertChunk, [&](int64_t start, int64_t end) {
+    kernel(src + start, dest + start, end - start);
+  });
+}
+
+}  // namespace
+
+void ConvertFloatToBFloat16(const float* src, tensorflow::bfloat16* dest,
+                            int64_t n) {
+  ParallelConvert(GetConvertKernels().float_to_bf16, src, dest, n);
+}
+
+void ConvertBFloat16ToFloat(const tensorflow::bfloat16* src, float* dest,
+                            int64_t n) {
+  ParallelConvert(GetConvertKernels().bf16_to_float, src, dest, n);
+}
+
+void ConvertFloatToHalf(const float* src, xla::half* dest, int64_t n) {
+  ParallelConvert(GetConvertKernels().float_to_half, src, dest, n);
+}
+
+void ConvertHalfToFloat(const xla::half* src, float* dest, int64_t n) {
+  ParallelConvert(GetConvertKernels().half_to_float, src, dest, n);
+}
+
+void ParallelMemcpy(void* dest, const void* src, size_t size) {
+  char* dest_bytes = reinterpret_cast<char*>(dest);
+  const char* src_bytes = reinterpret_cast<const char*>(src);
+  ParallelForChunks(size, kMinMemcpyChunk, [&](int64_t start, int64_t end) {
+    std::memcpy(dest_bytes + start, src_bytes + start, end - start);
+  });
+}
+
+void ParallelForChunks(int64_t n, int64_t min_chunk,
+                       const std::function<void(int64_t, int64_t)>& fn) {
+  // Use at most 50% of the available cores.
+  static const int64_t max_parts =
+      std::max<int64_t>(std::thread::hardware_concurrency() / 2, 1);
+  if (n <= 0) {
+    return;
+  }
+  // Waiting on the pool from one of its threads would oversubscribe it.
+  if (xla::env::IsThreadPoolThread()) {
+    fn(0, n);
+    return;
+  }
+  int64_t num_parts =
+      std::min<int64_t>(max_parts, n / std::max<int64_t>(min_chunk, 1));
+  if (num_parts <= 1) {
+    fn(0, n);
+    return;
+  }
+  int64_t chunk_size = (n + num_parts - 1) / num_parts;
+  chunk_size =
+      (chunk_size + kChunkAlignment - 1) / kChunkAlignment * kChunkAlignment;
+  num_parts = (n + chunk_size - 1) / chunk_size;
+  xla::util::MultiWait mwait(num_parts);
+  for (int64_t i = 0; i < num_parts; ++i) {
+    int64_t start = i * chunk_size;
+    int64_t end = std::min<int64_t>(start + chunk_size, n);
+    auto chunk_fn = [&fn, start, end]() { fn(start, end); };
+    xla::env::ScheduleClosure(mwait.Completer(std::move(chunk_fn)));
+  }
+  mwait.Wait();
+}
+
+}  // namespace swift_xla
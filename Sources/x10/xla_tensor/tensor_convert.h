@@ -0,0 +1,55 @@
+/*
+ * Copyright 2020 TensorFlow Authors
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+
+#include "tensorflow/compiler/xla/types.h"
+#include "tensorflow/core/lib/bfloat16/bfloat16.h"
+
+namespace swift_xla {
+
+// Host side element conversion and copy kernels used by the tensor upload and
+// download paths. The conversion kernels pick the widest instruction set
+// available at runtime (AVX-512, AVX2/F16C or NEON), and produce bitwise the
+// same results as the scalar tensorflow::bfloat16 and xla::half constructors.
+// Large buffers are split into chunks which are processed by the thread pool.
+
+void ConvertFloatToBFloat16(const float* src, tensorflow::bfloat16* dest,
+                            int64_t n);
+
+void ConvertBFloat16ToFloat(const tensorflow::bfloat16* src, float* dest,
+                            int64_t n);
+
+void ConvertFloatToHalf(const float* src, xla::half* dest, int64_t n);
+
+void ConvertHalfToFloat(const xla::half* src, float* dest, int64_t n);
+
+// Copies size bytes from src to dest, using multiple threads if the buffer is
+// big enough.
+void ParallelMemcpy(void* dest, const void* src, size_t size);
+
+// Splits the [0, n) range into chunks of at least min_chunk elements, and calls
+// fn(start, end) for each of them. Chunks are run in parallel over the thread
+// pool, and the function returns once all of them completed. When called from
+// a thread pool thread, fn is run inline over the whole range.
+void ParallelForChunks(int64_t n, int64_t min_chunk,
+                       const std::function<void(int64_t, int64_t)>& fn);
+
+}  // namespace swift_xla
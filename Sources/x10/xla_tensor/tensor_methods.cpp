@@ -22,10 +22,14 @@
 #include "tensorflow/compiler/tf2xla/xla_tensor/ir_util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/lowering_context.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/all_finite.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/all_reduce.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/annotate.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/conv_bias_activation.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/conv_bias_activation_backward.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/expand.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/ops.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/ops/optimizer_update.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/replica_id.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/tf_stateless_random_normal.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/ops/xla_avg_pool.h"
@@ -200,6 +204,17 @@ std::pair<std::vector<XLATensor>, ir::Value> XLATensor::all_reduce(
   return {results, ir::Value(node, inputs.size())};
 }
 
+XLATensor XLATensor::all_finite(absl::Span<const XLATensor> tensors) {
+  XLA_CHECK(!tensors.empty()) << "all_finite cannot take an empty list";
+  std::vector<ir::Value> values;
+  values.reserve(tensors.size());
+  for (const XLATensor& tensor : tensors) {
+    values.push_back(tensor.GetIrValue());
+  }
+  return tensors.front().CreateFrom(ir::MakeNode<ir::ops::AllFinite>(values),
+                                    at::ScalarType::Bool);
+}
+
 XLATensor XLATensor::annotate(const XLATensor& input, std::string annotation) {
   return input.CreateFrom(
       ir::MakeNode<ir::ops::Annotate>(input.GetIrValue(), annotation));
@@ -222,6 +237,77 @@ std::vector<XLATensor> XLATensor::broadcast_tensors(
   return tensors.front().MakeOutputTensors(node);
 }
 
+std::pair<XLATensor, XLATensor> XLATensor::conv_bias_activation(
+    const XLATensor& input, const XLATensor& kernel, const XLATensor& bias,
+    std::vector<int64_t> stride, std::vector<int64_t> padding,
+    std::vector<int64_t> dilation, bool transposed,
+    std::vector<int64_t> output_padding, int64_t groups,
+    ConvActivation activation) {
+  ir::NodePtr node = ir::MakeNode<ir::ops::ConvBiasActivation>(
+      input.GetIrValue(), kernel.GetIrValue(), bias.GetIrValue(),
+      std::move(stride), std::move(padding), std::move(dilation), transposed,
+      std::move(output_padding), groups, activation);
+  bool is_mask = activation == ConvActivation::kRelu ||
+                 activation == ConvActivation::kRelu6;
+  XLATensor activation_grad =
+      is_mask ? input.CreateFrom(ir::Value(node, 1), at::ScalarType::Bool)
+              : input.CreateFrom(ir::Value(node, 1));
+  return {input.CreateFrom(ir::Value(node, 0)), std::move(activation_grad)};
+}
+
+std::tuple<XLATensor, XLATensor, XLATensor>
+XLATensor::conv_bias_activation_backward(
+    const XLATensor& grad_output, const XLATensor& input,
+    const XLATensor& kernel, const XLATensor& activation_grad,
+    std::vector<int64_t> stride, std::vector<int64_t> padding,
+    std::vector<int64_t> dilation, bool transposed,
+    std::vector<int64_t> output_padding, int64_t groups) {
+  ir::NodePtr node = ir::MakeNode<ir::ops::ConvBiasActivationBackward>(
+      grad_output.GetIrValue(), input.GetIrValue(), kernel.GetIrValue(),
+      activation_grad.GetIrValue(), std::move(stride), std::move(padding),
+      std::move(dilation), transposed, std::move(output_padding), groups);
+  return std::make_tuple(input.CreateFrom(ir::Value(node, 0)),
+                         kernel.CreateFrom(ir::Value(node, 1)),
+                         kernel.CreateFrom(ir::Value(node, 2)));
+}
+
+std::pair<std::vector<XLATensor>, std::vector<XLATensor>>
+XLATensor::optimizer_update(OptimizerUpdateType update_type, bool nesterov,
+                            bool weight_decay,
+                            absl::Span<const XLATensor> hyperparameters,
+                            absl::Span<const XLATensor> weights,
+                            absl::Span<const XLATensor> grads,
+                            absl::Span<const XLATensor> states) {
+  auto get_values = [](absl::Span<const XLATensor> tensors) {
+    std::vector<ir::Value> values;
+    values.reserve(tensors.size());
+    for (const XLATensor& tensor : tensors) {
+      values.push_back(tensor.GetIrValue());
+    }
+    return values;
+  };
+  ir::NodePtr node = ir::MakeNode<ir::ops::OptimizerUpdate>(
+      update_type, nesterov, weight_decay, get_values(hyperparameters),
+      get_values(weights), get_values(grads), get_values(states));
+  std::vector<XLATensor> steps;
+  steps.reserve(weights.size());
+  for (size_t i = 0; i < weights.size(); ++i) {
+    steps.push_back(weights[i].CreateFrom(ir::Value(node, i)));
+  }
+  std::vector<XLATensor> new_states;
+  new_states.reserve(states.size());
+  for (size_t i = 0; i < states.size(); ++i) {
+    new_states.push_back(
+        states[i].CreateFrom(ir::Value(node, weights.size() + i)));
+  }
+  return {std::move(steps), std::move(new_states)};
+}
+
+XLATensor XLATensor::rng_seeds(const Device& device) {
+  return Create(ir::ops::RngSeedPair(GetRngSeed(device)), device,
+                at::ScalarType::Int);
+}
+
 XLATensor XLATensor::tf_StatelessRandomNormal(absl::Span<const int64_t> size,
                                               const XLATensor& seeds,
                                               const Device& device,
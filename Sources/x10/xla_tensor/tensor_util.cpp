@@ -19,6 +19,13 @@
 #include <list>
 #include <numeric>
 #include <thread>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#include <xmmintrin.h>
+#endif
 
 #include "tensorflow/compiler/xla/xla_client/debug_macros.h"
 #include "tensorflow/compiler/xla/xla_client/multi_wait.h"
@@ -28,6 +35,8 @@
 #include "tensorflow/compiler/xla/xla_client/util.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/helpers.h"
 #include "tensorflow/compiler/tf2xla/xla_tensor/layout_manager.h"
+#include "tensorflow/compiler/tf2xla/xla_tensor/tensor_convert.h"
+#include "tensorflow/compiler/xla/layout_util.h"
 #include "tensorflow/compiler/xla/literal_util.h"
 #include "tensorflow/compiler/xla/shape_util.h"
 #include "tensorflow/core/lib/bfloat16/bfloat16.h"
@@ -35,6 +44,9 @@
 namespace swift_xla {
 namespace {
 
+// The minimum number of elements copy that can be assigned to a thread.
+const int64_t kMinThreadElements = 100000;
+
 bool ShouldUseBF16() {
   bool use_bf16 = xla::sys_util::GetEnvBool("XLA_USE_BF16", false);
   if (use_bf16) {
@@ -201,19 +213,27 @@ struct CopyType<true> {
 template <typename D, typename S>
 void CheckedMemcpy(D* dest, const S* source, int64_t n) {
   static_assert(sizeof(S) == sizeof(D), "Types size mismatch");
-  std::memcpy(dest, source, n * sizeof(S));
+  ParallelMemcpy(dest, source, n * sizeof(S));
 }
 
 template <typename D, typename S>
 void CopyData(D* dest, const S* source, int64_t n, const CopyDirect&) {
-  std::copy(source, source + n, dest);
+  if (std::is_same<D, S>::value) {
+    ParallelMemcpy(dest, source, n * sizeof(S));
+  } else {
+    ParallelForChunks(n, kMinThreadElements, [&](int64_t start, int64_t end) {
+      std::copy(source + start, source + end, dest + start);
+    });
+  }
 }
 
 template <typename D, typename S>
 void CopyData(D* dest, const S* source, int64_t n, const CopyCasted&) {
   // Use strided copy with step 1 since it has the static_cast<> required to
   // convert from/to bfloat16.
-  StridedCopy(dest, 1, source, 1, n);
+  ParallelForChunks(n, kMinThreadElements, [&](int64_t start, int64_t end) {
+    StridedCopy(dest + start, 1, source + start, 1, end - start);
+  });
 }
 
 template <>
@@ -230,6 +250,32 @@ void CopyData<tensorflow::bfloat16, at::BFloat16>(tensorflow::bfloat16* dest,
   CheckedMemcpy<tensorflow::bfloat16, at::BFloat16>(dest, source, n);
 }
 
+// The float <-> reduced precision conversions are the ones hit by every upload
+// and download when XLA_USE_BF16 or XLA_USE_FP16 are set, so they go through
+// the vectorized kernels.
+template <>
+void CopyData<tensorflow::bfloat16, float>(tensorflow::bfloat16* dest,
+                                           const float* source, int64_t n,
+                                           const CopyCasted&) {
+  ConvertFloatToBFloat16(source, dest, n);
+}
+template <>
+void CopyData<float, tensorflow::bfloat16>(float* dest,
+                                           const tensorflow::bfloat16* source,
+                                           int64_t n, const CopyCasted&) {
+  ConvertBFloat16ToFloat(source, dest, n);
+}
+template <>
+void CopyData<xla::half, float>(xla::half* dest, const float* source,
+                                int64_t n, const CopyCasted&) {
+  ConvertFloatToHalf(source, dest, n);
+}
+template <>
+void CopyData<float, xla::half>(float* dest, const xla::half* source,
+                                int64_t n, const CopyCasted&) {
+  ConvertHalfToFloat(source, dest, n);
+}
+
 std::vector<int64_t> GetIterationDimensions(const xla::Shape& shape) {
   // We want to favor the most minor dimension as core iteration dimension, as
   // this walks one of the two tensors buffers in a cache friendly fashion.
@@ -265,8 +311,6 @@ struct CopyPartition {
 std::vector<CopyPartition> CreateCopyPartitions(
     absl::Span<const int64_t> dimensions,
     int64_t strided_copy_dimension) {
-  // The minimum number of elements copy that can be assigned to a thread.
-  static const int64_t kMinThreadElements = 100000;
   // Use at most 50% of the available cores.
   int64_t max_parts =
       std::max<int64_t>(std::thread::hardware_concurrency() / 2, 1);
@@ -324,6 +368,145 @@ void SlicedCopy(absl::Span<const int64_t> dimensions, const SType* src_data,
   }
 }
 
+// Copies an a_size x b_size tile where the source is contiguous along a and
+// the destination along b, i.e. dest[a * dest_stride + b] =
+// src[b * src_stride + a].
+template <typename SType, typename DType>
+void ScalarTileTranspose(const SType* src, int64_t src_stride, DType* dest,
+                         int64_t dest_stride, int64_t a_size, int64_t b_size) {
+  Caster<SType> caster;
+  for (int64_t a = 0; a < a_size; ++a) {
+    const SType* src_column = src + a;
+    DType* dest_row = dest + a * dest_stride;
+    for (int64_t b = 0; b < b_size; ++b) {
+      dest_row[b] = caster.template cast<DType>(src_column[b * src_stride]);
+    }
+  }
+}
+
+template <typename SType, typename DType, typename Enable = void>
+struct TileTranspose {
+  static void Run(const SType* src, int64_t src_stride, DType* dest,
+                  int64_t dest_stride, int64_t a_size, int64_t b_size) {
+    ScalarTileTranspose(src, src_stride, dest, dest_stride, a_size, b_size);
+  }
+};
+
+#if defined(__SSE2__)
+// Same type 4 and 8 bytes tiles are transposed in registers, in 4x4 and 2x2
+// blocks respectively. The shuffles move bits around without interpreting
+// them, so the float loads and stores work for any type of such size.
+template <typename T>
+struct TileTranspose<
+    T, T, typename std::enable_if<sizeof(T) == 4 && !NeedCast<T>::value>::type> {
+  static void Run(const T* src, int64_t src_stride, T* dest,
+                  int64_t dest_stride, int64_t a_size, int64_t b_size) {
+    int64_t a_blocks = a_size & ~int64_t(3);
+    int64_t b_blocks = b_size & ~int64_t(3);
+    for (int64_t a = 0; a < a_blocks; a += 4) {
+      for (int64_t b = 0; b < b_blocks; b += 4) {
+        const float* s = reinterpret_cast<const float*>(src + b * src_stride + a);
+        __m128 r0 = _mm_loadu_ps(s);
+        __m128 r1 = _mm_loadu_ps(s + src_stride);
+        __m128 r2 = _mm_loadu_ps(s + 2 * src_stride);
+        __m128 r3 = _mm_loadu_ps(s + 3 * src_stride);
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+        float* d = reinterpret_cast<float*>(dest + a * dest_stride + b);
+        _mm_storeu_ps(d, r0);
+        _mm_storeu_ps(d + dest_stride, r1);
+        _mm_storeu_ps(d + 2 * dest_stride, r2);
+        _mm_storeu_ps(d + 3 * dest_stride, r3);
+      }
+    }
+    ScalarTileTranspose(src + b_blocks * src_stride, src_stride,
+                        dest + b_blocks, dest_stride, a_blocks,
+                        b_size - b_blocks);
+    ScalarTileTranspose(src + a_blocks, src_stride,
+                        dest + a_blocks * dest_stride, dest_stride,
+                        a_size - a_blocks, b_size);
+  }
+};
+
+template <typename T>
+struct TileTranspose<
+    T, T, typename std::enable_if<sizeof(T) == 8 && !NeedCast<T>::value>::type> {
+  static void Run(const T* src, int64_t src_stride, T* dest,
+                  int64_t dest_stride, int64_t a_size, int64_t b_size) {
+    int64_t a_blocks = a_size & ~int64_t(1);
+    int64_t b_blocks = b_size & ~int64_t(1);
+    for (int64_t a = 0; a < a_blocks; a += 2) {
+      for (int64_t b = 0; b < b_blocks; b += 2) {
+        const double* s =
+            reinterpret_cast<const double*>(src + b * src_stride + a);
+        __m128d r0 = _mm_loadu_pd(s);
+        __m128d r1 = _mm_loadu_pd(s + src_stride);
+        double* d = reinterpret_cast<double*>(dest + a * dest_stride + b);
+        _mm_storeu_pd(d, _mm_unpacklo_pd(r0, r1));
+        _mm_storeu_pd(d + dest_stride, _mm_unpackhi_pd(r0, r1));
+      }
+    }
+    ScalarTileTranspose(src + b_blocks * src_stride, src_stride,
+                        dest + b_blocks, dest_stride, a_blocks,
+                        b_size - b_blocks);
+    ScalarTileTranspose(src + a_blocks, src_stride,
+                        dest + a_blocks * dest_stride, dest_stride,
+                        a_size - a_blocks, b_size);
+  }
+};
+#endif
+
+// Copies between two layouts with different most minor dimensions. The plane
+// made of the two minor dimensions is walked in square tiles, so that both the
+// source reads and the destination writes stay within a few cache lines, and
+// tiles are spread over the thread pool.
+template <typename SType, typename DType>
+void TiledCopy(absl::Span<const int64_t> dimensions, const SType* src_data,
+               absl::Span<const int64_t> src_strides, DType* dest_data,
+               absl::Span<const int64_t> dest_strides, int64_t src_minor,
+               int64_t dest_minor) {
+  // With at most 8 bytes elements, a source and a destination tile take 16KB.
+  static const int64_t kTileSize = 32;
+  std::vector<int64_t> outer_dims;
+  int64_t outer_count = 1;
+  for (int64_t dim = 0; dim < dimensions.size(); ++dim) {
+    if (dim != src_minor && dim != dest_minor) {
+      outer_dims.push_back(dim);
+      outer_count *= dimensions[dim];
+    }
+  }
+  int64_t a_dim_size = dimensions[src_minor];
+  int64_t b_dim_size = dimensions[dest_minor];
+  int64_t a_tiles = (a_dim_size + kTileSize - 1) / kTileSize;
+  int64_t b_tiles = (b_dim_size + kTileSize - 1) / kTileSize;
+  int64_t src_b_stride = src_strides[dest_minor];
+  int64_t dest_a_stride = dest_strides[src_minor];
+  auto copy_fn = [&](int64_t start, int64_t end) {
+    for (int64_t tile = start; tile < end; ++tile) {
+      int64_t index = tile;
+      int64_t b_base = (index % b_tiles) * kTileSize;
+      index /= b_tiles;
+      int64_t a_base = (index % a_tiles) * kTileSize;
+      index /= a_tiles;
+      int64_t src_offset = a_base + b_base * src_b_stride;
+      int64_t dest_offset = b_base + a_base * dest_a_stride;
+      for (auto it = outer_dims.rbegin(); it != outer_dims.rend(); ++it) {
+        int64_t dim_index = index % dimensions[*it];
+        index /= dimensions[*it];
+        src_offset += dim_index * src_strides[*it];
+        dest_offset += dim_index * dest_strides[*it];
+      }
+      TileTranspose<SType, DType>::Run(
+          src_data + src_offset, src_b_stride, dest_data + dest_offset,
+          dest_a_stride, std::min(kTileSize, a_dim_size - a_base),
+          std::min(kTileSize, b_dim_size - b_base));
+    }
+  };
+  ParallelForChunks(
+      outer_count * a_tiles * b_tiles,
+      std::max<int64_t>(kMinThreadElements / (kTileSize * kTileSize), 1),
+      copy_fn);
+}
+
 template <typename SType, typename DType>
 void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
                  void* dest_buffer, size_t dest_buffer_size,
@@ -341,6 +524,14 @@ void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
     CopyData<DType, SType>(dest_data, src_data, total_elements,
                            typename CopyType < NeedCast<SType>::value ||
                                NeedCast<DType>::value > ::type());
+  } else if (total_elements > 0 && src_shape.layout().minor_to_major(0) !=
+                                        dest_shape.layout().minor_to_major(0)) {
+    std::vector<int64_t> src_strides = ComputeShapeStrides(src_shape);
+    std::vector<int64_t> dest_strides = ComputeShapeStrides(dest_shape);
+    TiledCopy<SType, DType>(dest_shape.dimensions(), src_data, src_strides,
+                            dest_data, dest_strides,
+                            src_shape.layout().minor_to_major(0),
+                            dest_shape.layout().minor_to_major(0));
   } else if (total_elements > 0) {
     // We issue a multi-threaded copy by slicing the bigger dimension and
     // assigning its copy to different threads. This code is only valid for
@@ -362,73 +553,90 @@ void CopyTensors(const void* src_buffer, const xla::Shape& src_shape,
   }
 }
 
+// A range of tensor elements, in the default (dim0-major) layout.
+struct ElementRange {
+  int64_t start = 0;
+  int64_t count = 0;
+};
+
 template <typename SType, typename DType>
 void TensorToBuffer(const at::Tensor& tensor, const xla::Shape& dest_shape,
                     void* dest_buffer, size_t dest_buffer_size,
-                    const Device& device) {
+                    const Device& device, const ElementRange* range) {
+  if (range != nullptr) {
+    // Ranges are only requested when the destination has the default layout,
+    // so the elements map one to one.
+    XLA_CHECK_EQ(dest_buffer_size, range->count * sizeof(DType));
+    CopyData<DType, SType>(reinterpret_cast<DType*>(dest_buffer),
+                           tensor.data_ptr<SType>() + range->start,
+                           range->count,
+                           typename CopyType < NeedCast<SType>::value ||
+                               NeedCast<DType>::value > ::type());
+    return;
+  }
   xla::Shape src_shape = MakeSwiftTensorLayout(
       XlaHelpers::I64List(tensor.shape()), /*dynamic_dimensions=*/{},
       XlaTypeFromTensorType(tensor.scalar_type(), device));
-  CopyTensors<SType, DType>(tensor.data<SType>().data(), src_shape, dest_buffer,
+  CopyTensors<SType, DType>(tensor.data_ptr<SType>(), src_shape, dest_buffer,
                             dest_buffer_size, dest_shape);
 }
 
 template <typename SType>
 void TensorToBufferSType(const at::Tensor& tensor, const xla::Shape& dest_shape,
                          void* dest_buffer, size_t dest_buffer_size,
-                         const Device& device) {
+                         const Device& device, const ElementRange* range) {
   switch (dest_shape.element_type()) {
     case xla::PrimitiveType::BF16:
       TensorToBuffer<SType, tensorflow::bfloat16>(
-          tensor, dest_shape, dest_buffer, dest_buffer_size, device);
+          tensor, dest_shape, dest_buffer, dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::F16:
       TensorToBuffer<SType, xla::half>(tensor, dest_shape, dest_buffer,
-                                       dest_buffer_size, device);
+                                       dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::F32:
       TensorToBuffer<SType, float>(tensor, dest_shape, dest_buffer,
-                                   dest_buffer_size, device);
+                                   dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::F64:
       TensorToBuffer<SType, double>(tensor, dest_shape, dest_buffer,
-                                    dest_buffer_size, device);
+                                    dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::PRED:
       TensorToBuffer<SType, bool>(tensor, dest_shape, dest_buffer,
-                                  dest_buffer_size, device);
+                                  dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::U8:
       TensorToBuffer<SType, xla::uint8>(tensor, dest_shape, dest_buffer,
-                                        dest_buffer_size, device);
+                                        dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::S8:
       TensorToBuffer<SType, xla::int8>(tensor, dest_shape, dest_buffer,
-                                       dest_buffer_size, device);
+                                       dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::S16:
       TensorToBuffer<SType, xla::int16>(tensor, dest_shape, dest_buffer,
-                                        dest_buffer_size, device);
+                                        dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::U16:
       TensorToBuffer<SType, xla::uint16>(tensor, dest_shape, dest_buffer,
-                                         dest_buffer_size, device);
+                                         dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::S32:
       TensorToBuffer<SType, xla::int32>(tensor, dest_shape, dest_buffer,
-                                        dest_buffer_size, device);
+                                        dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::U32:
       TensorToBuffer<SType, xla::uint32>(tensor, dest_shape, dest_buffer,
-                                         dest_buffer_size, device);
+                                         dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::S64:
       TensorToBuffer<SType, int64_t>(tensor, dest_shape, dest_buffer,
-                                        dest_buffer_size, device);
+                                        dest_buffer_size, device, range);
       break;
     case xla::PrimitiveType::U64:
       TensorToBuffer<SType, xla::uint64>(tensor, dest_shape, dest_buffer,
-                                         dest_buffer_size, device);
+                                         dest_buffer_size, device, range);
       break;
     default:
       XLA_ERROR() << "Destination shape type not supported: " << dest_shape;
@@ -437,100 +645,229 @@ void TensorToBufferSType(const at::Tensor& tensor, const xla::Shape& dest_shape,
 
 void PopulateTensorBuffer(const at::Tensor& tensor,
                           const xla::Shape& dest_shape, void* dest_buffer,
-                          size_t dest_buffer_size, const Device& device) {
+                          size_t dest_buffer_size, const Device& device,
+                          const ElementRange* range = nullptr) {
   switch (tensor.scalar_type()) {
     case at::ScalarType::Double:
       TensorToBufferSType<double>(tensor, dest_shape, dest_buffer,
-                                  dest_buffer_size, device);
+                                  dest_buffer_size, device, range);
       break;
     case at::ScalarType::Float:
       TensorToBufferSType<float>(tensor, dest_shape, dest_buffer,
-                                 dest_buffer_size, device);
+                                 dest_buffer_size, device, range);
       break;
     case at::ScalarType::BFloat16:
       TensorToBufferSType<at::BFloat16>(tensor, dest_shape, dest_buffer,
-                                        dest_buffer_size, device);
+                                        dest_buffer_size, device, range);
       break;
     case at::ScalarType::Half:
       TensorToBufferSType<at::Half>(tensor, dest_shape, dest_buffer,
-                                    dest_buffer_size, device);
+                                    dest_buffer_size, device, range);
       break;
     case at::ScalarType::Bool:
       TensorToBufferSType<bool>(tensor, dest_shape, dest_buffer,
-                                dest_buffer_size, device);
+                                dest_buffer_size, device, range);
       break;
     case at::ScalarType::Byte:
       TensorToBufferSType<uint8_t>(tensor, dest_shape, dest_buffer,
-                                   dest_buffer_size, device);
+                                   dest_buffer_size, device, range);
       break;
     case at::ScalarType::Char:
       TensorToBufferSType<int8_t>(tensor, dest_shape, dest_buffer,
-                                  dest_buffer_size, device);
+                                  dest_buffer_size, device, range);
       break;
     case at::ScalarType::Short:
       TensorToBufferSType<int16_t>(tensor, dest_shape, dest_buffer,
-                                   dest_buffer_size, device);
+                                   dest_buffer_size, device, range);
       break;
     case at::ScalarType::Int:
       TensorToBufferSType<int32_t>(tensor, dest_shape, dest_buffer,
-                                   dest_buffer_size, device);
+                                   dest_buffer_size, device, range);
       break;
     case at::ScalarType::Long:
       TensorToBufferSType<int64_t>(tensor, dest_shape, dest_buffer,
-                                   dest_buffer_size, device);
+                                   dest_buffer_size, device, range);
       break;
     default:
       XLA_ERROR() << "Tensor type not supported: " << tensor.scalar_type();
   }
 }
 
+// Creates the source for uploading tensor as shape. The tensor must outlive
+// the returned source.
+xla::ComputationClient::TensorSource MakeTensorSource(const at::Tensor& tensor,
+                                                      xla::Shape shape,
+                                                      const Device& device) {
+  auto populate_fn =
+      [&tensor, &device](
+          const xla::ComputationClient::TensorSource& source_tensor,
+          void* dest_buffer, size_t dest_buffer_size) {
+        PopulateTensorBuffer(tensor, source_tensor.shape, dest_buffer,
+                             dest_buffer_size, device);
+      };
+  xla::ComputationClient::TensorSource::PopulateRangeFn populate_range_fn;
+  if (shape.IsArray() &&
+      xla::LayoutUtil::IsMonotonicWithDim0Major(shape.layout())) {
+    // With the default layout the destination elements are in the same order
+    // as the tensor ones, so any element aligned byte range can be converted
+    // on its own.
+    populate_range_fn =
+        [&tensor, &device](
+            const xla::ComputationClient::TensorSource& source_tensor,
+            size_t offset, void* dest_buffer, size_t dest_buffer_size) {
+          int64_t element_size = xla::ShapeUtil::ByteSizeOfPrimitiveType(
+              source_tensor.shape.element_type());
+          ElementRange range;
+          range.start = offset / element_size;
+          range.count = dest_buffer_size / element_size;
+          PopulateTensorBuffer(tensor, source_tensor.shape, dest_buffer,
+                               dest_buffer_size, device, &range);
+        };
+  }
+  return xla::ComputationClient::TensorSource(std::move(shape),
+                                              std::move(populate_fn),
+                                              std::move(populate_range_fn));
+}
+
 template <typename SType, typename DType>
-at::Tensor XlaLiteralToTensor(const xla::Literal& literal,
-                              at::ScalarType atype) {
-  std::vector<int64_t> dimensions =
-      xla::util::ToVector<int64_t>(literal.shape().dimensions());
+void XlaLiteralToBuffer(const xla::Literal& literal, void* dest_buffer,
+                        size_t dest_buffer_size) {
   xla::Shape swift_shape = MakeSwiftTensorLayout(
       literal.shape().dimensions(), /*dynamic_dimensions=*/{},
       literal.shape().element_type());
-  int64_t total_elements = xla::ShapeUtil::ElementsIn(swift_shape);
-
   const auto literal_data = literal.data<SType>();
-  std::unique_ptr<DType[]> data(new DType[total_elements]);
-  CopyTensors<SType, DType>(literal_data.data(), literal.shape(), data.get(),
-                            total_elements * sizeof(DType), swift_shape);
-  return at::Tensor(std::move(data), std::move(dimensions));
+  CopyTensors<SType, DType>(literal_data.data(), literal.shape(), dest_buffer,
+                            dest_buffer_size, swift_shape);
 }
 
 template <typename SType>
-at::Tensor XlaLiteralToTensorHelper(const xla::Literal& literal,
-                                    at::ScalarType dest_element_type) {
+void XlaLiteralToBufferHelper(const xla::Literal& literal,
+                              at::ScalarType dest_element_type,
+                              void* dest_buffer, size_t dest_buffer_size) {
   switch (dest_element_type) {
     case at::ScalarType::Bool:
-      return XlaLiteralToTensor<SType, bool>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, bool>(literal, dest_buffer,
+                                             dest_buffer_size);
     case at::ScalarType::Byte:
-      return XlaLiteralToTensor<SType, uint8_t>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, uint8_t>(literal, dest_buffer,
+                                                dest_buffer_size);
     case at::ScalarType::Char:
-      return XlaLiteralToTensor<SType, int8_t>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, int8_t>(literal, dest_buffer,
+                                               dest_buffer_size);
     case at::ScalarType::Short:
-      return XlaLiteralToTensor<SType, int16_t>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, int16_t>(literal, dest_buffer,
+                                                dest_buffer_size);
     case at::ScalarType::Int:
-      return XlaLiteralToTensor<SType, int32_t>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, int32_t>(literal, dest_buffer,
+                                                dest_buffer_size);
     case at::ScalarType::Long:
-      return XlaLiteralToTensor<SType, int64_t>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, int64_t>(literal, dest_buffer,
+                                                dest_buffer_size);
     case at::ScalarType::Float:
-      return XlaLiteralToTensor<SType, float>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, float>(literal, dest_buffer,
+                                              dest_buffer_size);
     case at::ScalarType::Double:
-      return XlaLiteralToTensor<SType, double>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, double>(literal, dest_buffer,
+                                               dest_buffer_size);
     case at::ScalarType::BFloat16:
-      return XlaLiteralToTensor<SType, at::BFloat16>(literal,
-                                                     dest_element_type);
+      return XlaLiteralToBuffer<SType, at::BFloat16>(literal, dest_buffer,
+                                                     dest_buffer_size);
     case at::ScalarType::Half:
-      return XlaLiteralToTensor<SType, at::Half>(literal, dest_element_type);
+      return XlaLiteralToBuffer<SType, at::Half>(literal, dest_buffer,
+                                                 dest_buffer_size);
     default:
       XLA_ERROR() << "Unsupported scalar type: " << dest_element_type;
   }
 }
 
+// Converts the literal into a dense buffer with the default tensor layout,
+// holding values of dest_element_type type.
+void PopulateBufferFromLiteral(const xla::Literal& literal,
+                               at::ScalarType dest_element_type,
+                               void* dest_buffer, size_t dest_buffer_size) {
+  switch (literal.shape().element_type()) {
+    case xla::PrimitiveType::PRED:
+      return XlaLiteralToBufferHelper<bool>(literal, dest_element_type,
+                                            dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::BF16:
+      return XlaLiteralToBufferHelper<tensorflow::bfloat16>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::F16:
+      return XlaLiteralToBufferHelper<xla::half>(literal, dest_element_type,
+                                                 dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::F32:
+      return XlaLiteralToBufferHelper<float>(literal, dest_element_type,
+                                             dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::F64:
+      return XlaLiteralToBufferHelper<double>(literal, dest_element_type,
+                                              dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::U8:
+      return XlaLiteralToBufferHelper<xla::uint8>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::S8:
+      return XlaLiteralToBufferHelper<xla::int8>(literal, dest_element_type,
+                                                 dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::S16:
+      return XlaLiteralToBufferHelper<xla::int16>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::U16:
+      return XlaLiteralToBufferHelper<xla::uint16>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::S32:
+      return XlaLiteralToBufferHelper<xla::int32>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::U32:
+      return XlaLiteralToBufferHelper<xla::uint32>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::S64:
+      return XlaLiteralToBufferHelper<int64_t>(literal, dest_element_type,
+                                               dest_buffer, dest_buffer_size);
+    case xla::PrimitiveType::U64:
+      return XlaLiteralToBufferHelper<xla::uint64>(
+          literal, dest_element_type, dest_buffer, dest_buffer_size);
+    default:
+      XLA_ERROR() << "Unsupported literal type: " << literal.shape();
+  }
+}
+
+template <typename T>
+std::pair<at::Tensor, void*> AllocateTypedTensor(
+    std::vector<int64_t> dimensions) {
+  std::unique_ptr<T[]> data(new T[xla::util::Multiply<int64_t>(dimensions)]);
+  void* buffer = data.get();
+  return {at::Tensor(std::move(data), std::move(dimensions)), buffer};
+}
+
+// Allocates an uninitialized host tensor, and returns it together with a
+// pointer to its (writable) data.
+std::pair<at::Tensor, void*> AllocateTensor(at::ScalarType element_type,
+                                            std::vector<int64_t> dimensions) {
+  switch (element_type) {
+    case at::ScalarType::Bool:
+      return AllocateTypedTensor<bool>(std::move(dimensions));
+    case at::ScalarType::Byte:
+      return AllocateTypedTensor<uint8_t>(std::move(dimensions));
+    case at::ScalarType::Char:
+      return AllocateTypedTensor<int8_t>(std::move(dimensions));
+    case at::ScalarType::Short:
+      return AllocateTypedTensor<int16_t>(std::move(dimensions));
+    case at::ScalarType::Int:
+      return AllocateTypedTensor<int32_t>(std::move(dimensions));
+    case at::ScalarType::Long:
+      return AllocateTypedTensor<int64_t>(std::move(dimensions));
+    case at::ScalarType::Float:
+      return AllocateTypedTensor<float>(std::move(dimensions));
+    case at::ScalarType::Double:
+      return AllocateTypedTensor<double>(std::move(dimensions));
+    case at::ScalarType::BFloat16:
+      return AllocateTypedTensor<at::BFloat16>(std::move(dimensions));
+    case at::ScalarType::Half:
+      return AllocateTypedTensor<at::Half>(std::move(dimensions));
+    default:
+      XLA_ERROR() << "Unsupported scalar type: " << element_type;
+  }
+}
+
 }  // namespace
 
 std::vector<int64_t> ComputeShapeStrides(const xla::Shape& shape) {
@@ -554,53 +891,37 @@ std::vector<int64_t> ComputeArrayStrides(
 
 at::Tensor MakeTensorFromXlaLiteral(const xla::Literal& literal,
                                     at::ScalarType dest_element_type) {
-  switch (literal.shape().element_type()) {
-    case xla::PrimitiveType::PRED:
-      return XlaLiteralToTensorHelper<bool>(literal, dest_element_type);
-    case xla::PrimitiveType::BF16:
-      return XlaLiteralToTensorHelper<tensorflow::bfloat16>(literal,
-                                                            dest_element_type);
-    case xla::PrimitiveType::F16:
-      return XlaLiteralToTensorHelper<xla::half>(literal, dest_element_type);
-    case xla::PrimitiveType::F32:
-      return XlaLiteralToTensorHelper<float>(literal, dest_element_type);
-    case xla::PrimitiveType::F64:
-      return XlaLiteralToTensorHelper<double>(literal, dest_element_type);
-    case xla::PrimitiveType::U8:
-      return XlaLiteralToTensorHelper<xla::uint8>(literal, dest_element_type);
-    case xla::PrimitiveType::S8:
-      return XlaLiteralToTensorHelper<xla::int8>(literal, dest_element_type);
-    case xla::PrimitiveType::S16:
-      return XlaLiteralToTensorHelper<xla::int16>(literal, dest_element_type);
-    case xla::PrimitiveType::U16:
-      return XlaLiteralToTensorHelper<xla::uint16>(literal, dest_element_type);
-    case xla::PrimitiveType::S32:
-      return XlaLiteralToTensorHelper<xla::int32>(literal, dest_element_type);
-    case xla::PrimitiveType::U32:
-      return XlaLiteralToTensorHelper<xla::uint32>(literal, dest_element_type);
-    case xla::PrimitiveType::S64:
-      return XlaLiteralToTensorHelper<int64_t>(literal, dest_element_type);
-    case xla::PrimitiveType::U64:
-      return XlaLiteralToTensorHelper<xla::uint64>(literal, dest_element_type);
-    default:
-      XLA_ERROR() << "Unsupported literal type: " << literal.shape();
-  }
+  auto tensor_and_buffer = AllocateTensor(
+      dest_element_type,
+      xla::util::ToVector<int64_t>(literal.shape().dimensions()));
+  PopulateBufferFromLiteral(literal, dest_element_type,
+                            tensor_and_buffer.second,
+                            tensor_and_buffer.first.buffer().raw_size());
+  return std::move(tensor_and_buffer.first);
 }
 
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
                                                 const xla::Shape& shape,
                                                 const Device& device) {
-  auto populate_fn =
-      [&](const xla::ComputationClient::TensorSource& source_tensor,
-          void* dest_buffer, size_t dest_buffer_size) {
-        PopulateTensorBuffer(tensor, source_tensor.shape, dest_buffer,
-                             dest_buffer_size, device);
-      };
+  xla::ComputationClient::Device* x10_device = xla::GetX10Device(device);
+  if (x10_device->IsLocal() && tensor.raw_data() != nullptr) {
+    // Local devices can read straight out of the host tensor memory, when that
+    // already has the device type and layout.
+    xla::Shape host_shape = MakeSwiftTensorLayout(
+        XlaHelpers::I64List(tensor.shape()), /*dynamic_dimensions=*/{},
+        TensorTypeToRawXlaType(tensor.scalar_type()));
+    if (xla::ShapeUtil::Equal(host_shape, shape)) {
+      xla::BorrowingLiteral literal(
+          reinterpret_cast<const char*>(tensor.raw_data()),
+          host_shape);
+      return x10_device->TransferToServer(std::move(literal), shape);
+    }
+  }
 
   std::vector<xla::ComputationClient::TensorSource> source_tensors;
-  source_tensors.emplace_back(shape, std::move(populate_fn));
+  source_tensors.push_back(MakeTensorSource(tensor, shape, device));
 
-  auto handles = xla::GetX10Device(device)->TransferToServer(source_tensors);
+  auto handles = x10_device->TransferToServer(source_tensors);
   XLA_CHECK_EQ(handles.size(), 1);
   return std::move(handles.front());
 }
@@ -617,13 +938,8 @@ std::vector<xla::ComputationClient::DataPtr> CreateTensorsData(
   Device device_id(device);
   for (size_t i = 0; i < tensors.size(); ++i) {
     xla::Shape shape = CreateComputationShapeFromTensor(tensors[i], &device_id);
-    auto populate_fn =
-        [&, i](const xla::ComputationClient::TensorSource& source_tensor,
-               void* dest_buffer, size_t dest_buffer_size) {
-          PopulateTensorBuffer(tensors[i], source_tensor.shape, dest_buffer,
-                               dest_buffer_size, device_id);
-        };
-    source_tensors.emplace_back(std::move(shape), std::move(populate_fn));
+    source_tensors.push_back(
+        MakeTensorSource(tensors[i], std::move(shape), device_id));
   }
   return xla::GetX10Device(device)->TransferToServer(source_tensors);
 }
@@ -648,45 +964,98 @@ xla::Literal GetTensorLiteral(const at::Tensor& tensor, const xla::Shape* shape,
 std::vector<at::Tensor> XlaDataToTensors(
     absl::Span<const xla::ComputationClient::DataPtr> xla_data,
     at::ScalarType dest_element_type) {
-  std::vector<xla::Literal> literals =
-      xla::ComputationClient::TransferFromServer(xla_data);
+  std::vector<at::ScalarType> dest_element_types(xla_data.size(),
+                                                 dest_element_type);
+  return XlaDataToTensors(xla_data, dest_element_types);
+}
+
+std::vector<at::Tensor> XlaDataToTensors(
+    absl::Span<const xla::ComputationClient::DataPtr> xla_data,
+    absl::Span<const at::ScalarType> dest_element_types) {
+  XLA_CHECK_EQ(xla_data.size(), dest_element_types.size());
   std::vector<at::Tensor> tensors;
-  tensors.reserve(literals.size());
-  for (auto& literal : literals) {
-    tensors.push_back(MakeTensorFromXlaLiteral(literal, dest_element_type));
+  std::vector<void*> buffers;
+  std::vector<size_t> buffer_sizes;
+  tensors.reserve(xla_data.size());
+  for (size_t i = 0; i < xla_data.size(); ++i) {
+    auto tensor_and_buffer = AllocateTensor(
+        dest_element_types[i],
+        xla::util::ToVector<int64_t>(xla_data[i]->shape().dimensions()));
+    buffers.push_back(tensor_and_buffer.second);
+    buffer_sizes.push_back(tensor_and_buffer.first.buffer().raw_size());
+    tensors.push_back(std::move(tensor_and_buffer.first));
   }
+  XlaDataToBuffers(xla_data, dest_element_types, buffers, buffer_sizes);
   return tensors;
 }
 
-xla::hash_t TensorHash(const at::Tensor& tensor) {
-  int64_t size =
-      tensor.buffer().size() * at::internal::GetSizeof(tensor.scalar_type());
-  switch (tensor.scalar_type()) {
-    case at::ScalarType::Bool:
-      return xla::util::DataHash(tensor.data<bool>().data(), size);
-    case at::ScalarType::Byte:
-      return xla::util::DataHash(tensor.data<uint8_t>().data(), size);
-    case at::ScalarType::Char:
-      return xla::util::DataHash(tensor.data<int8_t>().data(), size);
-    case at::ScalarType::Short:
-      return xla::util::DataHash(tensor.data<int16_t>().data(), size);
-    case at::ScalarType::Int:
-      return xla::util::DataHash(tensor.data<int32_t>().data(), size);
-    case at::ScalarType::Long:
-      return xla::util::DataHash(tensor.data<int64_t>().data(), size);
-    case at::ScalarType::Float:
-      return xla::util::DataHash(tensor.data<float>().data(), size);
-    case at::ScalarType::Double:
-      return xla::util::DataHash(tensor.data<double>().data(), size);
-    case at::ScalarType::BFloat16:
-      return xla::util::DataHash(tensor.data<at::BFloat16>().data(), size);
-    case at::ScalarType::Half:
-      return xla::util::DataHash(tensor.data<at::Half>().data(), size);
-    default:
-      XLA_ERROR() << "Unsupported scalar type: " << tensor.scalar_type();
+void XlaDataToBuffers(
+    absl::Span<const xla::ComputationClient::DataPtr> xla_data,
+    absl::Span<const at::ScalarType> dest_element_types,
+    absl::Span<void* const> dest_buffers,
+    absl::Span<const size_t> dest_buffer_sizes) {
+  // Device data which already has the destination type and layout is written
+  // straight into the destination buffers. The rest goes through a literal,
+  // and gets converted while copying it over.
+  std::vector<xla::ComputationClient::DataPtr> direct_data;
+  std::vector<xla::MutableBorrowingLiteral> direct_literals;
+  std::vector<xla::ComputationClient::DataPtr> converted_data;
+  std::vector<size_t> converted_indices;
+  for (size_t i = 0; i < xla_data.size(); ++i) {
+    const xla::Shape& shape = xla_data[i]->shape();
+    xla::Shape dest_shape =
+        MakeSwiftTensorLayout(shape.dimensions(), /*dynamic_dimensions=*/{},
+                              TensorTypeToRawXlaType(dest_element_types[i]));
+    XLA_CHECK_EQ(xla::ShapeUtil::ByteSizeOf(dest_shape), dest_buffer_sizes[i])
+        << dest_shape;
+    if (xla::ShapeUtil::Equal(dest_shape, shape)) {
+      direct_data.push_back(xla_data[i]);
+      direct_literals.emplace_back(static_cast<char*>(dest_buffers[i]),
+                                   dest_shape);
+    } else {
+      converted_data.push_back(xla_data[i]);
+      converted_indices.push_back(i);
+    }
+  }
+  xla::ComputationClient::TransferFromServerInto(direct_data, direct_literals);
+  std::vector<xla::Literal> literals =
+      xla::ComputationClient::TransferFromServer(converted_data);
+  for (size_t i = 0; i < literals.size(); ++i) {
+    size_t index = converted_indices[i];
+    PopulateBufferFromLiteral(literals[i], dest_element_types[index],
+                              dest_buffers[index], dest_buffer_sizes[index]);
   }
 }
 
+xla::hash_t DataTreeHash(const void* data, size_t size) {
+  // The leaves are fixed size, so the result does not depend on how many
+  // threads hash them.
+  static const size_t kHashLeafSize = 64 * 1024;
+  static const int64_t kMinHashLeavesPerChunk = 16;
+  static const xla::hash_t kHashSeed = 0x85ebca77c2b2ae63;
+  if (size <= kHashLeafSize) {
+    return xla::util::StripeHash(data, size, kHashSeed);
+  }
+  const char* bytes = reinterpret_cast<const char*>(data);
+  int64_t num_leaves = (size + kHashLeafSize - 1) / kHashLeafSize;
+  std::vector<xla::hash_t> leaf_hashes(num_leaves);
+  ParallelForChunks(
+      num_leaves, kMinHashLeavesPerChunk, [&](int64_t start, int64_t end) {
+        for (int64_t i = start; i < end; ++i) {
+          size_t offset = i * kHashLeafSize;
+          leaf_hashes[i] = xla::util::StripeHash(
+              bytes + offset, std::min(kHashLeafSize, size - offset),
+              kHashSeed);
+        }
+      });
+  return xla::util::StripeHash(leaf_hashes.data(),
+                               leaf_hashes.size() * sizeof(xla::hash_t), size);
+}
+
+xla::hash_t TensorHash(const at::Tensor& tensor) {
+  return DataTreeHash(tensor.raw_data(), tensor.nbytes());
+}
+
 std::vector<xla::Shape> GetComponentShapes(const xla::Shape& shape) {
   std::vector<xla::Shape> component_shapes;
   if (shape.IsTuple()) {
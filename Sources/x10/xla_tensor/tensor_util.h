@@ -41,6 +41,21 @@ std::vector<at::Tensor> XlaDataToTensors(
     absl::Span<const xla::ComputationClient::DataPtr> xla_data,
     at::ScalarType dest_element_type);
 
+// Same as above, with a destination element type per device data.
+std::vector<at::Tensor> XlaDataToTensors(
+    absl::Span<const xla::ComputationClient::DataPtr> xla_data,
+    absl::Span<const at::ScalarType> dest_element_types);
+
+// Downloads the device data into the given host buffers, which hold values of
+// the dest_element_types types, in the default tensor layout. Device data
+// already matching the destination type and layout is transferred without any
+// intermediate host copy.
+void XlaDataToBuffers(
+    absl::Span<const xla::ComputationClient::DataPtr> xla_data,
+    absl::Span<const at::ScalarType> dest_element_types,
+    absl::Span<void* const> dest_buffers,
+    absl::Span<const size_t> dest_buffer_sizes);
+
 // Uploads an ATEN tensor data to the device and fetches the corresponding
 // device data handle.
 xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
@@ -54,6 +69,10 @@ xla::ComputationClient::DataPtr TensorToXlaData(const at::Tensor& tensor,
 xla::ComputationClient::TensorSource TensorToTensorSource(
     const at::Tensor& tensor, const Device& device);
 
+// Hashes the data as a tree of fixed size blocks, which are hashed in
+// parallel. The result does not depend on the number of threads.
+xla::hash_t DataTreeHash(const void* data, size_t size);
+
 xla::hash_t TensorHash(const at::Tensor& tensor);
 
 // Retrieves the device data handles by parallel uploading data onto the
@@ -2543,6 +2543,31 @@ final class TensorTests: XCTestCase {
     }
   }
 
+  func testOptimizerUpdate() throws {
+    let weights = [[3, 2], [4], [2, 2, 2]].map { Tensor<Float>.rand($0) }
+    let grads = weights.map { Tensor<Float>.rand($0.shape.dimensions) }
+    let moments = weights.map { Tensor<Float>.rand($0.shape.dimensions) }
+    let (lr, beta1, beta2, wd, epsilon): (Float, Float, Float, Float, Float) = (
+      0.1, 0.9, 0.999, 0.01, 1e-6
+    )
+    let result = _Raw.optimizerUpdate(
+      .adam, weightDecay: true,
+      hyperparameters: [lr, beta1, beta2, wd, epsilon].map { Tensor<Float>($0, on: x10) },
+      weights: weights, grads: grads, states: moments + moments)
+    XCTAssertEqual(result.steps.count, weights.count)
+    XCTAssertEqual(result.states.count, 2 * weights.count)
+    for i in weights.indices {
+      let (w, g, m) = (TF(weights[i]), TF(grads[i]), TF(moments[i]))
+      let firstMoment = beta1 * m + g * (1 - beta1)
+      let secondMoment = beta2 * m + g * g * (1 - beta2)
+      let step = -lr * (firstMoment / (sqrt(secondMoment) + epsilon) + w * wd)
+      XCTAssert(allClose(actual: TF(result.steps[i]), expected: step, relTolerance: 1e-4))
+      XCTAssert(allClose(actual: TF(result.states[i]), expected: firstMoment))
+      XCTAssert(
+        allClose(actual: TF(result.states[weights.count + i]), expected: secondMoment))
+    }
+  }
+
   func testPack() throws {
     for useReducedPrecision in [false, true] {
       for dim in 0..<3 {
@@ -3670,6 +3695,7 @@ extension TensorTests {
     ("testNotEqual", testNotEqual),
     ("testOneHot", testOneHot),
     ("testOnesLike", testOnesLike),
+    ("testOptimizerUpdate", testOptimizerUpdate),
     ("testPack", testPack),
     ("testPadV1", testPadV1),
     ("testPadWithConstant", testPadWithConstant),
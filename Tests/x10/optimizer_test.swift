@@ -0,0 +1,209 @@
+// Copyright 2020 TensorFlow Authors
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//      http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+import TensorFlow
+import XCTest
+import x10_optimizers_optimizer
+import x10_optimizers_tensor_visitor_plan
+
+struct TinyModel: Layer {
+  var hidden = Dense<Float>(inputSize: 4, outputSize: 3, activation: relu)
+  var output = Dense<Float>(inputSize: 3, outputSize: 2)
+
+  @differentiable(reverse)
+  func callAsFunction(_ input: Tensor<Float>) -> Tensor<Float> {
+    return output(hidden(input))
+  }
+}
+
+final class OptimizerTests: XCTestCase {
+  let device = Device.defaultXLA
+  let initialModel = TinyModel()
+
+  var input: Tensor<Float> {
+    Tensor<Float>(shape: [5, 4], scalars: (0..<20).map { Float($0) / 10 - 1 }, on: device)
+  }
+
+  func makeOptimizer(
+    for model: TinyModel, useFusedUpdates: Bool, _ parameterGroup: ParameterGroupOptimizer
+  ) -> GeneralOptimizer<TinyModel> {
+    let plan = TensorVisitorPlan(model.differentiableVectorView)
+    let optimizer = GeneralOptimizer(
+      for: model, plan,
+      parameterGroups: (plan.keysEnding(with: \Dense<Float>.TangentVector.bias), makeSGD()),
+      defaultOptimizer: parameterGroup)
+    optimizer.useFusedUpdates = useFusedUpdates
+    return optimizer
+  }
+
+  /// Trains a model for a few steps, and returns its weights. Also returns whether the last step
+  /// went through the multi-tensor optimizer update op.
+  func train(useFusedUpdates: Bool, _ parameterGroup: ParameterGroupOptimizer) -> (
+    weights: [[Float]], usedFusedOp: Bool
+  ) {
+    var model = TinyModel(copying: initialModel, to: device)
+    let optimizer = makeOptimizer(
+      for: model, useFusedUpdates: useFusedUpdates, parameterGroup)
+    let input = self.input
+    var usedFusedOp = false
+    for _ in 0..<3 {
+      let grad = gradient(at: model) { model in model(input).squared().mean() }
+      optimizer.update(&model, along: grad)
+      usedFusedOp = model.hidden.weight.xlaIrText.contains("xla::optimizer_update")
+      LazyTensorBarrier()
+    }
+    let weights = [model.hidden.weight, model.hidden.bias, model.output.weight, model.output.bias]
+    return (Tensor.scalars(of: weights), usedFusedOp)
+  }
+
+  func assertFusedMatchesUnfused(
+    _ makeParameterGroup: @autoclosure () -> ParameterGroupOptimizer,
+    file: StaticString = #file, line: UInt = #line
+  ) {
+    let fused = train(useFusedUpdates: true, makeParameterGroup())
+    let unfused = train(useFusedUpdates: false, makeParameterGroup())
+    XCTAssertTrue(fused.usedFusedOp, file: file, line: line)
+    XCTAssertFalse(unfused.usedFusedOp, file: file, line: line)
+    for (actual, expected) in zip(fused.weights, unfused.weights) {
+      XCTAssertEqual(actual.count, expected.count, file: file, line: line)
+      for (a, e) in zip(actual, expected) {
+        XCTAssertEqual(a, e, accuracy: 1e-5 * max(1, abs(e)), file: file, line: line)
+      }
+    }
+  }
+
+  func testFusedSGD() {
+    assertFusedMatchesUnfused(makeSGD(learningRate: 0.1))
+    assertFusedMatchesUnfused(makeSGD(learningRate: 0.1, weightDecay: 0.01))
+  }
+
+  func testFusedMomentum() {
+    assertFusedMatchesUnfused(makeSGD(learningRate: 0.1, momentum: 0.9))
+    assertFusedMatchesUnfused(makeSGD(learningRate: 0.1, momentum: 0.9, nesterov: true))
+  }
+
+  func testFusedLARS() {
+    assertFusedMatchesUnfused(makeLARS(learningRate: 0.1, trustCoefficient: 0.01))
+    assertFusedMatchesUnfused(
+      makeLARS(learningRate: 0.1, trustCoefficient: 0.01, nesterov: true, weightDecay: 0.01))
+  }
+
+  func testFusedAdam() {
+    assertFusedMatchesUnfused(makeAdam(learningRate: 0.1))
+  }
+
+  func testFusedRouting() {
+    // Fused updates are on by default, and the copies of an optimizer keep the setting.
+    let model = TinyModel(copying: initialModel, to: device)
+    let optimizer = makeOptimizer(for: model, useFusedUpdates: true, makeSGD())
+    let fresh = GeneralOptimizer(
+      for: model, TensorVisitorPlan(model.differentiableVectorView),
+      defaultOptimizer: makeSGD())
+    XCTAssertTrue(fresh.useFusedUpdates)
+    optimizer.useFusedUpdates = false
+    XCTAssertFalse(GeneralOptimizer(copying: optimizer, to: device).useFusedUpdates)
+
+    // A callback appended after the fused update was recorded makes the group fall back to the
+    // callbacks, which then see the extra step.
+    var customized = makeSGD(learningRate: 0.1)
+    customized.callbacks.append { (state: inout OptimizerWeightStepState, _) in
+      state.step = state.step.map { $0 * 2 }
+    }
+    let fallback = train(useFusedUpdates: true, customized)
+    XCTAssertFalse(fallback.usedFusedOp)
+    let plain = train(useFusedUpdates: true, makeSGD(learningRate: 0.1))
+    XCTAssertTrue(plain.usedFusedOp)
+    XCTAssertNotEqual(fallback.weights, plain.weights)
+  }
+
+  func testConditionalUpdate() {
+    let input = self.input
+    var skipped = TinyModel(copying: initialModel, to: device)
+    var applied = TinyModel(copying: initialModel, to: device)
+    let conditional = makeOptimizer(
+      for: skipped, useFusedUpdates: true, makeSGD(learningRate: 0.1, momentum: 0.9))
+    let reference = makeOptimizer(
+      for: applied, useFusedUpdates: true, makeSGD(learningRate: 0.1, momentum: 0.9))
+    let grad = gradient(at: skipped) { model in model(input).squared().mean() }
+
+    // A skipped step leaves both the weights and the optimizer state untouched.
+    conditional.update(&skipped, along: grad, if: Tensor(false, on: device))
+    XCTAssertEqual(skipped.hidden.weight.scalars, initialModel.hidden.weight.scalars)
+    for state in conditional.optimizerState.state {
+      XCTAssertEqual(state.scalars, [Float](repeating: 0, count: state.scalars.count))
+    }
+
+    conditional.update(&skipped, along: grad, if: Tensor(true, on: device))
+    reference.update(&applied, along: grad)
+    XCTAssertEqual(skipped.hidden.weight.scalars, applied.hidden.weight.scalars)
+    XCTAssertEqual(skipped.output.bias.scalars, applied.output.bias.scalars)
+    for (actual, expected) in zip(
+      conditional.optimizerState.state, reference.optimizerState.state)
+    {
+      XCTAssertEqual(actual.scalars, expected.scalars)
+    }
+  }
+
+  func testLossScalerGrowth() {
+    let input = self.input
+    var model = TinyModel(copying: initialModel, to: device)
+    let optimizer = makeOptimizer(for: model, useFusedUpdates: true, makeSGD(learningRate: 0.1))
+    var scaler = DynamicLossScaler(initialScale: 4, growthInterval: 2, on: device)
+    var scales = [Float]()
+    for _ in 0..<5 {
+      let grad = gradient(at: model) { model in scaler.scaled(model(input).squared().mean()) }
+      let finite = scaler.update(&model, along: grad, using: optimizer)
+      XCTAssertTrue(finite.scalarized())
+      scales.append(scaler.scale.scalarized())
+    }
+    XCTAssertEqual(scales, [4, 8, 8, 16, 16])
+    XCTAssertEqual(scaler.growthTracker.scalarized(), 1)
+  }
+
+  func testLossScalerBackoff() {
+    let input = self.input
+    var model = TinyModel(copying: initialModel, to: device)
+    let optimizer = makeOptimizer(for: model, useFusedUpdates: true, makeSGD(learningRate: 0.1))
+    var scaler = DynamicLossScaler(initialScale: 8, growthInterval: 2, on: device)
+    var grad = gradient(at: model) { model in scaler.scaled(model(input).squared().mean()) }
+    XCTAssertTrue(scaler.update(&model, along: grad, using: optimizer).scalarized())
+    XCTAssertEqual(scaler.growthTracker.scalarized(), 1)
+
+    // An overflow skips the step, halves the scale and restarts the growth count.
+    let weights = model.hidden.weight.scalars
+    grad = gradient(at: model) { model in scaler.scaled(model(input).squared().mean()) }
+    grad.output.weight = grad.output.weight * Float.infinity
+    XCTAssertFalse(scaler.update(&model, along: grad, using: optimizer).scalarized())
+    XCTAssertEqual(scaler.scale.scalarized(), 4)
+    XCTAssertEqual(scaler.growthTracker.scalarized(), 0)
+    XCTAssertEqual(model.hidden.weight.scalars, weights)
+  }
+}
+
+extension OptimizerTests {
+  static var allTests = [
+    ("testFusedSGD", testFusedSGD),
+    ("testFusedMomentum", testFusedMomentum),
+    ("testFusedLARS", testFusedLARS),
+    ("testFusedAdam", testFusedAdam),
+    ("testFusedRouting", testFusedRouting),
+    ("testConditionalUpdate", testConditionalUpdate),
+    ("testLossScalerGrowth", testLossScalerGrowth),
+    ("testLossScalerBackoff", testLossScalerBackoff),
+  ]
+}
+
+XCTMain([
+  testCase(OptimizerTests.allTests)
+])
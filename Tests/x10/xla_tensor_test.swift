@@ -1,3 +1,4 @@
+import Foundation
 import TensorFlow
 import XCTest
 
@@ -9,6 +10,260 @@ final class XLATensorTests: XCTestCase {
     XCTAssertEqual(x.scalarized(), 20 * 30)
   }
 
+  func testScalarsOfMany() throws {
+    let x = Tensor<Float>([1, 2, 3], on: Device.defaultXLA)
+    let y = x * 2
+    let z = Tensor<Float>(shape: [2, 2], scalars: [1, 2, 3, 4], on: Device.defaultXLA) + 1
+    let values = Tensor.scalars(of: [x, y, z])
+    XCTAssertEqual(values, [[1, 2, 3], [2, 4, 6], [2, 3, 4, 5]])
+  }
+
+  func testScalarsAsync() throws {
+    let x = Tensor<Float>([1, 2, 3], on: Device.defaultXLA)
+    let pending = Tensor.scalarsAsync(of: [x * 2, x + 1])
+    let y = x * 3
+    XCTAssertEqual(pending.wait(), [[2, 4, 6], [2, 3, 4]])
+    XCTAssertTrue(pending.isReady)
+    XCTAssertEqual(y.scalars, [3, 6, 9])
+    // Host resident values are copied right away, and dropping a pending fetch waits for its
+    // transfers before releasing the buffers.
+    let mixed = Tensor.scalarsAsync(of: [Tensor<Float>([4, 5], on: Device.defaultXLA), y + 1])
+    XCTAssertEqual(mixed.wait(), [[4, 5], [4, 7, 10]])
+    _ = Tensor.scalarsAsync(of: [y * y])
+  }
+
+  func testScalarsAsyncWhileRunning() throws {
+    // A chain of large matmuls is still running when scalarsAsync returns, so the fetch has to
+    // wait for the computation rather than reading its results right away.
+    let size = 512
+    let x = Tensor<Float>(repeating: 1 / Float(size), shape: [size, size], on: Device.defaultXLA)
+    var product = x
+    for _ in 0..<32 {
+      product = matmul(product, x)
+    }
+    let pending = Tensor.scalarsAsync(of: [product, product.sum()])
+    let values = pending.wait()
+    XCTAssertEqual(values[0], [Float](repeating: 1 / Float(size), count: size * size))
+    XCTAssertEqual(values[1], [Float(size)])
+  }
+
+  func testBorrowedScalars() throws {
+    var scalars: [Float] = [1, 2, 3, 4, 5, 6]
+    let x = Tensor<Float>(shape: [2, 3], scalars: scalars, on: Device.defaultXLA)
+    // The tensor borrows the array storage, so later writes must not show through.
+    scalars[0] = 10
+    let y = x * 2
+    scalars[1] = 20
+    XCTAssertEqual(y.scalars, [2, 4, 6, 8, 10, 12])
+    XCTAssertEqual(x.scalars, [1, 2, 3, 4, 5, 6])
+    XCTAssertEqual(scalars, [10, 20, 3, 4, 5, 6])
+    let empty = Tensor<Float>(shape: [0, 3], scalars: [], on: Device.defaultXLA)
+    XCTAssertEqual(empty.scalars, [])
+  }
+
+  func testPackedScalars() throws {
+    let x = Tensor<Float>([1, 2, 3], on: Device.defaultXLA)
+    LazyTensorBarrier()
+    for scale in [0.5, 2.5, 4] as [Float] {
+      let uploads = X10CounterValue("ScalarPackUploads")
+      let offset = Tensor(scale * 2, on: Device.defaultXLA)
+      let scaled = x * Tensor(scale, on: Device.defaultXLA) + offset
+      XCTAssertEqual(scaled.scalars, [1, 2, 3].map { $0 * scale + scale * 2 })
+      XCTAssertEqual(X10CounterValue("ScalarPackUploads") - uploads, 1)
+    }
+    // All the scalars of a step share a single upload.
+    let uploads = X10CounterValue("ScalarPackUploads")
+    var sum = x
+    for i in 2..<12 {
+      sum = sum + Tensor(Float(i), on: Device.defaultXLA)
+    }
+    XCTAssertEqual(sum.scalars, [66, 67, 68])
+    XCTAssertEqual(X10CounterValue("ScalarPackUploads") - uploads, 1)
+  }
+
+  func testReducedPrecisionUpload() throws {
+    // 1/3 and 256.5 are rounded to nearest even BFloat16 values by the upload itself.
+    let scalars: [Float] = [1, 1.0 / 3, 256.5, -2]
+    let x = scalars.withUnsafeBufferPointer { scalars in
+      Tensor<Float>(
+        shape: [2, 2], scalars: scalars, toReducedPrecision: true, directlyOn: Device.defaultXLA)
+    }
+    XCTAssertTrue(x.isReducedPrecision)
+    XCTAssertFalse(x.xlaIrText.contains("xla::cast"))
+    let expected = Tensor<Float>(shape: [2, 2], scalars: scalars, on: Device.defaultXLA)
+      .toReducedPrecision
+    XCTAssertEqual(x.toFullPrecision.scalars, [1, 0.333984375, 256, -2])
+    XCTAssertEqual(x.toFullPrecision.scalars, expected.toFullPrecision.scalars)
+  }
+
+  func testAutomaticMixedPrecision() throws {
+    AutomaticMixedPrecision.isEnabled = true
+    defer { AutomaticMixedPrecision.isEnabled = false }
+    // 1/3 is not representable in BFloat16, while the products of the rounded values are exact.
+    let a = Tensor<Float>(shape: [2, 2], scalars: [1, 2, 3, 4], on: Device.defaultXLA) / 3
+    let b = Tensor<Float>(shape: [2, 2], scalars: [3, 0, 0, 3], on: Device.defaultXLA)
+    let product = matmul(a, b)
+    XCTAssertFalse(product.isReducedPrecision)
+    let expected = (a * 3).scalars
+    XCTAssertNotEqual(product.scalars, expected)
+    for (actual, expected) in zip(product.scalars, expected) {
+      XCTAssertEqual(actual, expected, accuracy: 0.05)
+    }
+  }
+
+  func testAllFinite() throws {
+    let x = Tensor<Float>([1, 2, 3], on: Device.defaultXLA)
+    let y = Tensor<Float>(shape: [2, 2], scalars: [1, 2, 3, 4], on: Device.defaultXLA)
+    XCTAssertEqual(_Raw.allFinite([x, y]).scalarized(), true)
+    XCTAssertEqual(_Raw.allFinite([x, y / 0]).scalarized(), false)
+    XCTAssertEqual(_Raw.allFinite([x * .nan, y]).scalarized(), false)
+  }
+
+  func testRematerialization() throws {
+    // A value with an early and a late user, far apart, which the rematerialization pass
+    // recomputes for the late user when a memory budget is set.
+    func compute(on device: Device) -> [Float] {
+      let x = Tensor<Float>(
+        shape: [64, 64], scalars: (0..<4096).map { Float($0 % 7) / 7 }, on: device)
+      let early = exp(x) * 2
+      var y = early + 1
+      for i in 0..<24 {
+        y = tanh(y) * 0.5 + Float(i) / 24
+      }
+      return (y + early).scalars
+    }
+    let segments = X10CounterValue("RematerializedSegments")
+    let actual = compute(on: Device.defaultXLA)
+    let expected = compute(on: Device.defaultTFEager)
+    XCTAssertEqual(actual.count, expected.count)
+    for (a, e) in zip(actual, expected) {
+      XCTAssertEqual(a, e, accuracy: 1e-5 * max(1, abs(e)))
+    }
+    if Int(ProcessInfo.processInfo.environment["XLA_REMAT_MEMORY_BUDGET"] ?? "0")! > 0 {
+      XCTAssertGreaterThan(X10CounterValue("RematerializedSegments"), segments)
+    }
+  }
+
+  func testRandomState() throws {
+    let device = Device.defaultXLA
+    _RawXLA.setRandomSeed(7, on: device)
+    let state = _RawXLA.randomState(on: device)
+    let a = Tensor<Float>(randomUniform: [8], on: device)
+    let b = Tensor<Float>(randomUniform: [8], on: device)
+    XCTAssertNotEqual(a.scalars, b.scalars)
+    XCTAssertEqual(state.scalars, [7, 0])
+    _RawXLA.setRandomState(state, on: device)
+    let c = Tensor<Float>(randomUniform: [8], on: device)
+    XCTAssertEqual(a.scalars, c.scalars)
+  }
+
+  func testContextRandomSeed() throws {
+    // A seed set in the context takes precedence over the RNG state of the device.
+    let device = Device.defaultXLA
+    let a = withRandomSeedForTensorFlow((3, 4)) { Tensor<Float>(randomUniform: [8], on: device) }
+    let b = withRandomSeedForTensorFlow((3, 4)) { Tensor<Float>(randomUniform: [8], on: device) }
+    let c = Tensor<Float>(randomUniform: [8], seed: (3, 4), on: device)
+    XCTAssertEqual(a.scalars, b.scalars)
+    XCTAssertEqual(a.scalars, c.scalars)
+  }
+
+  /// Creates a unique directory for the files written by a test, removed by the returned cleanup.
+  func makeTemporaryDirectory() throws -> (url: URL, cleanup: () -> Void) {
+    let url = FileManager.default.temporaryDirectory
+      .appendingPathComponent("x10_test_\(UUID().uuidString)", isDirectory: true)
+    try FileManager.default.createDirectory(at: url, withIntermediateDirectories: false)
+    return (url, { try? FileManager.default.removeItem(at: url) })
+  }
+
+  func testCheckpointRoundTrip() throws {
+    let directory = try makeTemporaryDirectory()
+    defer { directory.cleanup() }
+    let path = directory.url.appendingPathComponent("checkpoint.ckpt").path
+    var checkpoint = XLACheckpoint()
+    checkpoint["w"] = Tensor<Float>(shape: [2, 2], scalars: [1, 2, 3, 4], on: Device.defaultXLA)
+    checkpoint["step"] = Tensor<Int32>(7, on: Device.defaultXLA)
+    checkpoint.save(to: path)
+    let loaded = XLACheckpoint(contentsOf: path, on: Device.defaultXLA)
+    XCTAssertEqual(loaded.names, ["step", "w"])
+    XCTAssertEqual(loaded["w", as: Float.self]!.shape, [2, 2])
+    XCTAssertEqual(loaded["w", as: Float.self]!.scalars, [1, 2, 3, 4])
+    XCTAssertEqual(loaded["step", as: Int32.self]!.scalarized(), 7)
+    XCTAssertNil(loaded["missing", as: Float.self])
+  }
+
+  func testFrozenComputation() throws {
+    let device = Device.defaultXLA
+    let directory = try makeTemporaryDirectory()
+    defer { directory.cleanup() }
+    let path = directory.url.appendingPathComponent("frozen.x10").path
+    let weight = Tensor<Float>(shape: [2, 2], scalars: [1, 2, 3, 4], on: device)
+    let input = Tensor<Float>(shape: [1, 2], scalars: [0, 0], on: device)
+    // Scalar inputs are slices of the scalar packs, which also hold the frozen offset.
+    let scale = Tensor<Float>(2, on: device)
+    let offset = Tensor<Float>(0.5, on: device)
+    let frozen = XLAFrozenComputation(
+      inputs: [input, scale], outputs: [matmul(input, weight) * scale + offset])
+    frozen.save(to: path)
+    let loaded = XLAFrozenComputation(contentsOf: path, on: device)
+    let x = Tensor<Float>(shape: [1, 2], scalars: [1, 1], on: device)
+    for computation in [frozen, loaded] {
+      let outputs = computation([x, Tensor<Float>(3, on: device)])
+      XCTAssertEqual(outputs.count, 1)
+      XCTAssertEqual((outputs[0] as! Tensor<Float>).scalars, [12.5, 18.5])
+    }
+  }
+
+  func testInferenceEngine() throws {
+    let device = Device.defaultXLA
+    let weight = Tensor<Float>(shape: [3, 2], scalars: [1, 2, 3, 4, 5, 6], on: device)
+    let engine = XLAInferenceEngine(maxLatency: 1000, on: device)
+    for batchSize in [1, 4] {
+      let input = Tensor<Float>(
+        shape: [batchSize, 3], scalars: Array(repeating: 0, count: batchSize * 3), on: device)
+      engine.addBucket(batchSize: batchSize, inputs: [input], outputs: [matmul(input, weight)])
+    }
+    XCTAssertEqual(engine.run([[1, 0, 1]]), [[6, 8]])
+    let stats = engine.benchmark(clients: 4, requestsPerClient: 8)
+    XCTAssertEqual(stats.requests, 32)
+    XCTAssertLessThanOrEqual(stats.p50LatencyMilliseconds, stats.p99LatencyMilliseconds)
+    XCTAssertGreaterThanOrEqual(stats.meanBatchSize, 1)
+  }
+
+  func testConvBiasActivation() throws {
+    let device = Device.defaultXLA
+    let input = Tensor<Float>(randomNormal: [2, 5, 5, 3], on: device)
+    let filter = Tensor<Float>(randomNormal: [3, 3, 3, 4], on: device)
+    let bias = Tensor<Float>(randomNormal: [4], on: device)
+    typealias Activation = @differentiable(reverse) (Tensor<Float>) -> Tensor<Float>
+    let activations: [(FusedActivation, Activation)] = [
+      (.relu, { relu($0) }), (.relu6, { relu6($0) }), (.gelu, { gelu($0) }),
+      (.swish, { swish($0) }),
+    ]
+    for (activation, unfusedActivation) in activations {
+      let output = conv2D(input, filter: filter, bias: bias, activation: activation, padding: .same)
+      XCTAssert(output.xlaIrText.contains("xla::conv_bias_activation"))
+      let (fused, fusedGrads) = valueWithGradient(at: input, filter, bias) {
+        conv2D($0, filter: $1, bias: $2, activation: activation, padding: .same).sum()
+      }
+      let (unfused, unfusedGrads) = valueWithGradient(at: input, filter, bias) {
+        unfusedActivation(conv2D($0, filter: $1, padding: .same) + $2).sum()
+      }
+      XCTAssertEqual(fused.scalarized(), unfused.scalarized(), accuracy: 1e-2)
+      XCTAssert(fusedGrads.0.isAlmostEqual(to: unfusedGrads.0, tolerance: 1e-3))
+      XCTAssert(fusedGrads.1.isAlmostEqual(to: unfusedGrads.1, tolerance: 1e-3))
+      XCTAssert(fusedGrads.2.isAlmostEqual(to: unfusedGrads.2, tolerance: 1e-3))
+    }
+  }
+
+  func testConv2DLayerFusedActivation() throws {
+    let device = Device.defaultXLA
+    let layer = Conv2D<Float>(
+      copying: Conv2D<Float>(filterShape: (3, 3, 3, 4), padding: .same, activation: .relu),
+      to: device)
+    let input = Tensor<Float>(randomNormal: [2, 5, 5, 3], on: device)
+    XCTAssert(layer(input).xlaIrText.contains("xla::conv_bias_activation"))
+  }
+
   func testAnnotationsTFEager() throws {
     let tensor = Tensor<Float>(repeating: 0, shape: [1, 2, 3], on: Device.defaultTFEager)
     XCTAssertEqual(tensor.annotations, "Annotations not available in TF_EAGER.")
@@ -27,6 +282,22 @@ final class XLATensorTests: XCTestCase {
 extension XLATensorTests {
   static var allTests = [
     ("testLazyTensorBarrier", testLazyTensorBarrier),
+    ("testScalarsOfMany", testScalarsOfMany),
+    ("testScalarsAsync", testScalarsAsync),
+    ("testScalarsAsyncWhileRunning", testScalarsAsyncWhileRunning),
+    ("testBorrowedScalars", testBorrowedScalars),
+    ("testPackedScalars", testPackedScalars),
+    ("testReducedPrecisionUpload", testReducedPrecisionUpload),
+    ("testAutomaticMixedPrecision", testAutomaticMixedPrecision),
+    ("testAllFinite", testAllFinite),
+    ("testRematerialization", testRematerialization),
+    ("testRandomState", testRandomState),
+    ("testContextRandomSeed", testContextRandomSeed),
+    ("testCheckpointRoundTrip", testCheckpointRoundTrip),
+    ("testFrozenComputation", testFrozenComputation),
+    ("testInferenceEngine", testInferenceEngine),
+    ("testConvBiasActivation", testConvBiasActivation),
+    ("testConv2DLayerFusedActivation", testConv2DLayerFusedActivation),
     ("testAnnotationsTFEager", testAnnotationsTFEager),
     ("testAnnotationsXLA", testAnnotationsXLA),
   ]
@@ -98,6 +369,37 @@ final class MultiDeviceAPITests: XCTestCase {
     })[0] as! Tensor<Float>
     XCTAssertEqual(res.scalarized(), 63)
   }
+
+  func testScan() {
+    let xs = Tensor<Float>([[1, 2], [3, 4], [5, 6]], on: .defaultXLA)
+    for reverse in [false, true] {
+      let (carry, outputs) = _RawXLA.scan(
+        length: 3, initial: [Tensor<Float>([0, 0], on: .defaultXLA)], xs: [xs], reverse: reverse
+      ) { carry, x in
+        let h = (carry[0] as! Tensor<Float>) + (x[0] as! Tensor<Float>)
+        return ([h], [h * 10])
+      }
+      XCTAssertEqual((carry[0] as! Tensor<Float>).scalars, [9, 12])
+      let expected: [Float] =
+        reverse ? [90, 120, 80, 100, 50, 60] : [10, 20, 40, 60, 90, 120]
+      XCTAssertEqual((outputs[0] as! Tensor<Float>).shape, [3, 2])
+      XCTAssertEqual((outputs[0] as! Tensor<Float>).scalars, expected)
+    }
+  }
+
+  func testMultiStepLoop() {
+    let batches = Tensor<Float>([[1, 2], [3, 4], [5, 6]], on: .defaultXLA)
+    let (state, metrics) = _RawXLA.multiStepLoop(
+      steps: 3, state: [Tensor<Float>([0, 0], on: .defaultXLA)],
+      metrics: [Tensor<Float>(0, on: .defaultXLA)], inputQueue: [batches]
+    ) { state, batch in
+      let w = state[0] as! Tensor<Float>
+      let x = batch[0] as! Tensor<Float>
+      return ([w * 2 + x], [x.sum()])
+    }
+    XCTAssertEqual((state[0] as! Tensor<Float>).scalars, [15, 22])
+    XCTAssertEqual((metrics[0] as! Tensor<Float>).scalarized(), 21)
+  }
 }
 
 extension MultiDeviceAPITests {
@@ -108,6 +410,8 @@ extension MultiDeviceAPITests {
     ("testSyncLiveTensors", testSyncLiveTensors),
     ("testCrossReplicaSum", testCrossReplicaSum),
     ("testFunctionalWhile", testFunctionalWhile),
+    ("testScan", testScan),
+    ("testMultiStepLoop", testMultiStepLoop),
   ]
 }
 